@@ -0,0 +1,66 @@
+#ifndef AUTOTUNER_HPP
+#define AUTOTUNER_HPP
+
+#include <map>
+#include <string>
+#include "simulation.hpp"
+
+#define AUTOTUNE_CACHE_PATH "autotune.cache" // next to the shaders, one line per tuned scene class
+#define AUTOTUNE_ACCURACY 1e-2               // default RMS relative force error a candidate may have
+#define AUTOTUNE_MIN_BODIES 64               // below this every solver is fast enough to not bother
+#define AUTOTUNE_REPEATS 3                   // timed evaluations per candidate, the fastest counts
+#define AUTOTUNE_SAMPLE_ROWS 512             // bodies the direct reference is summed for, spread over the system
+#define AUTOTUNE_BUDGET 2.0                  // seconds a tuning run may spend once a candidate qualified
+
+struct TuningResult {
+  SolverConfig config;
+  double seconds = 0.0;   // one force evaluation with the chosen config
+  double rms_error = 0.0; // against the direct double sum on the sampled rows
+  size_t candidates = 0;  // configurations benchmarked, 0 when the cache answered
+  double tuning_seconds = 0.0;
+  bool from_cache = false;
+  bool over_budget = false; // candidates were left untimed at AUTOTUNE_BUDGET
+};
+
+// Picks the force solver, thread count, float32 tile size and octree leaf size by timing
+// candidates on the live simulation state, keeping the fastest one whose forces stay within
+// the accuracy target. Accuracy is judged against the direct sum on AUTOTUNE_SAMPLE_ROWS
+// bodies, the pair kernels are only tried up to DIRECT_MAX_BODIES, and once a candidate has
+// qualified the search stops at AUTOTUNE_BUDGET. Results are cached on disk per body-count
+// bucket and core count, so a later start on the same machine only looks them up. SIMD width
+// is fixed at compile time and is not part of the search.
+class Autotuner {
+public:
+  explicit Autotuner(std::string cache_path = AUTOTUNE_CACHE_PATH);
+
+  // tunes when nothing was tuned yet, the body count halved or doubled, or the deterministic
+  // or precision mode changed since the last run
+  bool maybe_tune(Simulation &simulation);
+  TuningResult tune(Simulation &simulation);
+  void reset();
+  // false while a mode replaces the candidate kernels with its own: the periodic box, the
+  // chaos indicators, adaptive softening (outside the tree) and double-double precision
+  static bool tunable(const Simulation &simulation);
+
+  void set_accuracy(double rms_error);
+  double get_accuracy() const;
+  bool has_result() const;
+  const TuningResult &last_result() const;
+
+private:
+  std::string cache_key(const Simulation &simulation) const;
+  void load_cache();
+  void save_cache() const;
+
+  std::string cache_path;
+  std::map<std::string, SolverConfig> cache;
+  bool cache_loaded = false;
+  double accuracy = AUTOTUNE_ACCURACY;
+  size_t tuned_bodies = 0; // 0 = not tuned
+  bool tuned_deterministic = false;
+  PrecisionMode tuned_precision = PrecisionMode::DOUBLE;
+  bool has_tuning = false;
+  TuningResult result;
+};
+
+#endif
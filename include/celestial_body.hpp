@@ -0,0 +1,33 @@
+#ifndef CELESTIAL_BODY_HPP
+#define CELESTIAL_BODY_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define GRAM_PER_CM3 1.6837e6             // in solar masses per cubic AU
+#define BODY_DENSITY (3.0 * GRAM_PER_CM3) // rock, for bodies given no density of their own
+
+struct CelestialBody {
+  glm::dvec3 position;
+  glm::dvec3 velocity;
+  glm::dvec3 acceleration;
+  double mass;
+  double radius;
+  glm::vec3 color;
+  bool is_black_hole = false;
+  glm::dvec3 previous_acceleration;
+  // low-order words: Neumaier compensation, or the lo half in double-double mode
+  glm::dvec3 position_compensation = glm::dvec3(0.0);
+  glm::dvec3 velocity_compensation = glm::dvec3(0.0);
+  double density = BODY_DENSITY; // sets the physical size, radius is only what is drawn
+};
+
+// generational reference to a body; survives the removal of other bodies and reports
+// invalid once its own body is gone, so selections and per-body data can keep it
+struct BodyHandle {
+  uint32_t slot = UINT32_MAX;
+  uint32_t generation = 0;
+  bool operator==(const BodyHandle &) const = default;
+};
+
+#endif
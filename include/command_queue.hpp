@@ -0,0 +1,123 @@
+#ifndef COMMAND_QUEUE_HPP
+#define COMMAND_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <glm/glm.hpp>
+#include "porkchop.hpp"
+#include "simulation.hpp"
+
+#define COMMAND_QUEUE_CAPACITY 1024 // power of two
+
+enum class CommandType {
+  RESET,
+  LOAD_SCENE,
+  SET_G,
+  ADD_BODY,
+  REMOVE_LAST_BODY,
+  REMOVE_BODY,
+  SET_MASS,
+  SET_RADIUS,
+  SET_DENSITY,
+  SET_POSITION,
+  SET_VELOCITY,
+  SET_COLOR,
+  SET_BLACK_HOLE,
+  SET_DETERMINISTIC,
+  SET_PRECISION,
+  SET_FORCE_SOLVER,
+  SET_REORDER_INTERVAL,
+  SET_AUTO_TUNE,
+  SET_TUNING_ACCURACY,
+  SET_VARIATIONAL,
+  SET_SOFTENING,
+  SET_PERIODIC,
+  SET_DISRUPTION,
+  LAUNCH_PROBES,
+  CLEAR_PROBES,
+  SET_EXTERNAL_FORCE,
+  ADD_MOON,
+  ADD_RING,
+  ADD_GAS_DISK,
+  REMOVE_GAS_DISK,
+  MEASURE_FORCE_ERROR,
+  COMPUTE_PORKCHOP,
+  RUN_ENSEMBLE,
+  CANCEL_ENSEMBLE
+};
+
+// one edit to the simulation, carrying the exact double values the widget produced
+struct SimulationCommand {
+  CommandType type;
+  BodyHandle handle = {};
+  double scalar = 0.0;
+  glm::dvec3 vector = glm::dvec3(0.0);
+  int option = 0; // bool / enum payloads
+  CelestialBody body = {};
+  PorkchopConfig porkchop = {};
+};
+
+// Bounded lock-free multi-producer/single-consumer queue (Vyukov's sequenced ring).
+// Producers claim a cell with one CAS, the consumer never writes shared counters,
+// and nobody ever blocks on a lock.
+template <typename T, size_t Capacity>
+class MpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+  MpscQueue() : cells(new Cell[Capacity]) {
+    for (size_t i = 0; i < Capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  bool try_push(const T &value) {
+    size_t position = enqueue_position.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[position & (Capacity - 1)];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+      if (difference == 0) {
+        if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false; // full
+      } else {
+        position = enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // only fails if the consumer has fallen a whole ring behind
+  void push(const T &value) {
+    while (!try_push(value)) std::this_thread::yield();
+  }
+
+  bool try_pop(T &value) {
+    Cell &cell = cells[dequeue_position & (Capacity - 1)];
+    const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(dequeue_position + 1) < 0) return false;
+
+    value = std::move(cell.value);
+    cell.sequence.store(dequeue_position + Capacity, std::memory_order_release);
+    ++dequeue_position;
+    return true;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  alignas(64) std::atomic<size_t> enqueue_position{0};
+  alignas(64) size_t dequeue_position = 0; // consumer only
+};
+
+#endif
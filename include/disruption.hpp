@@ -0,0 +1,46 @@
+#ifndef DISRUPTION_HPP
+#define DISRUPTION_HPP
+
+#include <cstdint>
+#include <vector>
+#include "celestial_body.hpp"
+
+#define ROCHE_COEFFICIENT 2.44      // fluid satellite (Roche 1849), a rigid one would be 1.26
+#define DISRUPTION_FRAGMENTS 1000
+#define DISRUPTION_MAX_FRAGMENTS 100000 // per swarm
+#define DISRUPTION_BODY_LIMIT 2000000   // no swarm is made that would take the bodies, or test particles, past this
+#define DISRUPTION_MASS_RATIO 10.0  // a primary outweighs the body it disrupts at least this much
+#define DISRUPTION_PRIMARIES 16     // heaviest bodies checked as primaries
+#define DISRUPTION_RESERVE_EVENTS 4 // swarms the body storage is kept ready for, and the most made per check
+#define DISRUPTION_DISPERSION 0.3   // fragment velocity spread over the parent's escape speed
+
+struct DisruptionConfig {
+  bool enabled = false;
+  unsigned fragments = DISRUPTION_FRAGMENTS;
+  bool test_particles = false; // fragments feel the massive bodies but pull on nothing
+  double roche_coefficient = ROCHE_COEFFICIENT;
+  double dispersion = DISRUPTION_DISPERSION;
+};
+
+struct DisruptionStats {
+  uint64_t events = 0;
+  uint64_t fragments = 0;      // created over all events
+  uint64_t deferred = 0;       // victims the last check left to a later one, past the per-check cap or the body limit
+  double last_seconds = 0.0;   // detection and insertion of the last check that found one
+};
+
+// radius of a sphere of the body's mass at its density, unrelated to the drawn radius
+double physical_radius(const CelestialBody &body);
+
+// d = k R_p (rho_p / rho_s)^(1/3) = k (3 M / (4 pi rho_s))^(1/3): only the primary's mass
+// and the satellite's density enter, neither body's drawn radius does
+double roche_limit(const CelestialBody &primary, const CelestialBody &satellite, double coefficient);
+
+// Replaces `parent` by `count` equal fragments of equal density filling its physical sphere, with an
+// isotropic velocity spread of `dispersion` times its escape speed. The fragments' mass-weighted
+// mean position and velocity are shifted onto the parent's, so the swarm carries its mass,
+// momentum and centre of mass exactly. Deterministic in seed.
+void make_fragments(const CelestialBody &parent, unsigned count, double dispersion, double G, uint64_t seed,
+                    std::vector<CelestialBody> &fragments);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+// unevaluated sum hi + lo with |lo| <= ulp(hi) / 2, about 106 bits of mantissa.
+// everything below is branch-free so loops over arrays of them vectorize;
+// like summation.hpp it must not be built with -ffast-math
+struct DoubleDouble {
+  double hi;
+  double lo;
+};
+
+inline DoubleDouble two_sum(double a, double b) {
+  const double s = a + b;
+  const double bb = s - a;
+  return {s, (a - (s - bb)) + (b - bb)};
+}
+
+// requires |a| >= |b|
+inline DoubleDouble quick_two_sum(double a, double b) {
+  const double s = a + b;
+  return {s, b - (s - a)};
+}
+
+inline DoubleDouble two_prod(double a, double b) {
+  const double p = a * b;
+#ifdef __FMA__
+  return {p, std::fma(a, b, -p)};
+#else
+  // Dekker split, stays vectorizable on targets without fma
+  constexpr double SPLITTER = 134217729.0; // 2^27 + 1
+  const double ta = SPLITTER * a, a_hi = ta - (ta - a), a_lo = a - a_hi;
+  const double tb = SPLITTER * b, b_hi = tb - (tb - b), b_lo = b - b_hi;
+  return {p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+#endif
+}
+
+inline DoubleDouble dd_add(DoubleDouble a, double b) {
+  DoubleDouble s = two_sum(a.hi, b);
+  return quick_two_sum(s.hi, s.lo + a.lo);
+}
+
+inline DoubleDouble dd_add(DoubleDouble a, DoubleDouble b) {
+  DoubleDouble s = two_sum(a.hi, b.hi);
+  DoubleDouble t = two_sum(a.lo, b.lo);
+  s = quick_two_sum(s.hi, s.lo + t.hi);
+  return quick_two_sum(s.hi, s.lo + t.lo);
+}
+
+inline DoubleDouble dd_sub(DoubleDouble a, DoubleDouble b) {
+  return dd_add(a, DoubleDouble{-b.hi, -b.lo});
+}
+
+inline DoubleDouble dd_mul(DoubleDouble a, double b) {
+  DoubleDouble p = two_prod(a.hi, b);
+  return quick_two_sum(p.hi, p.lo + a.lo * b);
+}
+
+inline DoubleDouble dd_mul(DoubleDouble a, DoubleDouble b) {
+  DoubleDouble p = two_prod(a.hi, b.hi);
+  return quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+inline double dd_to_double(DoubleDouble a) { return a.hi + a.lo; }
+
+// (a_hi + a_lo) - (b_hi + b_lo) rounded once to double, the pair separation kernel
+inline double dd_difference(double a_hi, double a_lo, double b_hi, double b_lo) {
+  DoubleDouble s = two_sum(a_hi, -b_hi);
+  return s.hi + (s.lo + (a_lo - b_lo));
+}
+
+// in-place hi/lo += value for the split storage used by the integrators
+inline void dd_add(glm::dvec3 &hi, glm::dvec3 &lo, const glm::dvec3 &value) {
+  for (int k = 0; k < 3; ++k) {
+    DoubleDouble s = dd_add(DoubleDouble{hi[k], lo[k]}, value[k]);
+    hi[k] = s.hi;
+    lo[k] = s.lo;
+  }
+}
+
+#endif
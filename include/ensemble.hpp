@@ -0,0 +1,75 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "simulation.hpp"
+
+#define ENSEMBLE_LANES 8                 // members per SIMD batch (8 doubles = one AVX-512 register)
+#define ENSEMBLE_EJECTION_RADIUS 1000.0  // AU from the member's centre of mass
+#define ENSEMBLE_MAX_BODIES 64           // larger systems belong in a Simulation, not a lane
+#define ENSEMBLE_MAX_INTERACTIONS 1e10   // pair evaluations per run, a few seconds on a desktop
+#define ENSEMBLE_SLICE_INTERACTIONS 4e6  // pair evaluations per background slice, a few milliseconds
+
+struct EnsembleDiagnostics {
+  double initial_energy;
+  double energy;
+  double relative_energy_error;
+  double relative_angular_momentum_error;
+  double min_separation;
+  bool ejected;
+};
+
+// summary over all members, what the GUI shows of a run
+struct EnsembleReport {
+  size_t members = 0;
+  size_t bodies = 0;
+  double span = 0.0;    // days
+  double seconds = 0.0; // wall time of the run
+  size_t ejected = 0;
+  double median_energy_error = 0.0;
+  double max_energy_error = 0.0;
+  double min_separation = 0.0;
+};
+
+// Many independent small systems stepped in lockstep. Storage is system-major,
+// value(body, member) = array[body * stride + member], so the pair loop over
+// (i, j) runs across members in the innermost loop and each SIMD lane is one member.
+class Ensemble {
+public:
+  explicit Ensemble(const std::vector<Simulation> &members);
+  size_t size() const;
+  size_t bodies_per_member() const;
+  void advance(double dt, int n_steps);
+  std::vector<EnsembleDiagnostics> diagnostics() const;
+  EnsembleReport report() const; // span and seconds are left to the caller
+  void copy_member_to(size_t member, Simulation &simulation) const;
+
+  // pair evaluations summed over members and steps, compared against ENSEMBLE_MAX_INTERACTIONS
+  static double interactions(size_t members, size_t bodies, int steps);
+
+  static std::vector<Simulation> perturbed_solar_systems(size_t count, double sigma, uint64_t seed);
+  // count copies of bodies, every position and velocity component scaled by 1 + N(0, sigma)
+  static std::vector<Simulation> perturbed_copies(const std::vector<CelestialBody> &bodies, double G, size_t count,
+                                                  double sigma, uint64_t seed);
+
+private:
+  void compute_forces(size_t begin, size_t end);
+  void integrate_velocity_verlet(size_t begin, size_t end, double dt, int n_steps);
+  void measure(size_t member, double &energy, glm::dvec3 &angular_momentum) const;
+  size_t index(size_t body, size_t member) const { return body * stride + member; }
+
+  size_t member_count;
+  size_t body_count;
+  size_t stride;
+  std::vector<double> px, py, pz;
+  std::vector<double> vx, vy, vz;
+  std::vector<double> ax, ay, az;
+  std::vector<double> mass;
+  std::vector<double> G;
+  std::vector<double> min_separation_sq;
+  std::vector<double> initial_energy;
+  std::vector<glm::dvec3> initial_angular_momentum;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef EWALD_HPP
+#define EWALD_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#define EWALD_TABLE_SIZE 32 // cells per axis over half the box
+#define EWALD_ALPHA 2.0     // real/reciprocal split, in units of the inverse box size
+#define EWALD_RANGE 3       // images and wave vectors summed per axis on either side
+
+struct PeriodicConfig {
+  bool enabled = false;
+  double box_size = 1.0; // AU, the box spans [0, box_size) on every axis
+  bool ewald = true;     // false = nearest image only
+};
+
+// Difference between the acceleration toward a unit mass and all its periodic images,
+// with the uniform background subtracted, and the plain Newtonian pull of the nearest
+// image alone. It is smooth, odd in every coordinate and only depends on the separation
+// in box units, so one octant is tabulated once, with the Ewald sums split into real
+// and reciprocal space, and looked up by trilinear interpolation in the pair kernel.
+class EwaldTable {
+public:
+  void build(); // parallel, about a second of work
+  bool is_built() const;
+
+  // d = x_source - x, already reduced to the nearest image; result scales as 1 / box^2
+  glm::dvec3 correction(const glm::dvec3 &d, double box) const;
+  static glm::dvec3 exact(const glm::dvec3 &d); // the sums themselves, unit box
+
+private:
+  std::vector<glm::dvec3> values; // (EWALD_TABLE_SIZE + 1)^3 grid points over [0, 1/2]^3, x fastest
+};
+
+#endif
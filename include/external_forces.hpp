@@ -0,0 +1,296 @@
+#ifndef EXTERNAL_FORCES_HPP
+#define EXTERNAL_FORCES_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include "celestial_body.hpp"
+
+#ifndef EXTERNAL_FORCE_PROFILE
+#define EXTERNAL_FORCE_PROFILE 0 // keep every term out of line so profilers attribute its cost, -DEXTERNAL_FORCE_PROFILE=1
+#endif
+
+#if EXTERNAL_FORCE_PROFILE && defined(_MSC_VER)
+#define FORCE_TERM __declspec(noinline) inline
+#elif EXTERNAL_FORCE_PROFILE
+#define FORCE_TERM [[gnu::noinline]] inline
+#else
+#define FORCE_TERM inline
+#endif
+
+// what every term may look at, built once per pass
+struct ForceContext {
+  const std::vector<CelestialBody> &bodies;
+  double G;
+  double c;
+  const std::vector<size_t> &black_holes;
+  size_t heaviest;                                 // source for terms that were not given one
+  const std::function<size_t(BodyHandle)> &index_of; // SIZE_MAX for stale handles
+};
+
+// Terms are plain structs with `enabled`, a `name`, prepare(ctx) which caches per-pass
+// values and may skip the pass, and operator()(i, body) returning the extra acceleration
+// of body i. Adding a term means writing one and adding it to ExternalForces in simulation.hpp.
+
+// first post-Newtonian correction from every black hole, outside 100 Schwarzschild radii
+struct PostNewtonian {
+  static constexpr const char *name = "Post-Newtonian";
+  bool enabled = true;
+
+  const ForceContext *context = nullptr;
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// quadrupole of an oblate central body with its pole along `pole`
+struct J2Oblateness {
+  static constexpr const char *name = "J2 Oblateness";
+  bool enabled = false;
+  BodyHandle source = {};             // invalid = heaviest body
+  double j2 = 2e-7;                   // the sun's
+  double equatorial_radius = 0.00465; // AU
+  glm::dvec3 pole = glm::dvec3(0.0, 0.0, 1.0);
+
+  size_t center_index = 0;
+  glm::dvec3 center = glm::dvec3(0.0);
+  double strength = 0.0; // 3/2 J2 G M R^2
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// radiation pressure with Poynting-Robertson drag, beta = radiation force / gravity of the source
+struct RadiationPressure {
+  static constexpr const char *name = "Radiation Pressure + P-R Drag";
+  bool enabled = false;
+  BodyHandle source = {};
+  double beta = 0.1;
+  double max_mass = 1e-9; // only dust-class bodies feel it
+
+  size_t center_index = 0;
+  glm::dvec3 center = glm::dvec3(0.0), center_velocity = glm::dvec3(0.0);
+  double mu = 0.0, c = 0.0;
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// transverse Yarkovsky drift, a = A2 (1 AU / r)^2 along the velocity relative to the source
+struct Yarkovsky {
+  static constexpr const char *name = "Yarkovsky";
+  bool enabled = false;
+  BodyHandle source = {};
+  double a2 = 1e-13;      // AU / day^2 at 1 AU, negative for retrograde rotators
+  double max_mass = 1e-9; // small bodies only
+
+  size_t center_index = 0;
+  glm::dvec3 center = glm::dvec3(0.0), center_velocity = glm::dvec3(0.0);
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// Navarro-Frenk-White halo, enclosed mass M(r) = mass_scale (ln(1 + x) - x / (1 + x)), x = r / scale_radius
+struct NfwHalo {
+  static constexpr const char *name = "NFW Halo";
+  bool enabled = false;
+  glm::dvec3 center = glm::dvec3(0.0);
+  double mass_scale = 1.0;    // 4 pi rho_0 r_s^3, solar masses
+  double scale_radius = 50.0; // AU
+
+  double G = 0.0;
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// Miyamoto-Nagai disk in the xy plane, Phi = -G M / sqrt(R^2 + (a + sqrt(z^2 + b^2))^2)
+struct MiyamotoNagaiDisk {
+  static constexpr const char *name = "Miyamoto-Nagai Disk";
+  bool enabled = false;
+  glm::dvec3 center = glm::dvec3(0.0);
+  double mass = 1.0;
+  double scale_length = 5.0; // a, AU
+  double scale_height = 0.5; // b, AU
+
+  double G = 0.0;
+  bool prepare(const ForceContext &ctx);
+  glm::dvec3 operator()(size_t i, const CelestialBody &body) const;
+};
+
+// resolves a term's source body, falling back to the heaviest one
+inline size_t resolve_source(const ForceContext &ctx, BodyHandle source) {
+  const size_t index = ctx.index_of(source);
+  return index != SIZE_MAX ? index : ctx.heaviest;
+}
+
+inline bool PostNewtonian::prepare(const ForceContext &ctx) {
+  context = &ctx;
+  return !ctx.black_holes.empty();
+}
+
+FORCE_TERM glm::dvec3 PostNewtonian::operator()(size_t, const CelestialBody &body) const {
+  glm::dvec3 acc(0.0);
+  if (body.is_black_hole) return acc;
+  const double c_sq = context->c * context->c;
+
+  for (size_t k : context->black_holes) {
+    const CelestialBody &bh = context->bodies[k];
+    const double rs = (2.0 * context->G * bh.mass) / c_sq;
+
+    glm::dvec3 r = body.position - bh.position;
+    double distance = glm::length(r);
+    if (distance < 100.0 * rs) continue;
+    if (distance < 1e-10)      continue;
+
+    // glm::normalize as in the pass this term replaced, so a single black hole gives the same bits
+    double correction = (3.0 * context->G * bh.mass) / (c_sq * distance);
+    acc += correction * glm::length2(body.velocity) * glm::normalize(r);
+  }
+  return acc;
+}
+
+inline bool J2Oblateness::prepare(const ForceContext &ctx) {
+  if (ctx.bodies.empty()) return false;
+  center_index = resolve_source(ctx, source);
+  center = ctx.bodies[center_index].position;
+  strength = 1.5 * j2 * ctx.G * ctx.bodies[center_index].mass * equatorial_radius * equatorial_radius;
+  pole = glm::normalize(pole);
+  return strength != 0.0;
+}
+
+// a = 3/2 J2 mu R^2 / r^5 ((5 z^2 / r^2 - 1) r - 2 z k) with z = r.k
+FORCE_TERM glm::dvec3 J2Oblateness::operator()(size_t i, const CelestialBody &body) const {
+  if (i == center_index) return glm::dvec3(0.0);
+  const glm::dvec3 r = body.position - center;
+  const double r_sq = glm::length2(r);
+  if (r_sq < 1e-12) return glm::dvec3(0.0);
+
+  const double z = glm::dot(r, pole);
+  const double inv_r5 = 1.0 / (r_sq * r_sq * std::sqrt(r_sq));
+  return strength * inv_r5 * ((5.0 * z * z / r_sq - 1.0) * r - 2.0 * z * pole);
+}
+
+inline bool RadiationPressure::prepare(const ForceContext &ctx) {
+  if (ctx.bodies.empty()) return false;
+  center_index = resolve_source(ctx, source);
+  center = ctx.bodies[center_index].position;
+  center_velocity = ctx.bodies[center_index].velocity;
+  mu = beta * ctx.G * ctx.bodies[center_index].mass;
+  c = ctx.c;
+  return mu != 0.0;
+}
+
+// a = beta mu / r^2 ((1 - rdot / c) r_hat - v / c), the drag terms are the P-R part
+FORCE_TERM glm::dvec3 RadiationPressure::operator()(size_t i, const CelestialBody &body) const {
+  if (i == center_index || body.mass > max_mass) return glm::dvec3(0.0);
+  const glm::dvec3 r = body.position - center;
+  const double r_sq = glm::length2(r);
+  if (r_sq < 1e-12) return glm::dvec3(0.0);
+
+  const glm::dvec3 r_hat = r / std::sqrt(r_sq);
+  const glm::dvec3 v = body.velocity - center_velocity;
+  return mu / r_sq * ((1.0 - glm::dot(v, r_hat) / c) * r_hat - v / c);
+}
+
+inline bool Yarkovsky::prepare(const ForceContext &ctx) {
+  if (ctx.bodies.empty()) return false;
+  center_index = resolve_source(ctx, source);
+  center = ctx.bodies[center_index].position;
+  center_velocity = ctx.bodies[center_index].velocity;
+  return a2 != 0.0;
+}
+
+FORCE_TERM glm::dvec3 Yarkovsky::operator()(size_t i, const CelestialBody &body) const {
+  if (i == center_index || body.mass > max_mass) return glm::dvec3(0.0);
+  const double r_sq = glm::length2(body.position - center);
+  const glm::dvec3 v = body.velocity - center_velocity;
+  const double speed = glm::length(v);
+  if (r_sq < 1e-12 || speed == 0.0) return glm::dvec3(0.0);
+  return (a2 / r_sq / speed) * v;
+}
+
+inline bool NfwHalo::prepare(const ForceContext &ctx) {
+  G = ctx.G;
+  return scale_radius > 0.0 && mass_scale != 0.0;
+}
+
+FORCE_TERM glm::dvec3 NfwHalo::operator()(size_t, const CelestialBody &body) const {
+  const glm::dvec3 r = body.position - center;
+  const double r_sq = glm::length2(r);
+  if (r_sq < 1e-12) return glm::dvec3(0.0);
+
+  const double distance = std::sqrt(r_sq);
+  const double x = distance / scale_radius;
+  const double enclosed = mass_scale * (std::log1p(x) - x / (1.0 + x));
+  return -G * enclosed / (r_sq * distance) * r;
+}
+
+inline bool MiyamotoNagaiDisk::prepare(const ForceContext &ctx) {
+  G = ctx.G;
+  return mass != 0.0;
+}
+
+FORCE_TERM glm::dvec3 MiyamotoNagaiDisk::operator()(size_t, const CelestialBody &body) const {
+  const glm::dvec3 r = body.position - center;
+  const double zb = std::sqrt(r.z * r.z + scale_height * scale_height);
+  const double az = scale_length + zb;
+  const double d_sq = r.x * r.x + r.y * r.y + az * az;
+  const double f = -G * mass / (d_sq * std::sqrt(d_sq));
+  return glm::dvec3(f * r.x, f * r.y, f * r.z * az / zb);
+}
+
+// The term list is fixed at compile time, so every enabled term is evaluated back to back
+// in a single pass over the bodies and summed before the acceleration is touched once.
+// Terms are toggled at run time; a disabled term costs one predictable branch per body.
+template <typename... Terms>
+class ForcePipeline {
+public:
+  static constexpr size_t size() { return sizeof...(Terms); }
+  static constexpr std::array<const char *, sizeof...(Terms)> names() { return {Terms::name...}; }
+
+  template <typename Term> Term &get() { return std::get<Term>(terms); }
+  template <typename Term> const Term &get() const { return std::get<Term>(terms); }
+
+  bool is_enabled(size_t k) const {
+    return std::apply([&](const auto &...term) { return std::array<bool, size()>{term.enabled...}[k]; }, terms);
+  }
+
+  void set_enabled(size_t k, bool enabled) {
+    size_t index = 0;
+    std::apply([&](auto &...term) { ((index++ == k ? void(term.enabled = enabled) : void()), ...); }, terms);
+  }
+
+  // for_each(count, fn) must call fn(i) for every body i and add the result to its
+  // acceleration; the caller decides how that pass is split over threads
+  template <typename ForEach>
+  bool apply(const ForceContext &ctx, ForEach &&for_each) {
+    const auto active = std::apply([&](auto &...term) {
+      return std::array<bool, size()>{(term.enabled && term.prepare(ctx))...};
+    }, terms);
+    bool any = false;
+    for (bool on : active) any = any || on;
+    if (!any) return false;
+
+    for_each(ctx.bodies.size(), [&](size_t i) {
+      return evaluate(i, ctx.bodies[i], active, std::index_sequence_for<Terms...>{});
+    });
+    return true;
+  }
+
+private:
+  template <size_t... K>
+  glm::dvec3 evaluate(size_t i, const CelestialBody &body, const std::array<bool, sizeof...(Terms)> &active,
+                      std::index_sequence<K...>) const {
+    glm::dvec3 sum(0.0);
+    ((active[K] ? void(sum += std::get<K>(terms)(i, body)) : void()), ...);
+    return sum;
+  }
+
+  std::tuple<Terms...> terms;
+};
+
+#endif
@@ -10,11 +10,14 @@
 
 #define UI_WIDTH         350.0f
 #define MIN_SLIDER_WIDTH 150.0f
+#define LISTED_BODIES    64 // editors shown under Celestial Bodies, generated scenes run to millions
+static_assert(LISTED_BODIES <= SNAPSHOT_BODIES, "the body list reads from the published bodies");
 
 void initialize_imgui(GLFWwindow *window);
 void render_gui(AppState &app);
-void render_body_editor(CelestialBody &body, int index);
+void render_body_editor(AppState &app, const CelestialBody &body, BodyHandle handle);
 void render_simulation_stats(AppState &app, double frame_time);
 void render_camera_info(Camera &camera);
+void render_porkchop_window(AppState &app);
 
 #endif
\ No newline at end of file
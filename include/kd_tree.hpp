@@ -0,0 +1,80 @@
+#ifndef KD_TREE_HPP
+#define KD_TREE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+
+#define KD_TREE_LEAF_SIZE 16     // leaves hold between half and all of this many points
+#define KD_TREE_PARALLEL_DEPTH 5 // levels whose two halves are built as separate tasks
+#define KD_TREE_MAX_NEIGHBOURS 64 // largest k of a nearest-neighbour query
+
+struct KdNode {
+  glm::dvec3 lo, hi;   // bounds of the points below
+  double reach;        // largest reach of the points below
+  uint32_t begin, end; // run of slots owned by the node
+};
+
+// Balanced kd-tree over a point set, split at the median of the widest axis. Nodes sit in
+// heap order (children of k at 2k + 1 and 2k + 2), every leaf is at the same depth and
+// every node owns a contiguous run of slots, so the tree needs no pointers and both
+// halves of a node build in parallel. Points may carry a reach radius; nodes keep the
+// largest reach below them, so symmetric queries ("closer than either radius") prune as
+// tightly as one-sided ones.
+class KdTree {
+public:
+  void build(const std::vector<glm::dvec3> &points, const std::vector<double> &reach = {});
+
+  // visit(slot, distance_sq) for every point closer to p than max(radius, its own reach)
+  template <typename Visit> void for_each_within(const glm::dvec3 &p, double radius, Visit &&visit) const;
+  // distance to the k-th nearest point, counting p itself when it is one of the points;
+  // INFINITY when there are fewer than k points
+  double nearest_distance(const glm::dvec3 &p, unsigned k) const;
+
+  uint32_t original(uint32_t slot) const; // index of the slot's point in the vector given to build
+  const std::vector<uint32_t> &get_order() const;
+  size_t size() const;
+
+private:
+  void build_node(size_t node, int depth, const std::vector<glm::dvec3> &source, const std::vector<double> &source_reach);
+
+  std::vector<KdNode> nodes;
+  std::vector<uint32_t> order;    // slot -> original index
+  std::vector<glm::dvec3> points; // in slot order, queries read them sequentially per leaf
+  std::vector<double> reach;
+  int depth = 0;                  // leaves live at this depth
+  size_t first_leaf = 0;
+};
+
+template <typename Visit>
+void KdTree::for_each_within(const glm::dvec3 &p, double radius, Visit &&visit) const {
+  if (points.empty()) return;
+
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const uint32_t id = stack[--top];
+    const KdNode &node = nodes[id];
+    if (node.begin == node.end) continue;
+
+    const double limit = std::max(radius, node.reach);
+    const glm::dvec3 outside = glm::max(glm::max(node.lo - p, p - node.hi), glm::dvec3(0.0));
+    if (glm::length2(outside) >= limit * limit) continue;
+
+    if (id < first_leaf) {
+      stack[top++] = 2 * id + 2;
+      stack[top++] = 2 * id + 1;
+      continue;
+    }
+    for (uint32_t slot = node.begin; slot < node.end; ++slot) {
+      const double distance_sq = glm::length2(points[slot] - p);
+      const double own = std::max(radius, reach[slot]);
+      if (distance_sq < own * own) visit(slot, distance_sq);
+    }
+  }
+}
+
+#endif
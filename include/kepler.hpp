@@ -0,0 +1,32 @@
+#ifndef KEPLER_HPP
+#define KEPLER_HPP
+
+#include <glm/glm.hpp>
+
+#define LAMBERT_MAX_REVOLUTIONS 4
+#define LAMBERT_MAX_SOLUTIONS (2 * LAMBERT_MAX_REVOLUTIONS + 1)
+
+struct KeplerState {
+  glm::dvec3 position;
+  glm::dvec3 velocity;
+};
+
+struct LambertSolution {
+  glm::dvec3 departure_velocity;
+  glm::dvec3 arrival_velocity;
+  int revolutions;
+};
+
+// Two-body state after dt (either sign), universal variables with Stumpff functions and
+// bracketed Newton on the universal anomaly; ellipses, parabolas and hyperbolas alike.
+// Elliptic spans are first reduced modulo the period.
+KeplerState propagate_kepler(const KeplerState &state, double mu, double dt);
+
+// Izzo (2015): every prograde transfer from r1 to r2 in time of flight tof, the
+// zero-revolution one and for each N up to max_revolutions the left and right branches that
+// exist. Householder iterations on Lancaster-Blanchard's x, so a few evaluations per branch.
+// Returns the number of solutions written, at most LAMBERT_MAX_SOLUTIONS.
+int solve_lambert(const glm::dvec3 &r1, const glm::dvec3 &r2, double tof, double mu, int max_revolutions,
+                  LambertSolution *solutions);
+
+#endif
@@ -1,26 +1,36 @@
 #ifndef MAINLOOP_HPP
 #define MAINLOOP_HPP
 
+#include <memory>
 #include <GLFW/glfw3.h>
+#include "physics_thread.hpp"
+#include "porkchop.hpp"
 #include "simulation.hpp"
 #include "camera.hpp"
 
 #define MAX_BODIES 20
+static_assert(MAX_BODIES <= SNAPSHOT_BODIES, "the renderer draws from the published bodies");
 
 struct AppState{
-  Simulation simulation;
+  PhysicsThread *physics;
+  const SimulationSnapshot *snapshot; // latest published state, refreshed every frame
   Camera *camera;
   bool is_mouse_captured;
   bool is_paused;
   bool gui_visible;
   float simulation_speed=1.0f;
+  bool time_warp=false;
   double lastX;
   double lastY;
   bool first_mouse;
+  std::shared_ptr<const PorkchopGrid> porkchop; // grid the heatmap shows, from a snapshot
+  unsigned int porkchop_texture = 0;           // created with the first grid
+  bool porkchop_pending = false;               // requested, not yet published
   struct {
     bool show_help;
     bool show_stats;
     bool show_caminfo;
+    bool show_porkchop=false;
     bool lighting_enabled=true;
     struct {
       float mass=0.1f;
@@ -28,6 +38,33 @@ struct AppState{
       glm::vec3 color=glm::vec3(1.0f, 0.0f, 0.0f);
       bool is_black_hole=false;
     } body_editor;
+    struct {
+      float mass=2.5e-5f;        // of the planet, Io's is 4.7e-5
+      float distance=2.8e-3f;    // AU
+    } moon_editor;
+    struct {
+      int particles=100000;
+      bool shearing_sheet=false;
+    } ring_editor;
+    struct {
+      int particles=20000;
+    } gas_editor;
+    struct {
+      int count=1000;
+      float excess_speed=3.0f; // km/s
+    } probe_editor;
+    struct {
+      int members=256;
+      float sigma=1e-6f;
+      float span=365.0f; // days
+      float step=0.05f;
+    } ensemble_editor;
+    struct {
+      int preset=0;
+      int bodies=100000;
+      int seed=1;
+    } scene_editor;
+    PorkchopConfig porkchop_editor;
   } gui_props;
 };
 
@@ -0,0 +1,33 @@
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct CelestialBody;
+
+#define MORTON_BITS 21 // per axis, 63-bit keys
+#define RADIX_BITS 11  // 6 passes over 63 bits
+
+struct MortonEntry {
+  uint64_t key;
+  uint32_t index; // dense body index the key was computed from
+};
+
+// z-order keys of all bodies inside their bounding cube. A reorder sorts them and leaves
+// them current, indexing the new dense order; the tree rebuild that follows consumes them
+// instead of computing and sorting the same keys again
+struct MortonKeys {
+  glm::dvec3 origin = glm::dvec3(0.0); // min corner of the bounding cube
+  double size = 0.0;                   // edge length of the bounding cube
+  std::vector<MortonEntry> entries;
+  bool current = false;                // sorted and indexing the dense order as it is now
+};
+
+uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z);
+void compute_morton_keys(const std::vector<CelestialBody> &bodies, MortonKeys &keys);
+void sort_morton_keys(MortonKeys &keys, std::vector<MortonEntry> &scratch);
+void radix_sort_entries(std::vector<MortonEntry> &entries, std::vector<MortonEntry> &scratch, unsigned key_bits);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef OCTREE_HPP
+#define OCTREE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "morton.hpp"
+
+struct CelestialBody;
+
+#define OCTREE_LEAF_SIZE 8       // default bodies per leaf before it is split
+#define OCTREE_THETA 0.5         // opening angle, node size / distance
+#define OCTREE_REBUILD_RATIO 1.5 // rebuild once refitted node sizes sum to this multiple of the fresh tree's
+
+struct OctreeNode {
+  glm::dvec3 lo, hi; // tight bounds of the bodies below, recomputed by every refit
+  glm::dvec3 center_of_mass;
+  double mass;
+  uint32_t first;    // first child node, or first entry in the index list for a leaf
+  uint32_t count;    // child nodes, or bodies for a leaf
+  bool leaf;
+};
+
+struct OctreeStats {
+  uint64_t rebuilds = 0;
+  uint64_t refits = 0;
+  bool rebuilt_last_step = false;
+  double build_seconds = 0.0; // last rebuild, including the key sort
+  double refit_seconds = 0.0; // last refit
+  double quality = 1.0;       // summed node size relative to the tree right after its rebuild
+  size_t node_count = 0;
+};
+
+// Barnes-Hut tree over the bodies. The topology comes from the sorted Morton keys and is
+// kept across steps; every step only refits bounds and moments bottom-up, one parallel
+// pass per depth. Refitting is always correct since bounds come from the current
+// positions, but nodes swell as bodies drift apart, so the tree is rebuilt once that
+// makes the walk noticeably more expensive.
+class Octree {
+public:
+  // refit, or rebuild first when bodies were added/removed/reordered or quality degraded;
+  // a rebuild uses keys as given when they are current, otherwise recomputes and sorts them
+  void update(const std::vector<CelestialBody> &bodies, MortonKeys &keys, std::vector<MortonEntry> &scratch);
+  void invalidate();
+  void set_leaf_size(uint32_t size);
+  uint32_t get_leaf_size() const;
+  // softening, when given, holds the kernel support of every body: pairs use the larger of
+  // both, nodes that of body i
+  glm::dvec3 acceleration(const std::vector<CelestialBody> &bodies, size_t i, double G,
+                          const std::vector<double> *softening = nullptr) const;
+  const OctreeStats &get_stats() const;
+
+private:
+  void build(const MortonKeys &keys);
+  void build_node(uint32_t id, const std::vector<MortonEntry> &entries, size_t begin, size_t end, int shift,
+                  uint32_t depth);
+  void refit(const std::vector<CelestialBody> &bodies);
+
+  std::vector<OctreeNode> nodes;
+  std::vector<uint32_t> indices;             // body indices in Morton order, each leaf owns a contiguous run
+  std::vector<std::vector<uint32_t>> levels; // node ids by depth, refit walks them deepest first
+  size_t body_count = 0;
+  uint32_t leaf_size = OCTREE_LEAF_SIZE;
+  bool valid = false;
+  double built_size = 0.0; // summed node size right after the last rebuild, 0 until the first refit
+  OctreeStats stats;
+};
+
+#endif
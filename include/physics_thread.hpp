@@ -0,0 +1,149 @@
+#ifndef PHYSICS_THREAD_HPP
+#define PHYSICS_THREAD_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "autotuner.hpp"
+#include "command_queue.hpp"
+#include "ensemble.hpp"
+#include "porkchop.hpp"
+#include "scheduler.hpp"
+#include "simulation.hpp"
+#include "triple_buffer.hpp"
+
+#define PHYSICS_DT 0.01          // fixed step, real seconds (scaled by simulation speed)
+#define PHYSICS_MAX_CATCHUP 0.25 // longest stretch of real time simulated in one tick
+#define WARP_TARGET_FPS 60.0     // time warp shrinks its budget while frames take longer than this
+#define WARP_MIN_BUDGET 0.0005   // seconds of physics per tick the time warp always keeps
+#define SNAPSHOT_BODIES 64       // bodies copied into a snapshot, the renderer and the body list read no further
+
+// immutable copy of everything the renderer and GUI read from the simulation
+struct SimulationSnapshot {
+  size_t body_count = 0;              // in the simulation, bodies holds the first SNAPSHOT_BODIES of them
+  std::vector<CelestialBody> bodies;
+  std::vector<BodyHandle> handles; // parallel to bodies
+  std::vector<CelestialBody> satellites; // subsystem members in world coordinates, drawn after bodies
+  std::vector<RingStats> rings;
+  bool has_gas = false;
+  GasStats gas;
+  int gas_body = -1;       // dense index of the disk's host, -1 without a disk
+  double gas_radius = 0.0; // extent of the density map
+  std::vector<float> gas_density_map; // SPH_MAP_RADIAL x SPH_MAP_ANGULAR, radial-major
+  double G = DEFAULT_G;
+  double time = 0.0;
+  uint64_t step_count = 0;
+  uint64_t state_hash = 0;
+  bool deterministic = false;
+  PrecisionMode precision = PrecisionMode::DOUBLE;
+  ForceSolver force_solver = ForceSolver::DIRECT;
+  ForceKernel force_kernel = ForceKernel::SERIAL; // what runs after the overriding modes
+  bool direct_supported = true; // false above DIRECT_MAX_BODIES
+  unsigned thread_count = 1;
+  int reorder_interval = 0;
+  OctreeStats tree_stats;
+  PeriodicConfig periodic;
+  DisruptionConfig disruption;
+  DisruptionStats disruption_stats;
+  size_t test_particles = 0;
+  size_t probes = 0;
+  ProbeStats probe_stats;
+  bool adaptive_softening = false;
+  SofteningStats softening;
+  bool variational = false;
+  bool variational_supported = true; // by the current kernel, precision and softening
+  ChaosIndicators chaos;
+  std::array<bool, ExternalForces::size()> external_forces = {}; // in ExternalForces::names() order
+  bool auto_tune = false;
+  bool tuning_supported = true; // no mode overrides the candidate kernels
+  double tuning_accuracy = AUTOTUNE_ACCURACY;
+  bool has_tuning_result = false;
+  TuningResult tuning_result;
+  double steps_per_second = 0.0;
+  bool time_warp = false;
+  double achieved_warp = 0.0;  // simulated time per real second, at speed 1 this is 1
+  double physics_budget = 0.0; // seconds of stepping allowed per tick in time warp
+  bool has_force_error_report = false;
+  ForceErrorReport force_error_report = {0.0, 0.0, 0.0, 0.0};
+  bool has_ensemble_report = false;
+  EnsembleReport ensemble_report;
+  bool ensemble_running = false;
+  double ensemble_progress = 0.0; // fraction of the running ensemble's steps done
+  std::shared_ptr<const PorkchopGrid> porkchop; // last computed, shared so a tick does not copy the grid
+};
+
+// An ensemble run on its own copy of the bodies, stepped a slice at a time on the scheduler.
+// Each slice submits the next one before it leaves the group, so the group drains only when
+// the run is finished or cancelled.
+struct EnsembleJob {
+  EnsembleJob(Ensemble ensemble, double span, int steps)
+      : ensemble(std::move(ensemble)), span(span), steps(steps), start(std::chrono::steady_clock::now()) {}
+
+  Ensemble ensemble;
+  double span;
+  int steps;
+  int slice_steps = 1;
+  std::chrono::steady_clock::time_point start;
+  std::atomic<int> steps_done{0};
+  std::atomic<bool> cancel{false};
+  TaskGroup group;
+};
+
+// Owns the Simulation and steps it on its own thread with a fixed-timestep accumulator,
+// publishing a snapshot through a triple buffer after every tick. Render FPS and
+// simulation rate are independent; a slow frame never starves physics or vice versa.
+// Normally speed scales the step size. In time warp the step stays PHYSICS_DT and speed
+// sets how many steps are owed per second instead, paid out as far as a per-tick CPU budget
+// allows; the budget follows the render frame time so the target frame rate holds.
+class PhysicsThread {
+public:
+  PhysicsThread();
+  ~PhysicsThread();
+  PhysicsThread(const PhysicsThread &) = delete;
+  PhysicsThread &operator=(const PhysicsThread &) = delete;
+
+  const SimulationSnapshot &latest();
+  void submit(const SimulationCommand &command);
+  void set_paused(bool paused);
+  void set_speed(float speed);
+  void set_time_warp(bool enabled);
+  void set_frame_time(double seconds);
+
+private:
+  void run();
+  void apply_commands();
+  void apply(const SimulationCommand &command);
+  int step_time_warp(double &accumulator, std::chrono::steady_clock::time_point tick_start);
+  void adapt_budget();
+  void run_ensemble(size_t members, double sigma, double span, double step);
+  void poll_ensemble();
+  void publish();
+
+  Simulation simulation;
+  Autotuner autotuner;
+  bool auto_tune = false;
+  TripleBuffer<SimulationSnapshot> snapshots;
+  MpscQueue<SimulationCommand, COMMAND_QUEUE_CAPACITY> commands;
+  std::atomic<bool> running{true};
+  std::atomic<bool> paused{false};
+  std::atomic<float> speed{1.0f};
+  std::atomic<bool> time_warp{false};
+  std::atomic<double> frame_time{0.0};
+  double steps_per_second = 0.0;
+  double achieved_warp = 0.0;
+  double budget = PHYSICS_DT;
+  double step_seconds = 0.0; // smoothed cost of one step, sizes the time-warp batches
+  bool has_force_error_report = false;
+  ForceErrorReport force_error_report = {0.0, 0.0, 0.0, 0.0};
+  bool has_ensemble_report = false;
+  EnsembleReport ensemble_report;
+  std::unique_ptr<EnsembleJob> ensemble_job;
+  std::shared_ptr<const PorkchopGrid> porkchop;
+  std::thread thread;
+};
+
+#endif
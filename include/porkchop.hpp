@@ -0,0 +1,44 @@
+#ifndef PORKCHOP_HPP
+#define PORKCHOP_HPP
+
+#include <vector>
+#include "celestial_body.hpp"
+#include "kepler.hpp"
+
+#define PORKCHOP_MAX_CELLS 512      // grid lines per axis
+#define PORKCHOP_RANGE 4.0          // colour scale spans the best delta-v to this many times it
+#define KM_S_PER_AU_DAY 1731.45683681
+
+// bodies by handle, so a grid still names the right ones after others were added or removed
+struct PorkchopConfig {
+  BodyHandle central = {}; // an invalid handle is the heaviest body
+  BodyHandle departure = {};
+  BodyHandle arrival = {};
+  double departure_start = 0.0; // days after the state the grid is computed from
+  double departure_span = 730.0;
+  double arrival_start = 100.0;
+  double arrival_span = 900.0;
+  int departures = 128; // grid columns
+  int arrivals = 128;   // grid rows
+  int max_revolutions = 0;
+};
+
+struct PorkchopGrid {
+  PorkchopConfig config;                  // as computed, central resolved
+  std::vector<float> delta_v;             // arrivals x departures, departure fastest; AU/day, NaN without a transfer
+  float min_delta_v = 0.0f;
+  int best_departure = -1, best_arrival = -1;
+  int best_revolutions = 0;
+  double seconds = 0.0;
+};
+
+// Departure and arrival delta-v (hyperbolic excess at both ends) of the cheapest prograde
+// Lambert transfer for every departure x arrival date. The two bodies' states come from a
+// two-body ephemeris about the central body, propagated from the given state once per grid
+// line and cached, so no cell re-runs the N-body integration; perturbations over the window
+// are neglected. Rows are solved in parallel. handles is parallel to bodies, as in a
+// snapshot; returns false if the config's handles do not resolve to three distinct bodies.
+bool compute_porkchop(const std::vector<CelestialBody> &bodies, const std::vector<BodyHandle> &handles, double G,
+                      const PorkchopConfig &config, PorkchopGrid &grid);
+
+#endif
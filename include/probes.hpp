@@ -0,0 +1,58 @@
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+#include <cstdint>
+#include <vector>
+#include "celestial_body.hpp"
+#include "kepler.hpp"
+
+#define PROBE_PRIMARIES 32          // heaviest bodies that get a sphere of influence
+#define PROBE_MIN_MASS_RATIO 1e-12  // of the heaviest body, lighter ones get none
+#define PROBE_MAX_TRANSITIONS 8     // sphere-of-influence changes per probe per span
+#define PROBE_SOI_DEPTH 8           // halvings of a span before a possible crossing is given up as missed
+#define PROBE_BISECTIONS 60
+#define PROBE_TIME_TOLERANCE 1e-10  // of the span, a crossing is located to this
+#define PROBE_SOI_HYSTERESIS 1e-6   // relative margin on leaving, so a probe on the boundary does not flip back
+#define PROBE_LAUNCH_FAN 0.5        // radians a launched batch spreads over
+
+// a massless craft on a conic about the body whose sphere of influence it is in
+struct Probe {
+  BodyHandle primary;
+  KeplerState relative;  // to the primary
+  glm::dvec3 position;   // absolute, refreshed after every span
+  glm::dvec3 velocity;
+};
+
+struct ProbeStats {
+  uint64_t transitions = 0;
+  double seconds = 0.0; // last span
+};
+
+// One primary of the patched-conic hierarchy. Radii are Laplace's a (m / M)^(2/5) about
+// the parent, with the instantaneous distance for a; the root has no parent and no edge.
+struct SoiNode {
+  size_t index;          // dense body index
+  size_t parent;         // node index, SIZE_MAX at the root
+  double radius;
+  double mu;             // G m, what a probe inside orbits
+  double pair_mu;        // G (m + M), the node's own orbit about its parent
+  KeplerState relative;  // to the parent at the end of the span
+  KeplerState start;     // and at its start, the same orbit run back
+  double max_speed;      // about the parent, at periapsis
+};
+
+// primaries heaviest first, nodes in the same order so parents precede children
+void build_soi_tree(const std::vector<CelestialBody> &bodies, const std::vector<size_t> &primaries, double G, double span,
+                    std::vector<SoiNode> &tree);
+// deepest node whose sphere holds the point
+size_t soi_containing(const std::vector<SoiNode> &tree, const std::vector<CelestialBody> &bodies, const glm::dvec3 &position);
+
+// Propagates a probe over span as a Kepler orbit about node, ending at the end of the span
+// that the tree describes. Leaving the node's sphere or entering a child's is an event on
+// the distance along both conics, the children's run back from their end state: intervals
+// that the speeds rule out are skipped, the rest halved until the first bracket, which is
+// bisected. The state then moves into the new primary's frame and the remainder is
+// propagated from there. Returns the number of transitions.
+int propagate_patched_conic(const std::vector<SoiNode> &tree, size_t &node, KeplerState &relative, double span);
+
+#endif
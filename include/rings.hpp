@@ -0,0 +1,109 @@
+#ifndef RINGS_HPP
+#define RINGS_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "celestial_body.hpp"
+#include "morton.hpp"
+
+#define RING_INNER_RADIUS 4.98e-4           // AU, inner edge of Saturn's C ring
+#define RING_OUTER_RADIUS 9.14e-4           // AU, outer edge of the A ring
+#define RING_OPTICAL_DEPTH 0.5              // normal optical depth, sets the particle size of a global ring
+#define RING_RESTITUTION 0.5                // normal coefficient of restitution
+#define RING_SHEET_PARTICLE_RADIUS 6.68e-12 // AU, metre-sized boulders in the shearing sheet
+#define RING_STEPS_PER_ORBIT 100            // substeps per orbit at the inner edge, or at the sheet radius
+#define RING_CHUNK 4096                     // particles per parallel task
+
+enum class RingGeometry { GLOBAL, SHEARING_SHEET };
+
+struct RingParticle {
+  glm::dvec3 position; // host frame, or sheet frame: x radial, y along the orbit, z out of the plane
+  glm::dvec3 velocity;
+  glm::dvec3 acceleration;
+};
+
+struct RingConfig {
+  RingGeometry geometry = RingGeometry::GLOBAL;
+  size_t particles = 100000;
+  double inner_radius = RING_INNER_RADIUS;
+  double outer_radius = RING_OUTER_RADIUS; // the sheet sits halfway between both edges
+  double optical_depth = RING_OPTICAL_DEPTH;
+  double restitution = RING_RESTITUTION;
+  double particle_radius = 0.0; // 0 = from the optical depth for a global ring, RING_SHEET_PARTICLE_RADIUS in the sheet
+  uint64_t seed = 1;
+};
+
+struct RingStats {
+  RingGeometry geometry = RingGeometry::GLOBAL;
+  size_t particles = 0;
+  size_t collisions = 0;           // during the last substep
+  double collision_seconds = 0.0;  // cell list build and resolution of the last substep
+  double velocity_dispersion = 0.0; // RMS speed relative to circular orbits (global) or the shear flow (sheet)
+  double particle_radius = 0.0;
+};
+
+// Test particles around a subsystem's planet that collide inelastically with each other.
+// A global ring lives in the host's barycentric frame and feels the subsystem members
+// plus the tidal field of the rest of the system. A shearing sheet is a small co-rotating
+// patch at one orbital radius, moved with the exact solution of Hill's equations and
+// wrapped with shear-periodic boundaries; it feels only the planet.
+//
+// Collisions use a cell list rebuilt every substep: particles are radix sorted by a
+// hashed cell index into a table twice their number, so memory and work stay linear
+// however spread out the ring is. Resolution is Jacobi style: every particle sums the
+// impulses of all its contacts from the velocities before the pass and writes only its
+// own result, so it runs in parallel without locks, momentum is conserved pair by pair
+// and the outcome does not depend on the thread count.
+class RingSystem {
+public:
+  RingSystem(const RingConfig &config, double planet_mass, double G);
+
+  // global rings only, gravity of the members and the tidal field at the current positions
+  void accelerate(const std::vector<CelestialBody> &members, const glm::dmat3 &tidal, double G);
+  void drift(double dt); // half kick and drift, or the exact epicycle in the sheet
+  void kick(double dt);  // closing half kick, nothing in the sheet
+  void collide();
+  void shift_frame(const glm::dvec3 &offset, const glm::dvec3 &drift); // the host barycentre moved by this, global rings only
+
+  double get_step() const; // longest substep that still resolves the orbits
+  const std::vector<RingParticle> &get_particles() const;
+  const RingStats &get_stats() const;
+
+private:
+  glm::ivec3 cell_of(const glm::dvec3 &position) const;
+  glm::ivec3 wrap(glm::ivec3 cell) const;
+  uint32_t bucket_of(glm::ivec3 cell) const;
+  void build_cells();
+  size_t resolve(size_t i, glm::dvec3 &delta) const;
+  glm::dvec3 drift_velocity(const RingParticle &particle) const;
+
+  RingConfig config;
+  std::vector<RingParticle> particles;
+  double planet_mu;       // G M of the planet when the ring was made
+  double radius;          // every particle has the same size and mass
+  double omega;           // orbital frequency at the sheet radius, or at the inner edge
+  glm::dvec3 box = glm::dvec3(0.0); // sheet extent in x and y
+  double sheet_time = 0.0;  // since the sheet was made
+  double sheet_shift = 0.0; // y offset of the radially adjacent images, grows with the shear
+
+  glm::dvec3 cell_size = glm::dvec3(0.0);
+  int wrap_cells = 0; // cells along y in the sheet, 0 = unbounded
+  uint32_t bucket_mask = 0;
+  glm::ivec3 grid_origin = glm::ivec3(0); // lowest occupied cell minus one, refreshed every build
+  glm::uvec3 grid_extent = glm::uvec3(1);
+  std::vector<MortonEntry> cell_entries;  // bucket keys, sorted
+  std::vector<MortonEntry> cell_scratch;
+  std::vector<glm::uvec2> buckets;         // [first, last) particle of every bucket after the sort
+  std::vector<glm::ivec3> cells;           // cell of every particle, parallel to particles
+  std::vector<glm::ivec3> cell_scratch_coords;
+  std::vector<std::pair<glm::ivec3, glm::ivec3>> chunk_bounds;
+  std::vector<RingParticle> particle_scratch;
+  std::vector<glm::dvec3> velocity_scratch;
+  std::vector<size_t> chunk_collisions;
+  std::vector<double> chunk_dispersion;
+  RingStats stats;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SCENES_HPP
+#define SCENES_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "celestial_body.hpp"
+
+#define SCENE_CHUNK 16384 // bodies per parallel task
+
+enum class ScenePreset { PLUMMER, EXPONENTIAL_DISK, ASTEROID_BELT, OORT_CLOUD, COLLIDING_GALAXIES };
+
+struct SceneConfig {
+  ScenePreset preset = ScenePreset::PLUMMER;
+  size_t bodies = 100000;
+  uint64_t seed = 1;
+  double scale = 0.0; // AU, 0 = the preset's own: Plummer radius, disk scale length, belt or cloud inner edge
+  double mass = 0.0;  // solar masses of the cluster, of each disk or of the star, 0 = the preset's own
+};
+
+// Philox4x32-10 (Salmon et al. 2011): a keyed bijection of a 128-bit counter. The counter
+// holds the body index and a block number, so every body draws from its own stream and
+// the numbers it gets depend only on the seed and its index, never on the thread or the
+// order in which bodies are generated.
+class CounterRandom {
+public:
+  CounterRandom(uint64_t seed, uint64_t index);
+  double uniform(); // open interval (0, 1), 32 bits
+  double normal();  // Box-Muller
+
+private:
+  std::array<uint32_t, 4> next_block();
+
+  std::array<uint32_t, 2> key;
+  uint64_t index;
+  uint32_t block = 0;
+  std::array<uint32_t, 4> buffer = {};
+  unsigned used = 4;
+  double spare = 0.0;
+  bool has_spare = false;
+};
+
+// fills bodies (replacing its contents) in parallel chunks; bit-identical for any thread count
+void generate_scene(const SceneConfig &config, double G, std::vector<CelestialBody> &bodies);
+const char *scene_name(ScenePreset preset);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef SCHEDULER_PIN_THREADS
+#define SCHEDULER_PIN_THREADS 0 // pin worker k to core k + 1, build with -DSCHEDULER_PIN_THREADS=1
+#endif
+
+// counts outstanding tasks; Scheduler::wait() on it helps run work instead of blocking
+struct TaskGroup {
+  std::atomic<size_t> pending{0};
+};
+
+// Work-stealing pool shared by everything that wants parallelism (force kernels,
+// ensembles, tree builds, initial conditions, export). Each worker owns a deque:
+// it pushes and pops its own end, idle workers steal from the other end. Tasks
+// submitted from outside the pool go to an injection queue. Waiting threads
+// execute pending tasks, so nested parallel_for calls cannot deadlock.
+class Scheduler {
+public:
+  explicit Scheduler(unsigned worker_count, bool pin_threads = false);
+  ~Scheduler();
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // workers plus the calling thread, which always participates in wait()
+  unsigned concurrency() const;
+
+  void submit(TaskGroup &group, std::function<void()> work);
+  void wait(TaskGroup &group);
+
+  // body(chunk_begin, chunk_end) over [begin, end) in chunks of at most grain, 0 picks a grain
+  void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+private:
+  struct Task {
+    std::function<void()> work;
+    TaskGroup *group;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void worker_main(unsigned index, bool pin_thread);
+  bool try_pop(Task &task);
+  void execute(Task &task);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  Worker injection;
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+  std::atomic<size_t> queued{0};
+  std::atomic<bool> stopping{false};
+};
+
+// dependency graph of tasks, run to completion on a scheduler
+class TaskGraph {
+public:
+  size_t add(std::function<void()> work);
+  void precede(size_t before, size_t after);
+  void run(Scheduler &scheduler);
+
+private:
+  struct Node {
+    std::function<void()> work;
+    std::vector<size_t> successors;
+    size_t dependencies = 0;
+    std::atomic<size_t> remaining{0};
+  };
+
+  void launch(Scheduler &scheduler, TaskGroup &group, size_t index);
+
+  std::deque<Node> nodes;
+};
+
+Scheduler &scheduler();
+
+#endif
@@ -2,44 +2,285 @@
 #define SIMULATION_HPP
 
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <vector>
+#include "celestial_body.hpp"
+#include "disruption.hpp"
+#include "double_double.hpp"
+#include "ewald.hpp"
+#include "external_forces.hpp"
+#include "morton.hpp"
+#include "octree.hpp"
+#include "kd_tree.hpp"
+#include "probes.hpp"
+#include "rings.hpp"
+#include "scenes.hpp"
+#include "softening.hpp"
+#include "sph.hpp"
 
 #define C 173.1446
 #define DEFAULT_G 0.000295912208
 
-struct CelestialBody {
-  glm::dvec3 position;
-  glm::dvec3 velocity;
-  glm::dvec3 acceleration;
-  double mass;
-  double radius;
-  glm::vec3 color;
-  bool is_black_hole = false;
-  glm::dvec3 previous_acceleration;
+#define PARALLEL_FORCE_THRESHOLD 256 // bodies, below this the serial pair loop wins
+#define FORCE_TILE_SIZE 64           // bodies per tile in the deterministic force path
+#define MIXED_TILE_SIZE 128          // largest group of bodies sharing one double-precision origin in the float32 kernel
+#define VARIATIONAL_PARTITIONS 16    // most row partitions of the variational sweep, fixed by n alone so sums are reproducible
+#define STATE_HASH_SEED 0xcbf29ce484222325ULL
+#define DIRECT_MAX_BODIES 20000      // most bodies the O(n^2) kernels take, larger systems run on the octree
+#define MOON_STEPS_PER_ORBIT 100     // subsystem substeps per orbit of its innermost added moon
+#define MOON_MAX_HILL_FRACTION 0.5   // farthest circular moon orbit, of the planet's Hill radius
+
+enum class PrecisionMode { DOUBLE, COMPENSATED, DOUBLE_DOUBLE };
+enum class ForceSolver { DIRECT, MIXED_PRECISION, BARNES_HUT };
+
+// what compute_forces() runs once the modes that override the solver and precision are applied
+enum class ForceKernel {
+  PERIODIC,
+  VARIATIONAL,
+  DOUBLE_DOUBLE,
+  SOFTENED,
+  MIXED_PRECISION,
+  BARNES_HUT,
+  DETERMINISTIC,
+  PARALLEL,
+  COMPENSATED,
+  SERIAL
+};
+const char *force_kernel_name(ForceKernel kernel);
+
+// separation between the orbit and an infinitesimally displaced neighbour, evolved with the
+// linearized equations of motion
+struct TangentVector {
+  glm::dvec3 position = glm::dvec3(0.0);
+  glm::dvec3 velocity = glm::dvec3(0.0);
+  glm::dvec3 acceleration = glm::dvec3(0.0);
+  glm::dvec3 previous_acceleration = glm::dvec3(0.0);
+};
+
+struct ChaosIndicators {
+  double megno = 0.0;      // Y(t), oscillates
+  double mean_megno = 0.0; // <Y>(t): tends to 2 for quasi-periodic orbits, grows like lambda t / 2 for chaotic ones
+  double lyapunov = 0.0;   // maximal Lyapunov exponent estimate, 1 / time units
+  double time = 0.0;       // integrated since the tangent vector was seeded
+};
+
+struct ForceErrorReport {
+  double max_relative_error;
+  double rms_relative_error;
+  double mixed_seconds;
+  double double_seconds;
+};
+
+// everything that changes how fast the forces are computed but not which integrator runs
+struct SolverConfig {
+  ForceSolver solver = ForceSolver::DIRECT;
+  unsigned threads = 1;
+  unsigned mixed_tile_size = MIXED_TILE_SIZE;
+  unsigned leaf_size = OCTREE_LEAF_SIZE;
 };
 
+// A planet and its satellites integrated in their own barycentric frame. The parent
+// simulation only sees the host body, which carries the total mass at the barycentre;
+// the rest of the parent system acts on the members through the tidal tensor at that
+// point. Local coordinates stay small, so doubles keep far more relative precision than
+// heliocentric ones, and the members take as many substeps as their own orbits need
+// without forcing that step onto the parent. The parent does not feel the subsystem's
+// quadrupole. A ring moves with the members substep by substep and collides after each.
+class Subsystem {
+public:
+  Subsystem(BodyHandle host, std::vector<CelestialBody> members, double step, PrecisionMode precision);
+
+  // span of parent time, the tidal tensor is interpolated linearly between its values at both ends
+  void advance(double span, const glm::dmat3 &tidal_start, const glm::dmat3 &tidal_end, double G);
+
+  BodyHandle host;
+  std::vector<CelestialBody> members; // barycentric, members[0] is the planet
+  double step;                        // local step, the parent step is split into as many as needed
+  PrecisionMode precision;            // DOUBLE, anything else is integrated compensated
+  std::optional<RingSystem> rings;
+
+private:
+  void compute_forces(const glm::dmat3 &tidal, double G);
+};
+
+using ExternalForces = ForcePipeline<PostNewtonian, J2Oblateness, RadiationPressure, Yarkovsky, NfwHalo, MiyamotoNagaiDisk>;
+
 class Simulation;
-using Integrator = void (Simulation::*)(double);
+using Integrator = void (Simulation::*)(double, int);
 
 class Simulation {
 public:
   Simulation();
-  void add_body(const CelestialBody &body);
+  BodyHandle add_body(const CelestialBody &body);
+  size_t add_bodies(std::span<const CelestialBody> batch); // one insertion, returns the dense index of the first
+  void reserve_bodies(size_t capacity);
+  void remove_body(BodyHandle handle);
+  void remove_newest_body(); // the most recently added body that still exists
+  bool is_valid(BodyHandle handle) const;
+  CelestialBody *get_body(BodyHandle handle);
+  BodyHandle handle_of(size_t index) const;
+  size_t index_of(BodyHandle handle) const;
   void clear_bodies();
   void setG(double value);
   double getG() const;
   std::vector<CelestialBody> &get_bodies();
   void update(double dt);
+  void advance(double dt, int n_steps);
   void reset_to_solar_system();
+  void reset_to_scene(const SceneConfig &config); // replaces every body in one parallel pass
+  void mark_for_removal(BodyHandle handle);
   void remove_marked_bodies();
-  std::vector<CelestialBody> bodies;
+  void set_deterministic(bool enabled);
+  bool is_deterministic() const;
+  void set_precision_mode(PrecisionMode mode);
+  PrecisionMode get_precision_mode() const;
+  void set_force_solver(ForceSolver solver);
+  ForceSolver get_force_solver() const;
+  ForceKernel get_force_kernel() const;
+  ForceErrorReport measure_mixed_precision_error();
+  void set_reorder_interval(int steps);
+  int get_reorder_interval() const;
+  void reorder_bodies();
+  const OctreeStats &get_tree_stats() const;
+  bool add_subsystem(BodyHandle planet, const std::vector<CelestialBody> &satellites, double step,
+                     PrecisionMode precision = PrecisionMode::COMPENSATED);
+  // circular orbit of the given radius in the planet's orbital plane, joining its subsystem
+  bool add_moon(BodyHandle planet, double mass, double distance);
+  const std::vector<Subsystem> &get_subsystems() const;
+  bool add_ring(BodyHandle planet, const RingConfig &config);
+  bool add_gas_disk(BodyHandle host, const GasConfig &config);
+  void remove_gas_disk();
+  const GasDisk *get_gas_disk() const;
+  BodyHandle get_gas_host() const;
+  ExternalForces &get_external_forces();
+  void set_disruption(const DisruptionConfig &config);
+  const DisruptionConfig &get_disruption() const;
+  const DisruptionStats &get_disruption_stats() const;
+  const std::vector<CelestialBody> &get_test_particles() const;
+  void add_probe(const glm::dvec3 &position, const glm::dvec3 &velocity); // takes the deepest sphere holding it next step
+  void launch_probes(BodyHandle from, unsigned count, double excess_speed);
+  void clear_probes();
+  const std::vector<Probe> &get_probes() const;
+  const ProbeStats &get_probe_stats() const;
+  void set_softening(const SofteningConfig &config);
+  const SofteningConfig &get_softening() const;
+  const SofteningStats &get_softening_stats() const;
+  const std::vector<double> &get_softening_lengths() const; // parallel to bodies, kernel support in AU
+  // The chaos indicators need the direct double or compensated kernel without softening and
+  // outside a periodic box. Enabling them is refused while another mode is active, except
+  // the box, which they replace; switching to another mode while they run drops them.
+  void set_periodic(const PeriodicConfig &config);
+  const PeriodicConfig &get_periodic() const;
+  bool set_variational(bool enabled, uint64_t seed = 1);
+  bool supports_variational() const;
+  bool supports_direct() const;
+  bool is_variational() const;
+  const ChaosIndicators &get_chaos_indicators() const;
+  SolverConfig get_solver_config() const;
+  void set_solver_config(const SolverConfig &config);
+  double time_force_evaluation(std::vector<glm::dvec3> *accelerations = nullptr);
+  void set_thread_count(unsigned count);
+  unsigned get_thread_count() const;
+  uint64_t get_state_hash() const;
+  uint64_t get_step_count() const;
+  double get_time() const;
+  std::vector<CelestialBody> bodies; // dense, kernels iterate it directly; add/remove only through the handle API
 
 private:
+  struct BodySlot {
+    uint32_t dense;
+    uint32_t generation;
+    bool fragment = false; // made by a disruption, never disrupted again
+  };
+
+  void reset_clock();
+  void record_insertions(size_t first);
   void compute_forces();
-  void apply_post_newtonian_corrections();
-  void integrate_velocity_verlet(double dt);
+  template <bool Compensated> void compute_forces_serial();
+  void compute_forces_parallel();
+  void compute_forces_deterministic();
+  void compute_forces_double_double();
+  void compute_forces_mixed_precision();
+  void compute_forces_barnes_hut();
+  void compute_forces_variational();
+  void compute_forces_softened();
+  void compute_forces_periodic();
+  void limit_direct_kernels();
+  void refresh_softening();
+  void seed_tangent();
+  void tangent_drift(double dt);
+  void tangent_step(double dt, bool drift);
+  void apply_external_forces();
+  void find_roche_victims();
+  void disrupt_bodies();
+  void compute_test_particle_forces();
+  template <PrecisionMode Mode> void step_test_particles(double dt, bool kick, bool drift);
+  void select_soi_primaries();
+  void attach_probes();
+  void advance_probes(double span);
+  glm::dmat3 tidal_tensor(size_t host) const;
+  void apply_order(std::vector<MortonEntry> &order);
+  template <PrecisionMode Mode> void integrate_velocity_verlet(double dt, int n_steps);
   Integrator current_integrator;
   double G;
+  std::vector<BodySlot> slots;
+  std::vector<uint32_t> dense_slots; // slot of every dense body, parallel to bodies
+  std::vector<uint32_t> free_slots;
+  std::vector<BodyHandle> insertion_order; // oldest first, removed bodies are skipped and compacted away lazily
+  std::vector<BodyHandle> marked_bodies;
+  int reorder_interval = 0; // steps between space-filling-curve sorts, 0 = never
+  uint64_t last_reorder_step = 0;
+  MortonKeys morton_keys;
+  std::vector<MortonEntry> morton_scratch;
+  std::vector<CelestialBody> reorder_scratch;
+  std::vector<uint32_t> reorder_slots;
+  Octree octree;
+  std::vector<Subsystem> subsystems;
+  std::vector<glm::dmat3> tidal_scratch;
+  std::optional<GasDisk> gas;
+  BodyHandle gas_host;
+  ExternalForces external_forces;
+  DisruptionConfig disruption;
+  DisruptionStats disruption_stats;
+  std::vector<CelestialBody> test_particles; // fragments that feel the bodies and pull on nothing
+  std::vector<CelestialBody> fragment_scratch;
+  std::vector<uint8_t> disruption_scratch; // dense bodies found inside a Roche limit at a step boundary of the batch
+  std::vector<BodyHandle> disruption_victims; // the marked bodies, taken before removals reorder the dense array
+  std::vector<size_t> black_hole_scratch;
+  std::vector<Probe> probes;
+  ProbeStats probe_stats;
+  std::vector<size_t> soi_primaries; // dense, heaviest first
+  std::vector<SoiNode> soi_tree;
+  std::vector<size_t> probe_nodes;   // node of every probe over the current span
+  SofteningConfig softening;
+  SofteningStats softening_stats;
+  std::vector<double> softening_lengths; // parallel to bodies
+  KdTree softening_tree;
+  unsigned softening_age = 0; // force evaluations since the last refresh
+  bool softening_stale = true; // bodies were added, removed or reordered
+  PeriodicConfig periodic;
+  EwaldTable ewald;
+  bool variational = false;
+  bool tangent_stale = false; // bodies were added or removed, reseed before the next step
+  uint64_t tangent_seed = 1;
+  std::vector<TangentVector> tangent; // parallel to bodies
+  double megno_weighted = 0.0;        // integral of 2 s (d.d')/(d.d) ds
+  double megno_sum = 0.0;             // integral of Y ds
+  double tangent_log_scale = 0.0;     // log of the factors the tangent vector was renormalized by
+  ChaosIndicators chaos;
+  bool deterministic = false;
+  PrecisionMode precision = PrecisionMode::DOUBLE;
+  ForceSolver force_solver = ForceSolver::DIRECT;
+  unsigned thread_count;
+  unsigned mixed_tile_size = MIXED_TILE_SIZE;
+  uint64_t state_hash = STATE_HASH_SEED;
+  uint64_t step_count = 0;
+  DoubleDouble time = {0.0, 0.0};
+  std::vector<glm::dvec3> force_scratch;
+  std::vector<double> soa_scratch;
+  std::vector<float> mixed_scratch;
 };
 
 #endif
\ No newline at end of file
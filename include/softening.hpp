@@ -0,0 +1,41 @@
+#ifndef SOFTENING_HPP
+#define SOFTENING_HPP
+
+#include <cmath>
+#include <cstdint>
+
+#define SOFTENING_NEIGHBOURS 32 // a body's softening reaches its k-th nearest neighbour, none with k bodies or fewer
+#define SOFTENING_INTERVAL 10   // force evaluations between refreshes
+#define SOFTENING_SCALE 1.0     // softening length over the k-th neighbour distance
+
+struct SofteningConfig {
+  bool adaptive = false;
+  unsigned neighbours = SOFTENING_NEIGHBOURS;
+  unsigned interval = SOFTENING_INTERVAL;
+};
+
+struct SofteningStats {
+  uint64_t refreshes = 0;
+  double mean_length = 0.0;     // AU
+  double min_length = 0.0;
+  double refresh_seconds = 0.0; // tree build and k-NN queries of the last refresh
+};
+
+// 1/r^3 of the cubic spline softened potential with support h (Monaghan & Lattanzio, as
+// in GADGET): exactly Newtonian from r = h on, finite at the centre, where it matches a
+// Plummer softening of h / 2.8. Every branch is evaluated and selected, so loops over it
+// vectorize; h = 0 is plain Newtonian and coincident points contribute nothing.
+template <typename T> inline T softened_inverse_cube(T distance_sq, T h) {
+  const T r = std::sqrt(distance_sq);
+  const T inv_h = T(1) / h;
+  const T inv_h3 = inv_h * inv_h * inv_h;
+  const T u = r * inv_h;
+  const T inner = inv_h3 * (T(32.0 / 3.0) + u * u * (T(32) * u - T(38.4)));
+  const T outer = inv_h3 * (T(64.0 / 3.0) - T(48) * u + T(38.4) * u * u - T(32.0 / 3.0) * u * u * u -
+                            T(1.0 / 15.0) / (u * u * u));
+  const T newton = T(1) / (distance_sq * r);
+  const T value = u >= T(1) ? newton : (u < T(0.5) ? inner : outer);
+  return distance_sq > T(0) ? value : T(0);
+}
+
+#endif
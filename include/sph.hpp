@@ -0,0 +1,118 @@
+#ifndef SPH_HPP
+#define SPH_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "celestial_body.hpp"
+#include "kd_tree.hpp"
+
+#define SPH_ETA 1.2             // h = eta (m / rho)^(1/3), about 58 neighbours with the cubic spline
+#define SPH_SKIN 0.3            // Verlet lists reach (1 + skin) times the 2 h kernel support
+#define SPH_ALPHA 1.0           // Monaghan artificial viscosity, linear term
+#define SPH_BETA 2.0            // quadratic term, stops interpenetration in strong shocks
+#define SPH_COURANT 0.3         // step = courant * h / signal speed
+#define SPH_ASPECT_RATIO 0.05   // disk H / R, sets the locally isothermal sound speed
+#define SPH_CHUNK 512           // particles per parallel task
+#define SPH_MAP_RADIAL 64       // surface density map handed to the renderer
+#define SPH_MAP_ANGULAR 256
+
+struct GasConfig {
+  size_t particles = 20000;
+  double inner_radius = 0.3; // AU
+  double outer_radius = 3.0;
+  double disk_mass = 1e-3;   // solar masses; the gas does not pull on the bodies, this only sets densities and accretion
+  double aspect_ratio = SPH_ASPECT_RATIO;
+  double accretion_radius = 0.0; // 0 = half the inner radius
+  uint64_t seed = 1;
+};
+
+struct GasStats {
+  size_t particles = 0;
+  uint64_t steps = 0;
+  uint64_t list_builds = 0;
+  uint64_t steps_since_build = 0;
+  double mean_neighbours = 0.0;
+  double accreted_mass = 0.0;
+  double step = 0.0;            // current gas step, days
+  double list_seconds = 0.0;    // last neighbour list build
+  double density_seconds = 0.0; // last density pass
+  double force_seconds = 0.0;   // last force pass
+};
+
+// Smoothed-particle-hydrodynamics gas disk around a host body, coupled to the N-body
+// system: every particle feels the gravity of every body, and particles that come within
+// the accretion radius of the host or of any black hole are absorbed by it, handing over
+// their mass and momentum. The gas is locally isothermal with the sound speed set by the
+// disk aspect ratio, and uses the cubic spline kernel with Monaghan viscosity.
+//
+// The gas takes its own Courant-limited steps. It lags the bodies until a whole gas step of
+// parent time has built up and then catches up, with the bodies' positions interpolated
+// linearly across the span like the subsystem tidal field.
+//
+// Neighbours come from Verlet lists: every pair closer than the larger of both kernel
+// supports plus a skin, found with a kd-tree and reused until some particle strayed more
+// than half its skin from the circular orbit it was on, or its smoothing length outgrew
+// it. Measuring against the orbit rather than the built position keeps the bulk rotation
+// of the disk from spending the skin; only the shear does. Lists are rebuilt in tree order,
+// so neighbours are memory neighbours. Both passes gather each particle's neighbours into
+// contiguous arrays and evaluate the kernel over them in branch-free loops that vectorize.
+class GasDisk {
+public:
+  GasDisk(const GasConfig &config, const CelestialBody &host, double G);
+
+  // catches up with span more parent time once a whole gas step has built up; host is
+  // the host's dense index, SIZE_MAX once it is gone
+  void advance(double span, std::vector<CelestialBody> &bodies, size_t host, double G);
+  void bodies_changed(); // bodies were added, removed or reordered since the last advance
+
+  // surface density around center in the xy plane, radial-major, normalized to its peak
+  void surface_density(const glm::dvec3 &center, std::vector<float> &map) const;
+  double get_outer_radius() const;
+  const std::vector<glm::dvec3> &get_positions() const;
+  const GasStats &get_stats() const;
+
+private:
+  struct Source {
+    glm::dvec3 position;
+    double mass;
+  };
+
+  void step(double dt, const std::vector<Source> &sources, const glm::dvec3 &host, double G);
+  bool lists_stale(const glm::dvec3 &host);
+  void build_lists(const glm::dvec3 &host);
+  void compute_density(const glm::dvec3 &host);
+  void compute_forces(const std::vector<Source> &sources, double G);
+  void accrete(const std::vector<Source> &sources, const std::vector<size_t> &sinks, std::vector<CelestialBody> &bodies);
+
+  GasConfig config;
+  double particle_mass;
+  double accretion_radius;
+  double host_mu;           // G M of the host, last known, kept when the host is removed
+  glm::dvec3 host_position;
+  std::vector<glm::dvec3> position, velocity, acceleration;
+  std::vector<double> h, density, pressure, sound_speed;
+
+  KdTree tree;
+  std::vector<glm::dvec3> built_position; // where the lists were built
+  std::vector<double> built_h;
+  std::vector<double> built_omega;        // Keplerian angular speed at the built position
+  glm::dvec3 built_host = glm::dvec3(0.0);
+  double list_age = 0.0;                  // gas time since the lists were built
+  std::vector<uint32_t> list_start;       // CSR, neighbours of i are list[list_start[i] .. list_start[i + 1])
+  std::vector<uint32_t> list;
+  std::vector<std::vector<uint32_t>> chunk_lists;
+  std::vector<double> chunk_step;
+  std::vector<uint8_t> chunk_flags;
+  std::vector<uint32_t> absorbed_by; // sink + 1 for every particle accreted this step, 0 otherwise
+  std::vector<double> reach_scratch;
+
+  std::vector<Source> sources_start; // bodies where the gas last caught up
+  std::vector<Source> sources_now;
+  std::vector<Source> sources_step;
+  double pending = 0.0;              // parent time the gas is behind
+  bool accelerations_valid = false;
+  GasStats stats;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SUMMATION_HPP
+#define SUMMATION_HPP
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+// Neumaier (improved Kahan) summation. The rounding error of sum + value is kept in
+// compensation and folded back right away, so sum stays the best double estimate and
+// can be read directly. Must not be built with -ffast-math, which reassociates it away.
+inline void compensated_add(double &sum, double &compensation, double value) {
+  const double t = sum + value;
+  if (std::abs(sum) >= std::abs(value)) {
+    compensation += (sum - t) + value;
+  } else {
+    compensation += (value - t) + sum;
+  }
+  const double folded = t + compensation;
+  compensation -= folded - t;
+  sum = folded;
+}
+
+inline void compensated_add(glm::dvec3 &sum, glm::dvec3 &compensation, const glm::dvec3 &value) {
+  compensated_add(sum.x, compensation.x, value.x);
+  compensated_add(sum.y, compensation.y, value.y);
+  compensated_add(sum.z, compensation.z, value.z);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer. The writer fills back()
+// and publish()es it, the reader takes latest() whenever it likes; neither side ever
+// waits for the other and the reader always sees the newest complete value.
+template <typename T>
+class TripleBuffer {
+public:
+  T &back() { return slots[back_index]; }
+
+  void publish() {
+    const uint8_t previous = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+    back_index = previous & INDEX_MASK;
+  }
+
+  const T &latest() {
+    if (middle.load(std::memory_order_relaxed) & FRESH) {
+      const uint8_t previous = middle.exchange(front_index, std::memory_order_acq_rel);
+      front_index = previous & INDEX_MASK;
+    }
+    return slots[front_index];
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 3;
+  static constexpr uint8_t FRESH = 4;
+
+  T slots[3];
+  std::atomic<uint8_t> middle{1};
+  uint8_t back_index = 0;  // writer only
+  uint8_t front_index = 2; // reader only
+};
+
+#endif
@@ -11,6 +11,9 @@ uniform float aspect_ratio;
 uniform int num_bodies;
 uniform bool lighting_enabled;
 uniform float G;
+uniform int gas_body;              // body carrying an SPH gas disk, -1 for none
+uniform float gas_radius;
+uniform sampler2D gas_density;     // x: angle, y: radius over gas_radius
 
 struct CelestialBody {
   vec3 position;
@@ -32,6 +35,7 @@ const float PI = 3.14159265359;
 
 vec3 ray_march(vec3 ro, vec3 rd);
 vec3 accretion_disk_color(vec3 hit_pos, vec3 black_hole_pos);
+vec3 gas_disk_color(vec3 hit_pos, vec3 center);
 float hash(vec2 p);
 
 float sphere_distance(vec3 p, vec3 center, float radius) {
@@ -100,10 +104,12 @@ void main() {
   if (color == vec3(0.0)) { // assuming ray_march returns black for no hit
     bool disk_hit = false;
     for (int i = 0; i < num_bodies; i++) {
-      if (bodies[i].is_black_hole == 1) {
-        vec3 disk_normal = normalize(cross(bodies[i].position, vec3(0, 1, 0.5)));
-        float disk_radius = bodies[i].radius * 5.0;
-        float event_horizon_radius = bodies[i].radius * 0.5;
+      bool gas = i == gas_body;
+      if (bodies[i].is_black_hole == 1 || gas) {
+        // the simulated gas lies in the xy plane and has its own extent
+        vec3 disk_normal = gas ? vec3(0, 0, 1) : normalize(cross(bodies[i].position, vec3(0, 1, 0.5)));
+        float disk_radius = gas ? gas_radius : bodies[i].radius * 5.0;
+        float event_horizon_radius = bodies[i].radius * (gas ? 1.0 : 0.5);
 
         float denom = dot(ray_dir, disk_normal);
         if (abs(denom) > 0.001) { // ray is not parallel to disk
@@ -113,9 +119,10 @@ void main() {
             float dist_from_center = distance(hit_pos, bodies[i].position);
 
             if (dist_from_center < disk_radius && dist_from_center > event_horizon_radius) {
-              color = accretion_disk_color(hit_pos, bodies[i].position);
-              disk_hit = true;
-              break; // stop at the first disk hit
+              color = gas ? gas_disk_color(hit_pos, bodies[i].position)
+                          : accretion_disk_color(hit_pos, bodies[i].position);
+              disk_hit = color != vec3(0.0); // empty parts of the gas map let the ray through
+              if (disk_hit) break;           // stop at the first disk hit
             }
           }
         }
@@ -208,3 +215,15 @@ vec3 accretion_disk_color(vec3 hit_pos, vec3 black_hole_pos) {
 
   return pow(color * 1.5, vec3(1.3));
 }
+
+// same palette as the accretion disk, with the brightness taken from the gas surface density
+vec3 gas_disk_color(vec3 hit_pos, vec3 center) {
+  vec3 p = hit_pos - center;
+  float r = length(p.xy) / gas_radius;
+  float angle = atan(p.y, p.x);
+  float density = texture(gas_density, vec2(angle / (2.0 * PI) + 0.5, r)).r;
+  if (density <= 0.0) return vec3(0.0);
+
+  vec3 color = mix(vec3(1.0, 0.8, 0.6), vec3(1.0, 0.3, 0.1), smoothstep(0.0, 1.0, r));
+  return pow(color * sqrt(density) * 1.5, vec3(1.3));
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <glm/glm.hpp>
+#include "autotuner.hpp"
+#include "scheduler.hpp"
+
+Autotuner::Autotuner(std::string cache_path) : cache_path(std::move(cache_path)) {}
+
+void Autotuner::set_accuracy(double rms_error)    { accuracy = rms_error; tuned_bodies = 0; }
+double Autotuner::get_accuracy()            const { return accuracy; }
+bool Autotuner::has_result()                const { return has_tuning; }
+const TuningResult &Autotuner::last_result() const { return result; }
+void Autotuner::reset()                           { tuned_bodies = 0; }
+
+bool Autotuner::tunable(const Simulation &simulation) {
+  return !simulation.get_periodic().enabled && !simulation.is_variational() && !simulation.get_softening().adaptive &&
+         simulation.get_precision_mode() != PrecisionMode::DOUBLE_DOUBLE;
+}
+
+bool Autotuner::maybe_tune(Simulation &simulation) {
+  const size_t n = simulation.bodies.size();
+  if (n < AUTOTUNE_MIN_BODIES || !tunable(simulation)) return false;
+  if (tuned_bodies != 0 && n < 2 * tuned_bodies && 2 * n > tuned_bodies &&
+      tuned_deterministic == simulation.is_deterministic() && tuned_precision == simulation.get_precision_mode()) {
+    return false;
+  }
+
+  tune(simulation);
+  return true;
+}
+
+// scenes are grouped by power-of-two body count; the core count keeps caches from
+// different machines sharing a home directory apart. Deterministic mode and compensated
+// precision change which direct kernel runs, so they are part of the key
+std::string Autotuner::cache_key(const Simulation &simulation) const {
+  std::ostringstream key;
+  key << scheduler().concurrency() << ' ' << std::bit_width(simulation.bodies.size()) << ' ' << accuracy << ' '
+      << simulation.is_deterministic() << ' ' << static_cast<int>(simulation.get_precision_mode());
+  return key.str();
+}
+
+void Autotuner::load_cache() {
+  cache_loaded = true;
+  std::ifstream file(cache_path);
+  if (!file) return; // first run on this machine
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    unsigned concurrency;
+    int bucket, deterministic, precision, solver;
+    double target;
+    SolverConfig config;
+    if (!(fields >> concurrency >> bucket >> target >> deterministic >> precision >> solver >> config.threads >>
+          config.mixed_tile_size >> config.leaf_size)) {
+      continue; // also lines from before the modes were part of the key
+    }
+    config.solver = static_cast<ForceSolver>(solver);
+
+    std::ostringstream key;
+    key << concurrency << ' ' << bucket << ' ' << target << ' ' << deterministic << ' ' << precision;
+    cache[key.str()] = config;
+  }
+}
+
+void Autotuner::save_cache() const {
+  std::ofstream file(cache_path);
+  if (!file) {
+    std::cerr << "Could not write tuning cache: " << cache_path << std::endl;
+    return;
+  }
+  for (const auto &[key, config] : cache) {
+    file << key << ' ' << static_cast<int>(config.solver) << ' ' << config.threads << ' ' << config.mixed_tile_size
+         << ' ' << config.leaf_size << '\n';
+  }
+}
+
+// direct double sum for AUTOTUNE_SAMPLE_ROWS evenly spaced bodies, O(rows * n) instead of O(n^2);
+// the pair cutoff is the one the kernels use
+static void sampled_reference(const Simulation &simulation, std::vector<size_t> &rows,
+                              std::vector<glm::dvec3> &reference) {
+  const auto &bodies = simulation.bodies;
+  const size_t n = bodies.size();
+  const size_t count = std::min<size_t>(n, AUTOTUNE_SAMPLE_ROWS);
+  rows.resize(count);
+  for (size_t k = 0; k < count; ++k) rows[k] = k * n / count;
+
+  reference.assign(count, glm::dvec3(0.0));
+  const double G = simulation.getG();
+  scheduler().parallel_for(0, count, 0, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      const glm::dvec3 position = bodies[rows[k]].position;
+      glm::dvec3 acceleration(0.0);
+      for (size_t j = 0; j < n; ++j) {
+        const glm::dvec3 r = bodies[j].position - position;
+        const double distance_sq = glm::dot(r, r);
+        if (distance_sq < 1e-12) continue;
+        acceleration += G * bodies[j].mass * r / (distance_sq * std::sqrt(distance_sq));
+      }
+      reference[k] = acceleration;
+    }
+  });
+}
+
+TuningResult Autotuner::tune(Simulation &simulation) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = simulation.bodies.size();
+  const unsigned concurrency = scheduler().concurrency();
+  if (!tunable(simulation)) return result; // every candidate would time the overriding kernel
+
+  if (!cache_loaded) load_cache();
+  const std::string key = cache_key(simulation);
+
+  result = TuningResult{};
+  tuned_bodies = std::max<size_t>(n, 1);
+  tuned_deterministic = simulation.is_deterministic();
+  tuned_precision = simulation.get_precision_mode();
+  has_tuning = true;
+
+  if (auto cached = cache.find(key); cached != cache.end()) {
+    simulation.set_solver_config(cached->second);
+    result.config = cached->second;
+    result.seconds = simulation.time_force_evaluation();
+    result.from_cache = true;
+    result.tuning_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+  }
+
+  // cheapest first, so the budget is spent on the candidates most likely to win; the pair
+  // kernels only where they are allowed at all
+  std::vector<SolverConfig> candidates;
+  for (unsigned leaf : {16u, 8u, 4u}) {
+    candidates.push_back({ForceSolver::BARNES_HUT, concurrency, MIXED_TILE_SIZE, leaf});
+  }
+  if (simulation.supports_direct()) {
+    for (unsigned tile : {128u, 64u, 32u}) {
+      candidates.push_back({ForceSolver::MIXED_PRECISION, concurrency, tile, OCTREE_LEAF_SIZE});
+    }
+    for (unsigned threads = concurrency;; threads = std::max(1u, threads / 2)) {
+      candidates.push_back({ForceSolver::DIRECT, threads, MIXED_TILE_SIZE, OCTREE_LEAF_SIZE});
+      if (threads == 1) break;
+    }
+  }
+
+  std::vector<size_t> rows;
+  std::vector<glm::dvec3> reference, accelerations;
+  sampled_reference(simulation, rows, reference);
+  const SolverConfig previous = simulation.get_solver_config();
+
+  double best = INFINITY;
+  for (const auto &candidate : candidates) {
+    if (best < INFINITY && std::chrono::duration<double>(Clock::now() - start).count() > AUTOTUNE_BUDGET) {
+      result.over_budget = true;
+      break;
+    }
+    simulation.set_solver_config(candidate);
+    result.candidates++;
+
+    // the first run also warms caches and builds the tree, it only decides accuracy
+    simulation.time_force_evaluation(&accelerations);
+    double error = 0.0;
+    size_t counted = 0;
+    for (size_t k = 0; k < rows.size(); ++k) {
+      const double magnitude = glm::length(reference[k]);
+      if (magnitude == 0.0) continue;
+      const double relative = glm::length(accelerations[rows[k]] - reference[k]) / magnitude;
+      error += relative * relative;
+      ++counted;
+    }
+    error = counted > 0 ? std::sqrt(error / counted) : 0.0;
+    if (error > accuracy) continue;
+
+    // one warm run always counts, the repeats stop at the budget
+    double fastest = INFINITY;
+    for (int repeat = 0; repeat < AUTOTUNE_REPEATS; ++repeat) {
+      fastest = std::min(fastest, simulation.time_force_evaluation());
+      if (fastest > 4.0 * best) break; // hopeless, don't spend more time on it
+      if (std::chrono::duration<double>(Clock::now() - start).count() > AUTOTUNE_BUDGET) break;
+    }
+
+    if (fastest < best) {
+      best = fastest;
+      result.config = candidate;
+      result.seconds = fastest;
+      result.rms_error = error;
+    }
+  }
+
+  // above DIRECT_MAX_BODIES every candidate may miss a tight target; keep what ran before
+  // and leave the cache alone so a looser target can still be tuned
+  if (best == INFINITY) {
+    simulation.set_solver_config(previous);
+    result.config = previous;
+    result.seconds = simulation.time_force_evaluation();
+    result.tuning_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+  }
+
+  simulation.set_solver_config(result.config);
+  cache[key] = result.config;
+  save_cache();
+
+  result.tuning_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return result;
+}
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <numbers>
+#include "disruption.hpp"
+#include "scenes.hpp"
+
+double physical_radius(const CelestialBody &body) {
+  return std::cbrt(3.0 * body.mass / (4.0 * std::numbers::pi * body.density));
+}
+
+double roche_limit(const CelestialBody &primary, const CelestialBody &satellite, double coefficient) {
+  return coefficient * std::cbrt(3.0 * primary.mass / (4.0 * std::numbers::pi * satellite.density));
+}
+
+void make_fragments(const CelestialBody &parent, unsigned count, double dispersion, double G, uint64_t seed,
+                    std::vector<CelestialBody> &fragments) {
+  fragments.resize(count);
+  if (count == 0) return;
+
+  const double mass = parent.mass / count;
+  const double size = physical_radius(parent);
+  const double radius = parent.radius / std::cbrt(static_cast<double>(count)); // drawn
+  const double spread = dispersion * std::sqrt(2.0 * G * parent.mass / size) / std::sqrt(3.0);
+
+  glm::dvec3 offset(0.0), drift(0.0);
+  for (unsigned k = 0; k < count; ++k) {
+    CounterRandom random(seed, k);
+    const double r = size * std::cbrt(random.uniform());
+    const double z = 2.0 * random.uniform() - 1.0;
+    const double phi = 2.0 * std::numbers::pi * random.uniform();
+    const double s = std::sqrt(1.0 - z * z);
+    glm::dvec3 velocity;
+    for (int axis = 0; axis < 3; ++axis) velocity[axis] = spread * random.normal();
+
+    CelestialBody &fragment = fragments[k];
+    fragment = parent;
+    fragment.position_compensation = glm::dvec3(0.0);
+    fragment.velocity_compensation = glm::dvec3(0.0);
+    fragment.mass = mass;
+    fragment.radius = radius;
+    fragment.is_black_hole = false;
+    fragment.position = glm::dvec3(r * s * std::cos(phi), r * s * std::sin(phi), r * z);
+    fragment.velocity = velocity;
+    offset += fragment.position;
+    drift += fragment.velocity;
+  }
+
+  // equal masses: the mass-weighted means are plain means
+  offset /= static_cast<double>(count);
+  drift /= static_cast<double>(count);
+  for (CelestialBody &fragment : fragments) {
+    fragment.position = parent.position + (fragment.position - offset);
+    fragment.velocity = parent.velocity + (fragment.velocity - drift);
+  }
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <glm/glm.hpp>
+#include "ensemble.hpp"
+#include "scheduler.hpp"
+
+Ensemble::Ensemble(const std::vector<Simulation> &members) : member_count(members.size()), body_count(0) {
+  for (const auto &member : members) {
+    body_count = std::max(body_count, member.bodies.size());
+  }
+  stride = (member_count + ENSEMBLE_LANES - 1) / ENSEMBLE_LANES * ENSEMBLE_LANES;
+
+  const size_t n = body_count * stride;
+  for (auto *array : {&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &mass}) {
+    array->assign(n, 0.0);
+  }
+  G.assign(stride, 0.0);
+  min_separation_sq.assign(stride, std::numeric_limits<double>::infinity());
+
+  // members with fewer bodies are padded with massless bodies, padding lanes stay all-zero
+  for (size_t m = 0; m < member_count; ++m) {
+    const auto &bodies = members[m].bodies;
+    G[m] = members[m].getG();
+    for (size_t b = 0; b < bodies.size(); ++b) {
+      const size_t k = index(b, m);
+      px[k] = bodies[b].position.x; py[k] = bodies[b].position.y; pz[k] = bodies[b].position.z;
+      vx[k] = bodies[b].velocity.x; vy[k] = bodies[b].velocity.y; vz[k] = bodies[b].velocity.z;
+      mass[k] = bodies[b].mass;
+    }
+  }
+
+  compute_forces(0, stride);
+  std::fill(min_separation_sq.begin(), min_separation_sq.end(), std::numeric_limits<double>::infinity());
+
+  initial_energy.resize(member_count);
+  initial_angular_momentum.resize(member_count);
+  for (size_t m = 0; m < member_count; ++m) {
+    measure(m, initial_energy[m], initial_angular_momentum[m]);
+  }
+}
+
+size_t Ensemble::size() const              { return member_count; }
+size_t Ensemble::bodies_per_member() const { return body_count; }
+
+void Ensemble::compute_forces(size_t begin, size_t end) {
+  const size_t lanes = end - begin;
+  const double *__restrict g = &G[begin];
+  double *__restrict min_sq = &min_separation_sq[begin];
+
+  for (size_t i = 0; i < body_count; ++i) {
+    std::fill_n(&ax[index(i, begin)], lanes, 0.0);
+    std::fill_n(&ay[index(i, begin)], lanes, 0.0);
+    std::fill_n(&az[index(i, begin)], lanes, 0.0);
+  }
+
+  for (size_t i = 0; i < body_count; ++i) {
+    const double *__restrict xi = &px[index(i, begin)];
+    const double *__restrict yi = &py[index(i, begin)];
+    const double *__restrict zi = &pz[index(i, begin)];
+    const double *__restrict mi = &mass[index(i, begin)];
+    double *__restrict axi = &ax[index(i, begin)];
+    double *__restrict ayi = &ay[index(i, begin)];
+    double *__restrict azi = &az[index(i, begin)];
+
+    for (size_t j = i + 1; j < body_count; ++j) {
+      const double *__restrict xj = &px[index(j, begin)];
+      const double *__restrict yj = &py[index(j, begin)];
+      const double *__restrict zj = &pz[index(j, begin)];
+      const double *__restrict mj = &mass[index(j, begin)];
+      double *__restrict axj = &ax[index(j, begin)];
+      double *__restrict ayj = &ay[index(j, begin)];
+      double *__restrict azj = &az[index(j, begin)];
+
+      // one lane per member, branch-free so the loop vectorizes
+      for (size_t s = 0; s < lanes; ++s) {
+        const double dx = xj[s] - xi[s];
+        const double dy = yj[s] - yi[s];
+        const double dz = zj[s] - zi[s];
+        const double distance_sq = dx * dx + dy * dy + dz * dz;
+        const double inv_cube = distance_sq < 1e-12 ? 0.0 : 1.0 / (distance_sq * std::sqrt(distance_sq));
+        const double fi = g[s] * mj[s] * inv_cube;
+        const double fj = g[s] * mi[s] * inv_cube;
+
+        axi[s] += fi * dx; ayi[s] += fi * dy; azi[s] += fi * dz;
+        axj[s] -= fj * dx; ayj[s] -= fj * dy; azj[s] -= fj * dz;
+
+        const double tracked = mi[s] * mj[s] > 0.0 ? distance_sq : std::numeric_limits<double>::infinity();
+        min_sq[s] = std::min(min_sq[s], tracked);
+      }
+    }
+  }
+}
+
+// kick-drift-kick form of velocity verlet, the closing kick of one step is fused with the opening kick of the next
+void Ensemble::integrate_velocity_verlet(size_t begin, size_t end, double dt, int n_steps) {
+  const size_t lanes = end - begin;
+  const double half_dt = 0.5 * dt;
+
+  for (int step = 0; step < n_steps; ++step) {
+    const double kick = step == 0 ? half_dt : dt;
+    for (size_t b = 0; b < body_count; ++b) {
+      const size_t k = index(b, begin);
+      for (size_t s = 0; s < lanes; ++s) {
+        vx[k + s] += ax[k + s] * kick; vy[k + s] += ay[k + s] * kick; vz[k + s] += az[k + s] * kick;
+        px[k + s] += vx[k + s] * dt;   py[k + s] += vy[k + s] * dt;   pz[k + s] += vz[k + s] * dt;
+      }
+    }
+    compute_forces(begin, end);
+  }
+
+  for (size_t b = 0; b < body_count; ++b) {
+    const size_t k = index(b, begin);
+    for (size_t s = 0; s < lanes; ++s) {
+      vx[k + s] += ax[k + s] * half_dt; vy[k + s] += ay[k + s] * half_dt; vz[k + s] += az[k + s] * half_dt;
+    }
+  }
+}
+
+// members are independent, so every lane batch runs all steps without synchronizing
+void Ensemble::advance(double dt, int n_steps) {
+  if (n_steps <= 0 || stride == 0) return;
+
+  scheduler().parallel_for(0, stride / ENSEMBLE_LANES, 1, [&](size_t first_batch, size_t last_batch) {
+    for (size_t batch = first_batch; batch < last_batch; ++batch) {
+      integrate_velocity_verlet(batch * ENSEMBLE_LANES, (batch + 1) * ENSEMBLE_LANES, dt, n_steps);
+    }
+  });
+}
+
+void Ensemble::measure(size_t member, double &energy, glm::dvec3 &angular_momentum) const {
+  energy = 0.0;
+  angular_momentum = glm::dvec3(0.0);
+
+  for (size_t i = 0; i < body_count; ++i) {
+    const size_t a = index(i, member);
+    const glm::dvec3 position(px[a], py[a], pz[a]);
+    const glm::dvec3 velocity(vx[a], vy[a], vz[a]);
+    energy += 0.5 * mass[a] * glm::dot(velocity, velocity);
+    angular_momentum += mass[a] * glm::cross(position, velocity);
+
+    for (size_t j = i + 1; j < body_count; ++j) {
+      const size_t b = index(j, member);
+      const double distance = glm::length(glm::dvec3(px[b], py[b], pz[b]) - position);
+      if (distance * distance < 1e-12) continue;
+      energy -= G[member] * mass[a] * mass[b] / distance;
+    }
+  }
+}
+
+std::vector<EnsembleDiagnostics> Ensemble::diagnostics() const {
+  std::vector<EnsembleDiagnostics> result(member_count);
+
+  for (size_t m = 0; m < member_count; ++m) {
+    auto &d = result[m];
+    glm::dvec3 angular_momentum;
+    measure(m, d.energy, angular_momentum);
+    d.initial_energy = initial_energy[m];
+    d.relative_energy_error = d.initial_energy != 0.0 ? std::abs((d.energy - d.initial_energy) / d.initial_energy) : 0.0;
+
+    const double l0 = glm::length(initial_angular_momentum[m]);
+    d.relative_angular_momentum_error = l0 > 0.0 ? glm::length(angular_momentum - initial_angular_momentum[m]) / l0 : 0.0;
+    d.min_separation = std::sqrt(min_separation_sq[m]);
+
+    double total_mass = 0.0;
+    glm::dvec3 center(0.0);
+    for (size_t b = 0; b < body_count; ++b) {
+      const size_t k = index(b, m);
+      total_mass += mass[k];
+      center += mass[k] * glm::dvec3(px[k], py[k], pz[k]);
+    }
+    if (total_mass > 0.0) center /= total_mass;
+
+    d.ejected = false;
+    for (size_t b = 0; b < body_count; ++b) {
+      const size_t k = index(b, m);
+      if (mass[k] > 0.0 && glm::length(glm::dvec3(px[k], py[k], pz[k]) - center) > ENSEMBLE_EJECTION_RADIUS) {
+        d.ejected = true;
+      }
+    }
+  }
+
+  return result;
+}
+
+EnsembleReport Ensemble::report() const {
+  EnsembleReport result;
+  result.members = member_count;
+  result.bodies = body_count;
+  result.min_separation = std::numeric_limits<double>::infinity();
+
+  const std::vector<EnsembleDiagnostics> members = diagnostics();
+  std::vector<double> errors(members.size());
+  for (size_t m = 0; m < members.size(); ++m) {
+    errors[m] = members[m].relative_energy_error;
+    result.max_energy_error = std::max(result.max_energy_error, errors[m]);
+    result.min_separation = std::min(result.min_separation, members[m].min_separation);
+    if (members[m].ejected) result.ejected++;
+  }
+  if (!errors.empty()) {
+    std::nth_element(errors.begin(), errors.begin() + errors.size() / 2, errors.end());
+    result.median_energy_error = errors[errors.size() / 2];
+  }
+  return result;
+}
+
+void Ensemble::copy_member_to(size_t member, Simulation &simulation) const {
+  auto &bodies = simulation.get_bodies();
+  for (size_t b = 0; b < bodies.size() && b < body_count; ++b) {
+    const size_t k = index(b, member);
+    bodies[b].position = glm::dvec3(px[k], py[k], pz[k]);
+    bodies[b].velocity = glm::dvec3(vx[k], vy[k], vz[k]);
+    bodies[b].acceleration = glm::dvec3(ax[k], ay[k], az[k]);
+  }
+}
+
+// one draw per statement, argument evaluation order would make the seed's outcome compiler-dependent
+static void perturb(std::vector<CelestialBody> &bodies, double sigma, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::normal_distribution<double> noise(0.0, sigma);
+  for (auto &body : bodies) {
+    for (int axis = 0; axis < 3; ++axis) body.position[axis] *= 1.0 + noise(rng);
+    for (int axis = 0; axis < 3; ++axis) body.velocity[axis] *= 1.0 + noise(rng);
+  }
+}
+
+double Ensemble::interactions(size_t members, size_t bodies, int steps) {
+  return static_cast<double>(members) * (bodies * (bodies - 1) / 2) * std::max(steps, 0);
+}
+
+std::vector<Simulation> Ensemble::perturbed_solar_systems(size_t count, double sigma, uint64_t seed) {
+  std::vector<Simulation> members(count);
+
+  for (size_t m = 0; m < count; ++m) {
+    members[m].reset_to_solar_system();
+    perturb(members[m].get_bodies(), sigma, seed + m);
+  }
+
+  return members;
+}
+
+std::vector<Simulation> Ensemble::perturbed_copies(const std::vector<CelestialBody> &bodies, double G, size_t count,
+                                                   double sigma, uint64_t seed) {
+  std::vector<Simulation> members(count);
+
+  for (size_t m = 0; m < count; ++m) {
+    members[m].setG(G);
+    members[m].add_bodies(bodies);
+    perturb(members[m].get_bodies(), sigma, seed + m);
+  }
+
+  return members;
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <glm/gtx/norm.hpp>
+#include "ewald.hpp"
+#include "scheduler.hpp"
+
+namespace {
+
+constexpr int POINTS = EWALD_TABLE_SIZE + 1;
+
+size_t table_index(int x, int y, int z) { return (static_cast<size_t>(z) * POINTS + y) * POINTS + x; }
+
+} // namespace
+
+bool EwaldTable::is_built() const { return !values.empty(); }
+
+// Hernquist, Bouchet & Suto (1991), as in GADGET: erfc-screened images in real space,
+// the Gaussian remainder as a Fourier series without the k = 0 term, which is the
+// uniform background; the nearest-image Newtonian term is taken back out
+glm::dvec3 EwaldTable::exact(const glm::dvec3 &d) {
+  const double r_sq = glm::length2(d);
+  if (r_sq == 0.0) return glm::dvec3(0.0);
+
+  constexpr double pi = std::numbers::pi;
+  constexpr double alpha = EWALD_ALPHA;
+  glm::dvec3 result = -d / (r_sq * std::sqrt(r_sq));
+
+  for (int nx = -EWALD_RANGE; nx <= EWALD_RANGE; ++nx) {
+    for (int ny = -EWALD_RANGE; ny <= EWALD_RANGE; ++ny) {
+      for (int nz = -EWALD_RANGE; nz <= EWALD_RANGE; ++nz) {
+        const glm::dvec3 image = d - glm::dvec3(nx, ny, nz);
+        const double r = glm::length(image);
+        const double screened = std::erfc(alpha * r) + 2.0 * alpha * r / std::sqrt(pi) * std::exp(-alpha * alpha * r * r);
+        result += image * (screened / (r * r * r));
+
+        const int k_sq = nx * nx + ny * ny + nz * nz;
+        if (k_sq == 0) continue;
+        const glm::dvec3 k(nx, ny, nz);
+        const double weight = 2.0 / k_sq * std::exp(-pi * pi * k_sq / (alpha * alpha));
+        result += k * (weight * std::sin(2.0 * pi * glm::dot(k, d)));
+      }
+    }
+  }
+  return result;
+}
+
+void EwaldTable::build() {
+  values.resize(static_cast<size_t>(POINTS) * POINTS * POINTS);
+  const double spacing = 0.5 / EWALD_TABLE_SIZE;
+  scheduler().parallel_for(0, POINTS, 1, [&](size_t begin, size_t end) {
+    for (size_t z = begin; z < end; ++z) {
+      for (int y = 0; y < POINTS; ++y) {
+        for (int x = 0; x < POINTS; ++x) {
+          values[table_index(x, y, static_cast<int>(z))] = exact(spacing * glm::dvec3(x, y, z));
+        }
+      }
+    }
+  });
+}
+
+// looked up at |d|, then every component takes the sign of its coordinate back
+glm::dvec3 EwaldTable::correction(const glm::dvec3 &d, double box) const {
+  const glm::dvec3 u = glm::min(glm::abs(d) * (2.0 * EWALD_TABLE_SIZE / box), glm::dvec3(EWALD_TABLE_SIZE));
+  const glm::ivec3 cell = glm::min(glm::ivec3(u), glm::ivec3(EWALD_TABLE_SIZE - 1));
+  const glm::dvec3 f = u - glm::dvec3(cell);
+
+  // trilinear as seven lerps along x, then y, then z
+  const glm::dvec3 *corner = &values[table_index(cell.x, cell.y, cell.z)];
+  constexpr size_t dy = POINTS, dz = POINTS * POINTS;
+  const glm::dvec3 y0 = glm::mix(glm::mix(corner[0], corner[1], f.x), glm::mix(corner[dy], corner[dy + 1], f.x), f.y);
+  const glm::dvec3 y1 = glm::mix(glm::mix(corner[dz], corner[dz + 1], f.x), glm::mix(corner[dz + dy], corner[dz + dy + 1], f.x), f.y);
+  const glm::dvec3 sum = glm::mix(y0, y1, f.z);
+
+  const glm::dvec3 sign(d.x < 0.0 ? -1.0 : 1.0, d.y < 0.0 ? -1.0 : 1.0, d.z < 0.0 ? -1.0 : 1.0);
+  return sum * sign / (box * box);
+}
@@ -3,6 +3,9 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include <sstream>
 #include <chrono>
 #include "gui.hpp"
@@ -28,39 +31,91 @@ void initialize_imgui(GLFWwindow *window) {
   ImGui_ImplOpenGL3_Init("#version 330");
 }
 
-void render_body_editor(CelestialBody &body, int index) {
-  std::string header = "Body " + std::to_string(index);
+// widgets edit local double copies of the snapshot; a command goes out only when one actually changed
+void render_body_editor(AppState &app, const CelestialBody &body, BodyHandle handle) {
+  std::string header = "Body " + std::to_string(handle.slot);
 
   if (ImGui::CollapsingHeader(header.c_str())) {
     ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
 
-    float mass = static_cast<float>(body.mass);
-    if (ImGui::SliderFloat("Mass", &mass, 1e-8f, 1000.0f, "%.8f", ImGuiSliderFlags_Logarithmic)) {
-      body.mass = static_cast<double>(mass);
+    double mass = body.mass;
+    const double mass_min = 1e-8, mass_max = 1000.0;
+    if (ImGui::SliderScalar("Mass", ImGuiDataType_Double, &mass, &mass_min, &mass_max, "%.8f", ImGuiSliderFlags_Logarithmic)) {
+      app.physics->submit({.type = CommandType::SET_MASS, .handle = handle, .scalar = mass});
     }
 
-    float radius = static_cast<float>(body.radius);
-    if (ImGui::SliderFloat("Radius", &radius, 0.01f, 2.0f)) {
-      body.radius = static_cast<double>(radius);
+    double radius = body.radius;
+    const double radius_min = 0.01, radius_max = 2.0;
+    if (ImGui::SliderScalar("Radius", ImGuiDataType_Double, &radius, &radius_min, &radius_max, "%.3f")) {
+      app.physics->submit({.type = CommandType::SET_RADIUS, .handle = handle, .scalar = radius});
     }
 
-    float position[3] = {static_cast<float>(body.position.x),
-                         static_cast<float>(body.position.y),
-                         static_cast<float>(body.position.z)};
-    ImGui::InputFloat3("Position", position, "%.3f");
-    body.position = glm::dvec3(position[0], position[1], position[2]);
+    double density = body.density / GRAM_PER_CM3;
+    const double density_min = 0.1, density_max = 20.0;
+    if (ImGui::SliderScalar("Density", ImGuiDataType_Double, &density, &density_min, &density_max, "%.2f g/cm3",
+                            ImGuiSliderFlags_Logarithmic)) {
+      app.physics->submit({.type = CommandType::SET_DENSITY, .handle = handle, .scalar = density * GRAM_PER_CM3});
+    }
+
+    glm::dvec3 position = body.position;
+    if (ImGui::InputScalarN("Position", ImGuiDataType_Double, &position[0], 3, nullptr, nullptr, "%.3f")) {
+      app.physics->submit({.type = CommandType::SET_POSITION, .handle = handle, .vector = position});
+    }
+
+    glm::dvec3 velocity = body.velocity;
+    if (ImGui::InputScalarN("Velocity", ImGuiDataType_Double, &velocity[0], 3, nullptr, nullptr, "%.6f")) {
+      app.physics->submit({.type = CommandType::SET_VELOCITY, .handle = handle, .vector = velocity});
+    }
+
+    glm::vec3 color = body.color;
+    if (ImGui::ColorEdit3("Color", &color[0])) {
+      app.physics->submit({.type = CommandType::SET_COLOR, .handle = handle, .vector = glm::dvec3(color)});
+    }
+
+    bool is_black_hole = body.is_black_hole;
+    if (ImGui::Checkbox("Black Hole", &is_black_hole)) {
+      app.physics->submit({.type = CommandType::SET_BLACK_HOLE, .handle = handle, .option = is_black_hole});
+    }
+
+    auto &moon = app.gui_props.moon_editor;
+    ImGui::SliderFloat("Moon Mass", &moon.mass, 1e-8f, 1e-2f, "%.2e of planet", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Moon Distance", &moon.distance, 1e-4f, 0.1f, "%.2e AU", ImGuiSliderFlags_Logarithmic);
+    ImGui::SameLine();
+    if (ImGui::Button(("Add Moon##" + std::to_string(handle.slot)).c_str())) {
+      app.physics->submit({.type = CommandType::ADD_MOON, .handle = handle, .scalar = moon.mass * body.mass,
+                           .vector = glm::dvec3(moon.distance, 0.0, 0.0)});
+    }
+
+    auto &ring = app.gui_props.ring_editor;
+    ImGui::SliderInt("Ring Particles", &ring.particles, 1000, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::Checkbox("Shearing Sheet", &ring.shearing_sheet);
+    ImGui::SameLine();
+    if (ImGui::Button(("Add Ring##" + std::to_string(handle.slot)).c_str())) {
+      app.physics->submit({.type = CommandType::ADD_RING, .handle = handle, .scalar = ring.shearing_sheet ? 1.0 : 0.0,
+                           .option = ring.particles});
+    }
+
+    auto &gas = app.gui_props.gas_editor;
+    ImGui::SliderInt("Gas Particles", &gas.particles, 1000, 200000, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::SameLine();
+    if (ImGui::Button(("Add Gas Disk##" + std::to_string(handle.slot)).c_str())) {
+      app.physics->submit({.type = CommandType::ADD_GAS_DISK, .handle = handle, .option = gas.particles});
+    }
 
-    float velocity[3] = {static_cast<float>(body.velocity.x),
-                         static_cast<float>(body.velocity.y),
-                         static_cast<float>(body.velocity.z)};
-    ImGui::InputFloat3("Velocity", velocity, "%.6f");
-    body.velocity = glm::dvec3(velocity[0], velocity[1], velocity[2]);
+    auto &probe = app.gui_props.probe_editor;
+    ImGui::SliderInt("Probes", &probe.count, 1, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Excess Speed", &probe.excess_speed, 0.0f, 20.0f, "%.2f km/s");
+    ImGui::SameLine();
+    if (ImGui::Button(("Launch Probes##" + std::to_string(handle.slot)).c_str())) {
+      app.physics->submit({.type = CommandType::LAUNCH_PROBES, .handle = handle,
+                           .scalar = probe.excess_speed / KM_S_PER_AU_DAY, .option = probe.count});
+    }
 
-    ImGui::ColorEdit3("Color", &body.color[0]);
-    ImGui::Checkbox("Black Hole", &body.is_black_hole);
     ImGui::PushStyleColor(ImGuiCol_Button, (ImVec4)ImColor::HSV(0.0f, 0.6f, 0.6f));
     ImGui::PushStyleColor(ImGuiCol_ButtonHovered, (ImVec4)ImColor::HSV(0.0f, 0.7f, 0.7f));
-    if (ImGui::Button(("Delete##" + std::to_string(index)).c_str())) body.mass = 0;
+    if (ImGui::Button(("Delete##" + std::to_string(handle.slot)).c_str())) {
+      app.physics->submit({.type = CommandType::REMOVE_BODY, .handle = handle});
+    }
     ImGui::PopStyleColor(2);
     ImGui::PopItemWidth();
   }
@@ -70,9 +125,10 @@ void render_simulation_stats(AppState &app, double frame_time) {
   ImGui::Begin("Performance Stats");
 
   ImGui::Text("Frame Time: %.3f ms (%.1f FPS)", frame_time * 1000.0, 1.0 / frame_time);
-  ImGui::Text("Physics Steps: %zu", app.simulation.get_bodies().size() * app.simulation.get_bodies().size());
+  const SimulationSnapshot &snapshot = *app.snapshot;
+  ImGui::Text("Physics Steps: %zu", snapshot.body_count * snapshot.body_count);
 
-  size_t body_size = app.simulation.get_bodies().size() * sizeof(CelestialBody);
+  size_t body_size = snapshot.body_count * sizeof(CelestialBody);
   ImGui::Text("Memory: %.2f KB", body_size / 1024.0f);
 
   ImGui::Separator();
@@ -81,7 +137,90 @@ void render_simulation_stats(AppState &app, double frame_time) {
 
   ImGui::Separator();
   ImGui::Text("Integrator: Velocity Verlet");
-  ImGui::Text("Time Step: %.4f s", 1.0 / 100 * app.simulation_speed);
+  ImGui::Text("Force Kernel: %s", force_kernel_name(snapshot.force_kernel));
+  ImGui::Text("Time Step: %.4f s", snapshot.time_warp ? PHYSICS_DT : PHYSICS_DT * app.simulation_speed);
+  ImGui::Text("Warp: %.1f x achieved of %.1f x", snapshot.achieved_warp, app.simulation_speed);
+  if (snapshot.time_warp) {
+    ImGui::Text("Physics Budget: %.2f ms per tick", snapshot.physics_budget * 1000.0);
+  }
+
+  ImGui::Separator();
+  ImGui::Text("Physics Threads: %u", snapshot.thread_count);
+  ImGui::Text("Physics Rate: %.1f steps/s", snapshot.steps_per_second);
+  ImGui::Text("Simulation Time: %.3f days", snapshot.time);
+  ImGui::Text("Steps: %llu", static_cast<unsigned long long>(snapshot.step_count));
+  if (ImGui::Button("Measure float32 kernel error")) {
+    app.physics->submit({.type = CommandType::MEASURE_FORCE_ERROR});
+  }
+  if (snapshot.has_force_error_report) {
+    const auto &report = snapshot.force_error_report;
+    ImGui::Text("Max rel. error: %.3e, RMS: %.3e", report.max_relative_error, report.rms_relative_error);
+    ImGui::Text("Mixed: %.3f ms, Double: %.3f ms", report.mixed_seconds * 1000.0, report.double_seconds * 1000.0);
+  }
+  if (snapshot.force_solver == ForceSolver::BARNES_HUT) {
+    const auto &tree = snapshot.tree_stats;
+    ImGui::Text("Octree: %zu nodes, %s last step", tree.node_count, tree.rebuilt_last_step ? "rebuilt" : "refitted");
+    ImGui::Text("Rebuilds: %llu, Refits: %llu", static_cast<unsigned long long>(tree.rebuilds),
+                static_cast<unsigned long long>(tree.refits));
+    ImGui::Text("Build: %.3f ms, Refit: %.3f ms, Quality: %.2f", tree.build_seconds * 1000.0,
+                tree.refit_seconds * 1000.0, tree.quality);
+  }
+  if (snapshot.adaptive_softening) {
+    const auto &softening = snapshot.softening;
+    ImGui::Text("Softening: mean %.3e AU, min %.3e AU, refresh %.3f ms", softening.mean_length, softening.min_length,
+                softening.refresh_seconds * 1000.0);
+  }
+  if (snapshot.disruption.enabled) {
+    const auto &disruption = snapshot.disruption_stats;
+    ImGui::Text("Disruptions: %llu, %llu fragments, %zu test particles, last %.3f ms",
+                static_cast<unsigned long long>(disruption.events), static_cast<unsigned long long>(disruption.fragments),
+                snapshot.test_particles, disruption.last_seconds * 1000.0);
+    if (disruption.deferred > 0) {
+      ImGui::Text("%llu inside a Roche limit wait for a later check", static_cast<unsigned long long>(disruption.deferred));
+    }
+  }
+  if (snapshot.probes > 0) {
+    const auto &probes = snapshot.probe_stats;
+    ImGui::Text("Probes: %zu, %llu SOI transitions, last %.3f ms", snapshot.probes,
+                static_cast<unsigned long long>(probes.transitions), probes.seconds * 1000.0);
+    if (ImGui::Button("Clear Probes")) {
+      app.physics->submit({.type = CommandType::CLEAR_PROBES});
+    }
+  }
+  if (snapshot.variational) {
+    ImGui::Text("MEGNO: %.3f (mean %.3f), Lyapunov: %.3e / day", snapshot.chaos.megno, snapshot.chaos.mean_megno,
+                snapshot.chaos.lyapunov);
+  }
+  for (const auto &ring : snapshot.rings) {
+    ImGui::Text("%s: %zu particles, %zu collisions, %.3f ms",
+                ring.geometry == RingGeometry::SHEARING_SHEET ? "Shearing sheet" : "Ring", ring.particles,
+                ring.collisions, ring.collision_seconds * 1000.0);
+    ImGui::Text("Velocity dispersion: %.3e AU/day, particle radius %.2e AU", ring.velocity_dispersion,
+                ring.particle_radius);
+  }
+  if (snapshot.has_gas) {
+    const auto &gas = snapshot.gas;
+    ImGui::Text("Gas: %zu particles, %.1f neighbours, step %.3f days", gas.particles, gas.mean_neighbours, gas.step);
+    ImGui::Text("Lists: %llu builds, reused %llu steps, build %.3f ms", static_cast<unsigned long long>(gas.list_builds),
+                static_cast<unsigned long long>(gas.steps_since_build), gas.list_seconds * 1000.0);
+    ImGui::Text("Density: %.3f ms, Forces: %.3f ms, Accreted: %.3e", gas.density_seconds * 1000.0,
+                gas.force_seconds * 1000.0, gas.accreted_mass);
+    if (ImGui::Button("Remove Gas Disk")) {
+      app.physics->submit({.type = CommandType::REMOVE_GAS_DISK});
+    }
+  }
+  if (snapshot.has_tuning_result) {
+    const auto &tuning = snapshot.tuning_result;
+    const char *solver_names[] = {"Direct", "Mixed", "Barnes-Hut"};
+    ImGui::Text("Tuned: %s, %u threads, tile %u, leaf %u%s", solver_names[static_cast<int>(tuning.config.solver)],
+                tuning.config.threads, tuning.config.mixed_tile_size, tuning.config.leaf_size,
+                tuning.from_cache ? " (cached)" : "");
+    ImGui::Text("Force eval: %.3f ms, RMS error: %.1e, %zu candidates in %.2f s%s", tuning.seconds * 1000.0,
+                tuning.rms_error, tuning.candidates, tuning.tuning_seconds, tuning.over_budget ? " (budget)" : "");
+  }
+  if (snapshot.deterministic) {
+    ImGui::Text("State Hash: %016llx", static_cast<unsigned long long>(snapshot.state_hash));
+  }
 
   ImGui::End();
 }
@@ -106,6 +245,141 @@ void render_camera_info(Camera &camera) {
   ImGui::End();
 }
 
+// blue at the best delta-v through green and yellow to red at PORKCHOP_RANGE times it, on a
+// log scale; cells without a transfer stay dark grey
+static void upload_porkchop(AppState &app) {
+  const PorkchopGrid &grid = *app.porkchop;
+  const int width = grid.config.departures, height = grid.config.arrivals;
+  std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+  for (size_t cell = 0; cell < grid.delta_v.size(); ++cell) {
+    unsigned char *pixel = &pixels[cell * 4];
+    pixel[3] = 255;
+    if (std::isnan(grid.delta_v[cell])) {
+      pixel[0] = pixel[1] = pixel[2] = 40;
+      continue;
+    }
+    const float t = std::clamp(std::log(grid.delta_v[cell] / grid.min_delta_v) / std::log(static_cast<float>(PORKCHOP_RANGE)),
+                               0.0f, 1.0f);
+    const ImVec4 color = (ImVec4)ImColor::HSV(0.66f * (1.0f - t), 0.85f, 0.3f + 0.7f * (1.0f - 0.5f * t));
+    pixel[0] = static_cast<unsigned char>(255.0f * color.x);
+    pixel[1] = static_cast<unsigned char>(255.0f * color.y);
+    pixel[2] = static_cast<unsigned char>(255.0f * color.z);
+  }
+
+  if (app.porkchop_texture == 0) glGenTextures(1, &app.porkchop_texture);
+  glBindTexture(GL_TEXTURE_2D, app.porkchop_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+// picks one of the listed bodies by handle, named as in the body editor
+static void body_combo(const char *label, BodyHandle &handle, const SimulationSnapshot &snapshot) {
+  const std::string current = handle == BodyHandle{} ? "none" : "Body " + std::to_string(handle.slot);
+  if (!ImGui::BeginCombo(label, current.c_str())) return;
+  const size_t listed = std::min<size_t>(snapshot.handles.size(), LISTED_BODIES);
+  for (size_t i = 0; i < listed; ++i) {
+    const std::string name = "Body " + std::to_string(snapshot.handles[i].slot);
+    if (ImGui::Selectable(name.c_str(), snapshot.handles[i] == handle)) handle = snapshot.handles[i];
+  }
+  ImGui::EndCombo();
+}
+
+// departure date across, arrival date up. The physics thread solves the grid from its
+// current state between ticks and publishes it; the heatmap is rebuilt when a new one arrives
+void render_porkchop_window(AppState &app) {
+  ImGui::Begin("Porkchop Plot", &app.gui_props.show_porkchop, ImGuiWindowFlags_AlwaysAutoResize);
+  PorkchopConfig &config = app.gui_props.porkchop_editor;
+  const SimulationSnapshot &snapshot = *app.snapshot;
+
+  // earth to mars in the solar system scene until something else is picked
+  if (config.departure == BodyHandle{} && config.arrival == BodyHandle{} && snapshot.handles.size() > 4) {
+    config.departure = snapshot.handles[3];
+    config.arrival = snapshot.handles[4];
+  }
+  ImGui::PushItemWidth(MIN_SLIDER_WIDTH);
+  body_combo("Departure Body", config.departure, snapshot);
+  body_combo("Arrival Body", config.arrival, snapshot);
+  ImGui::InputDouble("Depart From (days)", &config.departure_start, 10.0, 100.0, "%.0f");
+  ImGui::InputDouble("Departure Window", &config.departure_span, 10.0, 100.0, "%.0f");
+  ImGui::InputDouble("Arrive From (days)", &config.arrival_start, 10.0, 100.0, "%.0f");
+  ImGui::InputDouble("Arrival Window", &config.arrival_span, 10.0, 100.0, "%.0f");
+  ImGui::SliderInt("Grid", &config.departures, 16, PORKCHOP_MAX_CELLS, "%d", ImGuiSliderFlags_Logarithmic);
+  config.arrivals = config.departures;
+  ImGui::SliderInt("Revolutions", &config.max_revolutions, 0, LAMBERT_MAX_REVOLUTIONS);
+  ImGui::PopItemWidth();
+
+  ImGui::BeginDisabled(app.porkchop_pending);
+  if (ImGui::Button("Compute")) {
+    app.physics->submit({.type = CommandType::COMPUTE_PORKCHOP, .porkchop = config});
+    app.porkchop_pending = true;
+  }
+  ImGui::EndDisabled();
+
+  if (snapshot.porkchop != app.porkchop) {
+    app.porkchop = snapshot.porkchop;
+    app.porkchop_pending = false;
+    if (!app.porkchop->delta_v.empty()) upload_porkchop(app);
+  }
+  if (app.porkchop_pending) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("computing...");
+  }
+
+  if (!app.porkchop || app.porkchop->delta_v.empty()) {
+    ImGui::TextDisabled("Pick two bodies orbiting the heaviest one and compute.");
+    ImGui::End();
+    return;
+  }
+  const PorkchopGrid &grid = *app.porkchop;
+
+  const PorkchopConfig &computed = grid.config;
+  const double departure_step = computed.departures > 1 ? computed.departure_span / (computed.departures - 1) : 0.0;
+  const double arrival_step = computed.arrivals > 1 ? computed.arrival_span / (computed.arrivals - 1) : 0.0;
+  if (grid.best_departure >= 0) {
+    const double depart = computed.departure_start + departure_step * grid.best_departure;
+    const double arrive = computed.arrival_start + arrival_step * grid.best_arrival;
+    ImGui::Text("Best: %.2f km/s, depart +%.0f d, %.0f d flight, %d rev", grid.min_delta_v * KM_S_PER_AU_DAY, depart,
+                arrive - depart, grid.best_revolutions);
+  }
+  ImGui::Text("%d x %d transfers in %.1f ms", computed.departures, computed.arrivals, grid.seconds * 1000.0);
+
+  // row 0 is the earliest arrival, at the bottom
+  const ImVec2 size(UI_WIDTH, UI_WIDTH);
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  ImGui::Image(static_cast<ImTextureID>(app.porkchop_texture), size, ImVec2(0, 1), ImVec2(1, 0));
+  if (ImGui::IsItemHovered()) {
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const int column = std::clamp(static_cast<int>((mouse.x - origin.x) / size.x * computed.departures), 0, computed.departures - 1);
+    const int row = std::clamp(static_cast<int>((1.0f - (mouse.y - origin.y) / size.y) * computed.arrivals), 0, computed.arrivals - 1);
+    const float delta_v = grid.delta_v[static_cast<size_t>(row) * computed.departures + column];
+    const double depart = computed.departure_start + departure_step * column;
+    const double arrive = computed.arrival_start + arrival_step * row;
+    if (std::isnan(delta_v)) {
+      ImGui::SetTooltip("depart +%.0f d, arrive +%.0f d\nno transfer", depart, arrive);
+    } else {
+      ImGui::SetTooltip("depart +%.0f d, arrive +%.0f d\n%.2f km/s", depart, arrive, delta_v * KM_S_PER_AU_DAY);
+    }
+  }
+  ImGui::End();
+}
+
+// Combo whose items in the excluded bit mask are shown greyed out and cannot be picked
+static bool combo_excluding(const char *label, int &current, const char *const items[], int count, unsigned excluded) {
+  bool changed = false;
+  if (ImGui::BeginCombo(label, items[current])) {
+    for (int k = 0; k < count; ++k) {
+      const ImGuiSelectableFlags flags = excluded & (1u << k) ? ImGuiSelectableFlags_Disabled : ImGuiSelectableFlags_None;
+      if (ImGui::Selectable(items[k], k == current, flags) && k != current) {
+        current = k;
+        changed = true;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  return changed;
+}
+
 void render_help_window() {
   ImGui::Begin("Controls Help", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
   ImGui::Text("Camera Controls:");
@@ -137,19 +411,126 @@ void render_gui(AppState &app) {
   ImGui::Checkbox("Pause Simulation", &app.is_paused);
   ImGui::SameLine();
   if (ImGui::Button("Reset")) {
-    app.simulation.reset_to_solar_system();
-    app.simulation.setG(DEFAULT_G);
+    app.physics->submit({.type = CommandType::RESET});
+    app.physics->submit({.type = CommandType::SET_G, .scalar = DEFAULT_G});
   }
 
   ImGui::SliderFloat("Simulation Speed", &app.simulation_speed, 0.1f, 1000.0f, "%.1f x", ImGuiSliderFlags_Logarithmic);
+  ImGui::Checkbox("Time Warp (fixed step)", &app.time_warp);
 
-  float G = static_cast<float>(app.simulation.getG());
+  const SimulationSnapshot &snapshot = *app.snapshot;
+  float G = static_cast<float>(snapshot.G);
   if (ImGui::SliderFloat("G Constant", &G, 1e-7f, 1e-3f, "%.8f", ImGuiSliderFlags_Logarithmic)) {
-    app.simulation.setG(static_cast<double>(G));
+    app.physics->submit({.type = CommandType::SET_G, .scalar = static_cast<double>(G)});
   }
 
   ImGui::Checkbox("Enable lighting", &app.gui_props.lighting_enabled);
 
+  bool deterministic = snapshot.deterministic;
+  if (ImGui::Checkbox("Deterministic physics", &deterministic)) {
+    app.physics->submit({.type = CommandType::SET_DETERMINISTIC, .option = deterministic});
+  }
+
+  // while the chaos indicators run, the modes without a tangent map are greyed out, and so
+  // are the pair kernels above DIRECT_MAX_BODIES
+  const char *precision_modes[] = {"Double", "Compensated", "Double-double"};
+  int precision = static_cast<int>(snapshot.precision);
+  if (combo_excluding("Precision", precision, precision_modes, IM_ARRAYSIZE(precision_modes),
+                      snapshot.variational || !snapshot.direct_supported
+                          ? 1u << static_cast<int>(PrecisionMode::DOUBLE_DOUBLE)
+                          : 0u)) {
+    app.physics->submit({.type = CommandType::SET_PRECISION, .option = precision});
+  }
+
+  const char *force_solvers[] = {"Direct (double)", "Mixed (float32)", "Barnes-Hut (octree)"};
+  int solver = static_cast<int>(snapshot.force_solver);
+  unsigned excluded_solvers = snapshot.variational ? ~(1u << static_cast<int>(ForceSolver::DIRECT)) : 0u;
+  if (!snapshot.direct_supported) excluded_solvers |= ~(1u << static_cast<int>(ForceSolver::BARNES_HUT));
+  if (combo_excluding("Force Kernel", solver, force_solvers, IM_ARRAYSIZE(force_solvers), excluded_solvers)) {
+    app.physics->submit({.type = CommandType::SET_FORCE_SOLVER, .option = solver});
+  }
+  if (!snapshot.direct_supported) ImGui::TextDisabled("Pair kernels take at most %d bodies", DIRECT_MAX_BODIES);
+
+  bool periodic = snapshot.periodic.enabled;
+  double box_size = snapshot.periodic.box_size;
+  const bool periodic_changed = ImGui::Checkbox("Periodic Box (Ewald)", &periodic);
+  ImGui::SameLine();
+  if (periodic_changed || ImGui::InputDouble("Box Size", &box_size, 0.0, 0.0, "%.3f AU", ImGuiInputTextFlags_EnterReturnsTrue)) {
+    app.physics->submit({.type = CommandType::SET_PERIODIC, .scalar = box_size, .option = periodic});
+  }
+
+  DisruptionConfig disruption = snapshot.disruption;
+  int fragments = static_cast<int>(disruption.fragments);
+  bool disruption_changed = ImGui::Checkbox("Tidal Disruption", &disruption.enabled);
+  ImGui::SameLine();
+  disruption_changed |= ImGui::Checkbox("As Test Particles", &disruption.test_particles);
+  disruption_changed |= ImGui::SliderInt("Fragments", &fragments, 10, DISRUPTION_MAX_FRAGMENTS, "%d", ImGuiSliderFlags_Logarithmic);
+  if (disruption_changed) {
+    app.physics->submit({.type = CommandType::SET_DISRUPTION, .scalar = static_cast<double>(fragments),
+                         .vector = glm::dvec3(disruption.test_particles ? 1.0 : 0.0, 0.0, 0.0),
+                         .option = disruption.enabled});
+  }
+
+  bool adaptive_softening = snapshot.adaptive_softening;
+  ImGui::BeginDisabled(snapshot.variational);
+  if (ImGui::Checkbox("Adaptive Softening (k-NN)", &adaptive_softening)) {
+    app.physics->submit({.type = CommandType::SET_SOFTENING, .option = adaptive_softening});
+  }
+  ImGui::EndDisabled();
+  if (snapshot.force_kernel == ForceKernel::SOFTENED &&
+      (snapshot.force_solver == ForceSolver::MIXED_PRECISION || snapshot.precision == PrecisionMode::COMPENSATED ||
+       snapshot.deterministic)) {
+    ImGui::TextDisabled("Softening runs its own direct kernel in place of");
+    ImGui::TextDisabled("float32, compensated sums and deterministic tiles");
+  }
+
+  bool variational = snapshot.variational;
+  ImGui::BeginDisabled(!variational && !snapshot.variational_supported);
+  if (ImGui::Checkbox("Chaos Indicators (MEGNO)", &variational)) {
+    app.physics->submit({.type = CommandType::SET_VARIATIONAL, .option = variational});
+  }
+  ImGui::EndDisabled();
+  if (variational) {
+    ImGui::TextDisabled("MEGNO needs the direct kernel: other kernels, double-double,");
+    ImGui::TextDisabled("softening and auto-tuning are off while it runs");
+  } else if (!snapshot.variational_supported) {
+    ImGui::TextDisabled("MEGNO needs the direct kernel in double or compensated precision,");
+    ImGui::TextDisabled("without softening or auto-tuning");
+  }
+
+  if (ImGui::CollapsingHeader("External Forces")) {
+    const auto names = ExternalForces::names();
+    for (size_t k = 0; k < names.size(); ++k) {
+      bool enabled = snapshot.external_forces[k];
+      if (ImGui::Checkbox(names[k], &enabled)) {
+        app.physics->submit({.type = CommandType::SET_EXTERNAL_FORCE, .scalar = enabled ? 1.0 : 0.0,
+                             .option = static_cast<int>(k)});
+      }
+    }
+  }
+
+  bool auto_tune = snapshot.auto_tune;
+  ImGui::BeginDisabled(!auto_tune && !snapshot.tuning_supported);
+  if (ImGui::Checkbox("Auto-tune Force Kernel", &auto_tune)) {
+    app.physics->submit({.type = CommandType::SET_AUTO_TUNE, .option = auto_tune});
+  }
+  ImGui::EndDisabled();
+  if (!snapshot.tuning_supported) {
+    ImGui::TextDisabled("%s while the periodic box, softening, double-double", auto_tune ? "Paused" : "Unavailable");
+    ImGui::TextDisabled("or MEGNO replace the force kernel");
+  }
+  double tuning_accuracy = snapshot.tuning_accuracy;
+  const double min_accuracy = 1e-7, max_accuracy = 1e-1;
+  if (ImGui::SliderScalar("Tuning Accuracy", ImGuiDataType_Double, &tuning_accuracy, &min_accuracy, &max_accuracy, "%.1e",
+                          ImGuiSliderFlags_Logarithmic)) {
+    app.physics->submit({.type = CommandType::SET_TUNING_ACCURACY, .scalar = tuning_accuracy});
+  }
+
+  int reorder_interval = snapshot.reorder_interval;
+  if (ImGui::SliderInt("Morton Reorder (steps)", &reorder_interval, 0, 1000, reorder_interval == 0 ? "off" : "%d")) {
+    app.physics->submit({.type = CommandType::SET_REORDER_INTERVAL, .option = reorder_interval});
+  }
+
   ImGui::Separator();
   ImGui::Text("Show Windows:");
   ImGui::SameLine();
@@ -158,18 +539,65 @@ void render_gui(AppState &app) {
   ImGui::Checkbox("Help", &app.gui_props.show_help);
   ImGui::SameLine();
   ImGui::Checkbox("Camera", &app.gui_props.show_caminfo);
+  ImGui::SameLine();
+  ImGui::Checkbox("Porkchop", &app.gui_props.show_porkchop);
 
   ImGui::Separator();
   if (ImGui::CollapsingHeader("Celestial Bodies", ImGuiTreeNodeFlags_DefaultOpen)) {
-    auto &bodies = app.simulation.get_bodies();
-    for (size_t i = 0; i < bodies.size(); i++) {
-      ImGui::PushID(i);
-      render_body_editor(bodies[i], static_cast<int>(i));
+    const auto &bodies = snapshot.bodies;
+    const size_t listed = std::min<size_t>(bodies.size(), LISTED_BODIES);
+    for (size_t i = 0; i < listed; i++) {
+      ImGui::PushID(snapshot.handles[i].slot);
+      render_body_editor(app, bodies[i], snapshot.handles[i]);
       ImGui::PopID();
     }
+    if (listed < snapshot.body_count) ImGui::TextDisabled("... and %zu more", snapshot.body_count - listed);
+  }
+
+  if (ImGui::CollapsingHeader("Generate Scene")) {
+    auto &scene = app.gui_props.scene_editor;
+    const char *presets[] = {scene_name(ScenePreset::PLUMMER), scene_name(ScenePreset::EXPONENTIAL_DISK),
+                             scene_name(ScenePreset::ASTEROID_BELT), scene_name(ScenePreset::OORT_CLOUD),
+                             scene_name(ScenePreset::COLLIDING_GALAXIES)};
+    ImGui::Combo("Preset", &scene.preset, presets, IM_ARRAYSIZE(presets));
+    ImGui::SliderInt("Scene Bodies", &scene.bodies, 100, 10000000, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::InputInt("Seed", &scene.seed);
+    if (ImGui::Button("Generate")) {
+      app.physics->submit({.type = CommandType::LOAD_SCENE, .scalar = static_cast<double>(scene.bodies),
+                           .vector = glm::dvec3(static_cast<double>(std::max(scene.seed, 0)), 0.0, 0.0),
+                           .option = scene.preset});
+    }
   }
 
-  if (ImGui::CollapsingHeader("Add Body") && app.simulation.bodies.size() < MAX_BODIES) {
+  if (ImGui::CollapsingHeader("Ensemble")) {
+    auto &ensemble = app.gui_props.ensemble_editor;
+    ImGui::SliderInt("Members", &ensemble.members, 8, 1024, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Perturbation", &ensemble.sigma, 1e-12f, 1e-2f, "%.1e", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Span", &ensemble.span, 1.0f, 3650.0f, "%.0f days", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Step", &ensemble.step, 0.01f, 1.0f, "%.3f days", ImGuiSliderFlags_Logarithmic);
+    const int steps = static_cast<int>(std::ceil(ensemble.span / ensemble.step));
+    const double interactions = Ensemble::interactions(static_cast<size_t>(ensemble.members), snapshot.body_count, steps);
+    if (snapshot.ensemble_running) {
+      ImGui::ProgressBar(static_cast<float>(snapshot.ensemble_progress));
+      if (ImGui::Button("Cancel Ensemble")) app.physics->submit({.type = CommandType::CANCEL_ENSEMBLE});
+    } else if (snapshot.body_count > ENSEMBLE_MAX_BODIES) {
+      ImGui::TextDisabled("Ensembles take at most %d bodies", ENSEMBLE_MAX_BODIES);
+    } else if (interactions > ENSEMBLE_MAX_INTERACTIONS) {
+      ImGui::TextDisabled("%.1e pair evaluations, at most %.0e per run", interactions, ENSEMBLE_MAX_INTERACTIONS);
+    } else if (ImGui::Button("Run Ensemble")) {
+      app.physics->submit({.type = CommandType::RUN_ENSEMBLE, .scalar = ensemble.sigma,
+                           .vector = glm::dvec3(ensemble.span, ensemble.step, 0.0), .option = ensemble.members});
+    }
+    if (snapshot.has_ensemble_report) {
+      const auto &report = snapshot.ensemble_report;
+      ImGui::Text("%zu members x %zu bodies over %.0f days in %.3f s", report.members, report.bodies, report.span,
+                  report.seconds);
+      ImGui::Text("Energy error: median %.3e, max %.3e", report.median_energy_error, report.max_energy_error);
+      ImGui::Text("Ejected: %zu, closest approach %.3e AU", report.ejected, report.min_separation);
+    }
+  }
+
+  if (ImGui::CollapsingHeader("Add Body") && snapshot.body_count < MAX_BODIES) {
     static CelestialBody new_body;
     new_body.mass          = app.gui_props.body_editor.mass;
     new_body.radius        = app.gui_props.body_editor.radius;
@@ -192,7 +620,7 @@ void render_gui(AppState &app) {
     new_body.is_black_hole = app.gui_props.body_editor.is_black_hole;
 
     if (ImGui::Button("Add")) {
-      app.simulation.add_body(new_body);
+      app.physics->submit({.type = CommandType::ADD_BODY, .body = new_body});
     }
   }
 
@@ -208,6 +636,10 @@ void render_gui(AppState &app) {
     render_camera_info(*app.camera);
   }
 
+  if (app.gui_props.show_porkchop) {
+    render_porkchop_window(app);
+  }
+
   ImGui::End();
   ImGui::Render();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
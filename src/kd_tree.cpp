@@ -0,0 +1,108 @@
+#include <cmath>
+#include <numeric>
+#include "kd_tree.hpp"
+#include "scheduler.hpp"
+
+uint32_t KdTree::original(uint32_t slot) const        { return order[slot]; }
+const std::vector<uint32_t> &KdTree::get_order() const { return order; }
+size_t KdTree::size() const                           { return points.size(); }
+
+void KdTree::build(const std::vector<glm::dvec3> &source, const std::vector<double> &source_reach) {
+  const size_t n = source.size();
+  order.resize(n);
+  std::iota(order.begin(), order.end(), 0u);
+
+  depth = 0;
+  while ((n >> depth) > KD_TREE_LEAF_SIZE) ++depth;
+  first_leaf = (size_t(1) << depth) - 1;
+  nodes.assign((size_t(2) << depth) - 1, KdNode{});
+  nodes[0].begin = 0;
+  nodes[0].end = static_cast<uint32_t>(n);
+  if (n > 0) build_node(0, 0, source, source_reach);
+
+  points.resize(n);
+  reach.resize(n);
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t slot = begin; slot < end; ++slot) {
+      points[slot] = source[order[slot]];
+      reach[slot] = source_reach.empty() ? 0.0 : source_reach[order[slot]];
+    }
+  });
+}
+
+// depth first with the nearer child first, keeping the k closest squared distances in a
+// max-heap; once it is full every node farther than its top is skipped
+double KdTree::nearest_distance(const glm::dvec3 &p, unsigned k) const {
+  k = std::min(k, static_cast<unsigned>(KD_TREE_MAX_NEIGHBOURS));
+  if (k == 0 || k > points.size()) return INFINITY;
+
+  const auto gap_sq = [&](const KdNode &node) {
+    return glm::length2(glm::max(glm::max(node.lo - p, p - node.hi), glm::dvec3(0.0)));
+  };
+  double heap[KD_TREE_MAX_NEIGHBOURS];
+  unsigned count = 0;
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const uint32_t id = stack[--top];
+    const KdNode &node = nodes[id];
+    if (node.begin == node.end || (count == k && gap_sq(node) >= heap[0])) continue;
+
+    if (id < first_leaf) {
+      const bool left_first = gap_sq(nodes[2 * id + 1]) <= gap_sq(nodes[2 * id + 2]);
+      stack[top++] = left_first ? 2 * id + 2 : 2 * id + 1;
+      stack[top++] = left_first ? 2 * id + 1 : 2 * id + 2;
+      continue;
+    }
+    for (uint32_t slot = node.begin; slot < node.end; ++slot) {
+      const double distance_sq = glm::length2(points[slot] - p);
+      if (count < k) {
+        heap[count++] = distance_sq;
+        std::push_heap(heap, heap + count);
+      } else if (distance_sq < heap[0]) {
+        std::pop_heap(heap, heap + k);
+        heap[k - 1] = distance_sq;
+        std::push_heap(heap, heap + k);
+      }
+    }
+  }
+  return std::sqrt(heap[0]);
+}
+
+// bounds first, they pick the split axis; the reach of an inner node comes from its children
+void KdTree::build_node(size_t id, int level, const std::vector<glm::dvec3> &source,
+                        const std::vector<double> &source_reach) {
+  KdNode &node = nodes[id];
+  node.lo = glm::dvec3(INFINITY);
+  node.hi = glm::dvec3(-INFINITY);
+  node.reach = 0.0;
+  for (uint32_t k = node.begin; k < node.end; ++k) {
+    node.lo = glm::min(node.lo, source[order[k]]);
+    node.hi = glm::max(node.hi, source[order[k]]);
+    if (level == depth && !source_reach.empty()) node.reach = std::max(node.reach, source_reach[order[k]]);
+  }
+  if (level == depth) return;
+
+  const glm::dvec3 extent = node.hi - node.lo;
+  const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+  const uint32_t mid = node.begin + (node.end - node.begin) / 2;
+  std::nth_element(order.begin() + node.begin, order.begin() + mid, order.begin() + node.end,
+                   [&](uint32_t a, uint32_t b) { return source[a][axis] < source[b][axis]; });
+
+  KdNode &left = nodes[2 * id + 1], &right = nodes[2 * id + 2];
+  left.begin = node.begin;
+  left.end = right.begin = mid;
+  right.end = node.end;
+
+  if (level < KD_TREE_PARALLEL_DEPTH) {
+    TaskGroup group;
+    scheduler().submit(group, [&, id, level] { build_node(2 * id + 1, level + 1, source, source_reach); });
+    build_node(2 * id + 2, level + 1, source, source_reach);
+    scheduler().wait(group);
+  } else {
+    build_node(2 * id + 1, level + 1, source, source_reach);
+    build_node(2 * id + 2, level + 1, source, source_reach);
+  }
+  node.reach = std::max(nodes[2 * id + 1].reach, nodes[2 * id + 2].reach);
+}
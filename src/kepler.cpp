@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include "kepler.hpp"
+
+namespace {
+
+constexpr double PI = std::numbers::pi;
+
+void stumpff(double psi, double &c2, double &c3) {
+  if (psi > 1e-6) {
+    const double s = std::sqrt(psi);
+    c2 = (1.0 - std::cos(s)) / psi;
+    c3 = (s - std::sin(s)) / (s * psi);
+  } else if (psi < -1e-6) {
+    const double s = std::sqrt(-psi);
+    c2 = (1.0 - std::cosh(s)) / psi;
+    c3 = (std::sinh(s) - s) / (s * -psi);
+  } else {
+    c2 = 0.5 - psi * (1.0 / 24.0 - psi / 720.0);
+    c3 = 1.0 / 6.0 - psi * (1.0 / 120.0 - psi / 5040.0);
+  }
+}
+
+// nondimensional time of flight and its derivatives along Lancaster-Blanchard's x for a
+// transfer parameter lambda; the notation follows Izzo's paper
+struct LambertCurve {
+  double lambda;
+
+  // 2F1(3, 1, 5/2, z), for x near 1 where the closed forms cancel
+  static double hypergeometric(double z) {
+    double sum = 1.0, term = 1.0;
+    for (int j = 0; j < 64; ++j) {
+      term *= (3.0 + j) * (1.0 + j) / (2.5 + j) * z / (j + 1.0);
+      sum += term;
+      if (std::abs(term) < 1e-11) break;
+    }
+    return sum;
+  }
+
+  double time_lagrange(double x, int revolutions) const {
+    const double a = 1.0 / (1.0 - x * x);
+    if (a > 0.0) {
+      const double alpha = 2.0 * std::acos(x);
+      const double beta = std::copysign(2.0 * std::asin(std::sqrt(lambda * lambda / a)), lambda);
+      return a * std::sqrt(a) * ((alpha - std::sin(alpha)) - (beta - std::sin(beta)) + 2.0 * PI * revolutions) / 2.0;
+    }
+    const double alpha = 2.0 * std::acosh(x);
+    const double beta = std::copysign(2.0 * std::asinh(std::sqrt(-lambda * lambda / a)), lambda);
+    return -a * std::sqrt(-a) * ((beta - std::sinh(beta)) - (alpha - std::sinh(alpha))) / 2.0;
+  }
+
+  double time(double x, int revolutions) const {
+    const double distance = std::abs(x - 1.0);
+    if (distance < 0.2 && distance > 0.01) return time_lagrange(x, revolutions);
+
+    const double E = x * x - 1.0;
+    const double rho = std::abs(E);
+    const double z = std::sqrt(1.0 + lambda * lambda * E);
+    if (distance < 0.01) { // Battin's series
+      const double eta = z - lambda * x;
+      const double S1 = 0.5 * (1.0 - lambda - x * eta);
+      const double Q = 4.0 / 3.0 * hypergeometric(S1);
+      return (eta * eta * eta * Q + 4.0 * lambda * eta) / 2.0 + revolutions * PI / std::pow(rho, 1.5);
+    }
+    const double y = std::sqrt(rho);
+    const double g = x * z - lambda * E;
+    const double d = E < 0.0 ? revolutions * PI + std::acos(g) : std::log(y * (z - lambda * x) + g);
+    return (x - lambda * z - d / y) / E;
+  }
+
+  void derivatives(double x, double T, double &dT, double &ddT, double &dddT) const {
+    const double l2 = lambda * lambda, l3 = l2 * lambda;
+    const double umx2 = 1.0 - x * x;
+    const double y = std::sqrt(1.0 - l2 * umx2);
+    const double y2 = y * y, y3 = y2 * y;
+    dT = (3.0 * T * x - 2.0 + 2.0 * l3 * x / y) / umx2;
+    ddT = (3.0 * T + 5.0 * x * dT + 2.0 * (1.0 - l2) * l3 / y3) / umx2;
+    dddT = (7.0 * x * ddT + 8.0 * dT - 6.0 * (1.0 - l2) * l2 * l3 * x / y3 / y2) / umx2;
+  }
+
+  double householder(double T, double x, int revolutions, double tolerance) const {
+    for (int iteration = 0; iteration < 15; ++iteration) {
+      const double t = time(x, revolutions);
+      double dT, ddT, dddT;
+      derivatives(x, t, dT, ddT, dddT);
+      const double delta = t - T;
+      const double dT2 = dT * dT;
+      const double next = x - delta * (dT2 - delta * ddT / 2.0) / (dT * (dT2 - delta * ddT) + dddT * delta * delta / 6.0);
+      const double error = std::abs(x - next);
+      x = next;
+      if (error < tolerance) break;
+    }
+    return x;
+  }
+};
+
+} // namespace
+
+KeplerState propagate_kepler(const KeplerState &state, double mu, double dt) {
+  const glm::dvec3 r0 = state.position, v0 = state.velocity;
+  const double r0_norm = glm::length(r0);
+  const double sqrt_mu = std::sqrt(mu);
+  const double radial = glm::dot(r0, v0) / sqrt_mu;
+  const double alpha = 2.0 / r0_norm - glm::dot(v0, v0) / mu; // 1 / a
+
+  // time since the start as a function of the universal anomaly, increasing since its
+  // derivative is r / sqrt(mu); r is returned alongside
+  double c2, c3, psi, r;
+  const auto time_at = [&](double chi) {
+    psi = chi * chi * alpha;
+    stumpff(psi, c2, c3);
+    r = chi * chi * c2 + radial * chi * (1.0 - psi * c3) + r0_norm * (1.0 - psi * c2);
+    return (chi * chi * chi * c3 + radial * chi * chi * c2 + r0_norm * chi * (1.0 - psi * c3)) / sqrt_mu;
+  };
+
+  // Newton kept inside a bracket and bisecting whenever it leaves it: plain Newton runs
+  // off on eccentric ellipses started near apoapsis. An ellipse's span, taken into one
+  // period, brackets chi by one revolution; otherwise the bracket grows until it holds dt.
+  double low, high;
+  if (alpha > 1e-12) {
+    const double period = 2.0 * PI / (sqrt_mu * alpha * std::sqrt(alpha));
+    dt = std::fmod(dt, period);
+    if (dt < 0.0) dt += period;
+    low = 0.0;
+    high = 2.0 * PI / std::sqrt(alpha);
+  } else {
+    const double guess = std::max(sqrt_mu * std::abs(dt) / r0_norm, 1e-12);
+    low = dt < 0.0 ? -guess : 0.0;
+    high = dt < 0.0 ? 0.0 : guess;
+    for (int k = 0; k < 200 && (dt < 0.0 ? time_at(low) > dt : time_at(high) < dt); ++k) {
+      (dt < 0.0 ? low : high) *= 2.0;
+    }
+  }
+
+  double chi = alpha > 1e-12 ? std::clamp(sqrt_mu * dt * alpha, low, high) : 0.5 * (low + high);
+  for (int iteration = 0; iteration < 100; ++iteration) {
+    const double error = time_at(chi) - dt;
+    if (error > 0.0) high = chi; else low = chi;
+    double next = chi - error * sqrt_mu / r;
+    if (!(next > low && next < high)) next = 0.5 * (low + high);
+    const bool converged = std::abs(next - chi) < 1e-13 * std::max(1.0, std::abs(chi));
+    chi = next;
+    if (converged || low == high) break;
+  }
+  time_at(chi);
+
+  const double f = 1.0 - chi * chi / r0_norm * c2;
+  const double g = dt - chi * chi * chi / sqrt_mu * c3;
+  const double f_dot = sqrt_mu / (r * r0_norm) * chi * (psi * c3 - 1.0);
+  const double g_dot = 1.0 - chi * chi / r * c2;
+  return {f * r0 + g * v0, f_dot * r0 + g_dot * v0};
+}
+
+int solve_lambert(const glm::dvec3 &r1, const glm::dvec3 &r2, double tof, double mu, int max_revolutions,
+                  LambertSolution *solutions) {
+  const double c = glm::length(r2 - r1);
+  const double r1_norm = glm::length(r1), r2_norm = glm::length(r2);
+  const double s = 0.5 * (r1_norm + r2_norm + c);
+  if (tof <= 0.0 || c == 0.0 || r1_norm == 0.0 || r2_norm == 0.0) return 0;
+
+  const glm::dvec3 ir1 = r1 / r1_norm, ir2 = r2 / r2_norm;
+  glm::dvec3 ih = glm::cross(ir1, ir2);
+  const double ih_norm = glm::length(ih);
+  // collinear ends leave the plane open, the orbit normal is taken as +z
+  ih = ih_norm > 1e-12 ? ih / ih_norm : glm::dvec3(0.0, 0.0, 1.0);
+
+  double lambda = std::sqrt(std::max(0.0, 1.0 - c / s));
+  glm::dvec3 it1, it2;
+  if (ih.z < 0.0) { // prograde through more than half a turn
+    lambda = -lambda;
+    it1 = glm::cross(ir1, ih);
+    it2 = glm::cross(ir2, ih);
+  } else {
+    it1 = glm::cross(ih, ir1);
+    it2 = glm::cross(ih, ir2);
+  }
+  const double l2 = lambda * lambda, l3 = l2 * lambda;
+  const LambertCurve curve{lambda};
+  const double T = std::sqrt(2.0 * mu / (s * s * s)) * tof;
+
+  // the most revolutions that fit: T must reach the minimum of the N-revolution curve
+  int revolutions = static_cast<int>(T / PI);
+  const double T00 = std::acos(lambda) + lambda * std::sqrt(1.0 - l2);
+  if (revolutions > 0 && T < T00 + revolutions * PI) {
+    double x = 0.0, T_min = T00 + revolutions * PI;
+    for (int iteration = 0; iteration < 12; ++iteration) {
+      double dT, ddT, dddT;
+      curve.derivatives(x, T_min, dT, ddT, dddT);
+      if (dT == 0.0) break;
+      const double next = x - dT * ddT / (ddT * ddT - dT * dddT / 2.0);
+      const bool converged = std::abs(x - next) < 1e-13;
+      x = next;
+      T_min = curve.time(x, revolutions);
+      if (converged) break;
+    }
+    if (T_min > T) revolutions--;
+  }
+  revolutions = std::clamp(std::min(revolutions, max_revolutions), 0, LAMBERT_MAX_REVOLUTIONS);
+
+  // initial guesses from Izzo's paper, then Householder on every branch
+  double xs[LAMBERT_MAX_SOLUTIONS];
+  const double T1 = 2.0 / 3.0 * (1.0 - l3);
+  double x0;
+  if (T >= T00) {
+    x0 = -(T - T00) / (T - T00 + 4.0);
+  } else if (T <= T1) {
+    x0 = T1 * (T1 - T) / (2.0 / 5.0 * (1.0 - l2 * l3) * T) + 1.0;
+  } else {
+    x0 = std::pow(T / T00, std::log(2.0) / std::log(T1 / T00)) - 1.0;
+  }
+  xs[0] = curve.householder(T, x0, 0, 1e-5);
+  for (int n = 1; n <= revolutions; ++n) {
+    const double left = std::pow((n * PI + PI) / (8.0 * T), 2.0 / 3.0);
+    xs[2 * n - 1] = curve.householder(T, (left - 1.0) / (left + 1.0), n, 1e-8);
+    const double right = std::pow(8.0 * T / (n * PI), 2.0 / 3.0);
+    xs[2 * n] = curve.householder(T, (right - 1.0) / (right + 1.0), n, 1e-8);
+  }
+
+  // velocities from x: radial and tangential components at both ends
+  const double gamma = std::sqrt(mu * s / 2.0);
+  const double rho = (r1_norm - r2_norm) / c;
+  const double sigma = std::sqrt(std::max(0.0, 1.0 - rho * rho));
+  int count = 0;
+  for (int k = 0; k < 2 * revolutions + 1; ++k) {
+    const double x = xs[k];
+    const int n = (k + 1) / 2;
+    // branches that Householder did not settle, near the minimum of a multi-revolution curve
+    if ((n > 0 && std::abs(x) >= 1.0) || !(std::abs(curve.time(x, n) - T) <= 1e-6 * T)) continue;
+    const double y = std::sqrt(1.0 - l2 + l2 * x * x);
+    const double radial_1 = gamma * ((lambda * y - x) - rho * (lambda * y + x)) / r1_norm;
+    const double radial_2 = -gamma * ((lambda * y - x) + rho * (lambda * y + x)) / r2_norm;
+    const double tangential = gamma * sigma * (y + lambda * x);
+    LambertSolution solution = {radial_1 * ir1 + tangential / r1_norm * it1, radial_2 * ir2 + tangential / r2_norm * it2, n};
+    if (!std::isfinite(solution.departure_velocity.x + solution.arrival_velocity.x)) continue;
+    solutions[count++] = solution;
+  }
+  return count;
+}
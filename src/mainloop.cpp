@@ -6,6 +6,7 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <iostream>
@@ -46,12 +47,22 @@ void mainloop(GLFWwindow *window) {
   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
 
+  // gas surface density, refreshed from every snapshot that carries a disk
+  unsigned int gas_texture;
+  glGenTextures(1, &gas_texture);
+  glBindTexture(GL_TEXTURE_2D, gas_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SPH_MAP_ANGULAR, SPH_MAP_RADIAL, 0, GL_RED, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
   // initializations
   Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
   initialize_imgui(window);
-  Simulation simulation;
-  simulation.reset_to_solar_system();
-  AppState app{.simulation = simulation,
+  PhysicsThread physics;
+  AppState app{.physics = &physics,
+               .snapshot = &physics.latest(),
                .camera = &camera,
                .is_mouse_captured = true,
                .is_paused = false,
@@ -59,7 +70,8 @@ void mainloop(GLFWwindow *window) {
                .simulation_speed = 1.0f,
                .lastX = SCREEN_WIDTH / 2.0,
                .lastY = SCREEN_HEIGHT / 2.0,
-               .first_mouse = true};
+               .first_mouse = true,
+               .porkchop = {}};
   glfwSetWindowUserPointer(window, &app);
 
   // input callbacks
@@ -90,10 +102,10 @@ void mainloop(GLFWwindow *window) {
     if (action == GLFW_PRESS && app->is_mouse_captured) {
       switch (key) {
       case GLFW_KEY_R:
-        app->simulation.reset_to_solar_system();
+        app->physics->submit({.type = CommandType::RESET});
         break;
       case GLFW_KEY_B: {
-        if (app->simulation.bodies.size() >= MAX_BODIES) break;
+        if (app->snapshot->body_count >= MAX_BODIES) break;
         CelestialBody new_body;
         new_body.position = glm::dvec3(app->camera->m_position + app->camera->m_front * 1.0f);
         new_body.velocity = glm::dvec3(0.0);
@@ -101,16 +113,14 @@ void mainloop(GLFWwindow *window) {
         new_body.radius = app->gui_props.body_editor.radius;
         new_body.color = app->gui_props.body_editor.color;
         new_body.is_black_hole = app->gui_props.body_editor.is_black_hole;
-        app->simulation.add_body(new_body);
+        app->physics->submit({.type = CommandType::ADD_BODY, .body = new_body});
         break;
       }
       case GLFW_KEY_P:
         app->is_paused = !app->is_paused;
         break;
       case GLFW_KEY_C:
-        if (!app->simulation.get_bodies().empty()) {
-          app->simulation.get_bodies().pop_back();
-        }
+        app->physics->submit({.type = CommandType::REMOVE_LAST_BODY});
         break;
       }
     }
@@ -139,10 +149,7 @@ void mainloop(GLFWwindow *window) {
     ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
   });
 
-  // game-loop timing (=> decouples fps from physics updates)
-  const double dt = 1.0 / 100;
   double current_time = glfwGetTime();
-  double accumulator = 0.0;
 
   // frame limiting
   using Clock = std::chrono::high_resolution_clock;
@@ -158,7 +165,6 @@ void mainloop(GLFWwindow *window) {
     if (frame_time > 0.25) {
       frame_time = 0.25;
     }
-    accumulator += frame_time;
 
     AppState *app_ptr = static_cast<AppState *>(glfwGetWindowUserPointer(window));
 
@@ -168,14 +174,12 @@ void mainloop(GLFWwindow *window) {
       process_input(window, *app_ptr->camera, static_cast<float>(frame_time), &app);
     }
 
-    // physics update
-    while (accumulator >= dt) {
-      if (!app_ptr->is_paused) {
-        app_ptr->simulation.update(dt * app_ptr->simulation_speed);
-        app_ptr->simulation.remove_marked_bodies(); // erase mass=0 bodies 
-      }
-      accumulator -= dt;
-    }
+    // physics runs on its own thread, just hand over the controls and take its latest state
+    app_ptr->physics->set_paused(app_ptr->is_paused);
+    app_ptr->physics->set_speed(app_ptr->simulation_speed);
+    app_ptr->physics->set_time_warp(app_ptr->time_warp);
+    app_ptr->physics->set_frame_time(frame_time);
+    app_ptr->snapshot = &app_ptr->physics->latest();
 
     // rendering
     ImGui_ImplOpenGL3_NewFrame();
@@ -185,7 +189,9 @@ void mainloop(GLFWwindow *window) {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    const auto &bodies = app_ptr->simulation.get_bodies();
+    const auto &bodies = app_ptr->snapshot->bodies;
+    const auto &satellites = app_ptr->snapshot->satellites;
+    const size_t drawn = std::min<size_t>(bodies.size() + satellites.size(), MAX_BODIES);
     float aspect_ratio = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
 
     glUseProgram(shader_program);
@@ -194,18 +200,30 @@ void mainloop(GLFWwindow *window) {
     glUniform3fv(glGetUniformLocation(shader_program, "camera_up"), 1, glm::value_ptr(app_ptr->camera->m_up));
     glUniform3fv(glGetUniformLocation(shader_program, "camera_right"), 1, glm::value_ptr(app_ptr->camera->m_right));
     glUniform1f(glGetUniformLocation(shader_program, "aspect_ratio"), aspect_ratio);
-    glUniform1i(glGetUniformLocation(shader_program, "num_bodies"), bodies.size());
+    glUniform1i(glGetUniformLocation(shader_program, "num_bodies"), drawn);
     glUniform1i(glGetUniformLocation(shader_program, "lighting_enabled"), app_ptr->gui_props.lighting_enabled);
-    glUniform1f(glGetUniformLocation(shader_program, "G"), static_cast<float>(app.simulation.getG()));
+    glUniform1f(glGetUniformLocation(shader_program, "G"), static_cast<float>(app_ptr->snapshot->G));
+
+    const auto &gas_map = app_ptr->snapshot->gas_density_map;
+    const int gas_body = static_cast<size_t>(app_ptr->snapshot->gas_body) < drawn ? app_ptr->snapshot->gas_body : -1;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gas_texture);
+    if (gas_body >= 0 && gas_map.size() == SPH_MAP_RADIAL * SPH_MAP_ANGULAR) {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SPH_MAP_ANGULAR, SPH_MAP_RADIAL, GL_RED, GL_FLOAT, gas_map.data());
+    }
+    glUniform1i(glGetUniformLocation(shader_program, "gas_density"), 0);
+    glUniform1i(glGetUniformLocation(shader_program, "gas_body"), gas_body);
+    glUniform1f(glGetUniformLocation(shader_program, "gas_radius"), static_cast<float>(app_ptr->snapshot->gas_radius));
 
-    for (size_t i = 0; i < bodies.size() && i < MAX_BODIES; i++) {
+    for (size_t i = 0; i < drawn; i++) {
       std::string index = "bodies[" + std::to_string(i) + "]";
+      const CelestialBody &body = i < bodies.size() ? bodies[i] : satellites[i - bodies.size()];
 
-      CalestialBodyData body_data = {glm::vec3(bodies[i].position),
-                                     bodies[i].color,
-                                     static_cast<float>(bodies[i].radius),
-                                     static_cast<float>(bodies[i].mass), 
-                                     bodies[i].is_black_hole ? 1 : 0};
+      CalestialBodyData body_data = {glm::vec3(body.position),
+                                     body.color,
+                                     static_cast<float>(body.radius),
+                                     static_cast<float>(body.mass), 
+                                     body.is_black_hole ? 1 : 0};
 
       glUniform3fv(glGetUniformLocation(shader_program, (index + ".position").c_str()), 1, glm::value_ptr(body_data.position));
       glUniform1f(glGetUniformLocation(shader_program, (index + ".radius").c_str()), body_data.radius);
@@ -246,6 +264,8 @@ void mainloop(GLFWwindow *window) {
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
+  glDeleteTextures(1, &gas_texture);
+  if (app.porkchop_texture != 0) glDeleteTextures(1, &app.porkchop_texture);
   glDeleteVertexArrays(1, &quad_VAO);
   glDeleteBuffers(1, &quad_VBO);
   glDeleteProgram(shader_program);
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <array>
+#include "morton.hpp"
+#include "simulation.hpp"
+#include "scheduler.hpp"
+
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_CHUNK 16384 // entries per histogram/scatter task
+
+// spreads the low 21 bits of v so there are two zero bits between each
+static uint64_t spread_bits(uint64_t v) {
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z) {
+  return spread_bits(x) | spread_bits(y) << 1 | spread_bits(z) << 2;
+}
+
+void compute_morton_keys(const std::vector<CelestialBody> &bodies, MortonKeys &keys) {
+  const size_t n = bodies.size();
+  keys.entries.resize(n);
+  if (n == 0) return;
+
+  glm::dvec3 lo = bodies[0].position, hi = bodies[0].position;
+  for (const auto &body : bodies) {
+    lo = glm::min(lo, body.position);
+    hi = glm::max(hi, body.position);
+  }
+  const glm::dvec3 extent = hi - lo;
+  keys.origin = lo;
+  keys.size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-12));
+
+  const double cells = static_cast<double>(1u << MORTON_BITS);
+  const double scale = (cells - 1.0) / keys.size;
+
+  scheduler().parallel_for(0, n, RADIX_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const glm::dvec3 cell = (bodies[i].position - keys.origin) * scale;
+      keys.entries[i] = {morton_encode(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y),
+                                       static_cast<uint32_t>(cell.z)),
+                         static_cast<uint32_t>(i)};
+    }
+  });
+}
+
+void sort_morton_keys(MortonKeys &keys, std::vector<MortonEntry> &scratch) {
+  radix_sort_entries(keys.entries, scratch, 3 * MORTON_BITS);
+}
+
+// Parallel stable LSD radix sort. Every pass builds one histogram per fixed-size chunk in
+// parallel, prefix-sums them in chunk order and scatters each chunk to its own offsets, so
+// the result does not depend on the thread count. Passes over a digit that is identical
+// for all keys (the high bits of a compact scene) are skipped.
+void radix_sort_entries(std::vector<MortonEntry> &entries, std::vector<MortonEntry> &scratch, unsigned key_bits) {
+  const size_t n = entries.size();
+  if (n < 2) return;
+
+  const size_t chunks = (n + RADIX_CHUNK - 1) / RADIX_CHUNK;
+  std::vector<std::array<uint32_t, RADIX_BUCKETS>> histograms(chunks);
+  scratch.resize(n);
+
+  for (unsigned shift = 0; shift < key_bits; shift += RADIX_BITS) {
+    scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+      for (size_t c = first; c < last; ++c) {
+        auto &histogram = histograms[c];
+        histogram.fill(0);
+        const size_t end = std::min(n, (c + 1) * RADIX_CHUNK);
+        for (size_t i = c * RADIX_CHUNK; i < end; ++i) {
+          histogram[(entries[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+      }
+    });
+
+    size_t offset = 0;
+    bool single_bucket = false;
+    for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+      size_t bucket_total = 0;
+      for (size_t c = 0; c < chunks; ++c) {
+        const uint32_t count = histograms[c][bucket];
+        histograms[c][bucket] = static_cast<uint32_t>(offset);
+        offset += count;
+        bucket_total += count;
+      }
+      if (bucket_total == n) single_bucket = true;
+    }
+    if (single_bucket) continue;
+
+    scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+      for (size_t c = first; c < last; ++c) {
+        auto &positions = histograms[c];
+        const size_t end = std::min(n, (c + 1) * RADIX_CHUNK);
+        for (size_t i = c * RADIX_CHUNK; i < end; ++i) {
+          scratch[positions[(entries[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = entries[i];
+        }
+      }
+    });
+    entries.swap(scratch);
+  }
+}
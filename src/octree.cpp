@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <glm/gtx/norm.hpp>
+#include "octree.hpp"
+#include "scheduler.hpp"
+#include "simulation.hpp"
+#include "softening.hpp"
+
+#define OCTREE_STACK_SIZE 256 // 7 pending siblings per level over 21 levels fit comfortably
+
+const OctreeStats &Octree::get_stats() const { return stats; }
+
+void Octree::invalidate() { valid = false; }
+uint32_t Octree::get_leaf_size() const { return leaf_size; }
+
+void Octree::set_leaf_size(uint32_t size) {
+  leaf_size = std::max(1u, size);
+  valid = false;
+}
+
+void Octree::update(const std::vector<CelestialBody> &bodies, MortonKeys &keys, std::vector<MortonEntry> &scratch) {
+  using Clock = std::chrono::high_resolution_clock;
+
+  stats.rebuilt_last_step = !valid || body_count != bodies.size() || stats.quality > OCTREE_REBUILD_RATIO;
+  if (stats.rebuilt_last_step) {
+    auto start = Clock::now();
+    // keys a reorder just sorted are taken as they are; they lag the bodies by at most the
+    // drift since, which the refit below absorbs like any other motion
+    if (!keys.current || keys.entries.size() != bodies.size()) {
+      compute_morton_keys(bodies, keys);
+      sort_morton_keys(keys, scratch);
+    }
+    keys.current = false;
+    build(keys);
+    stats.build_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.rebuilds++;
+  } else {
+    stats.refits++;
+  }
+
+  auto start = Clock::now();
+  refit(bodies);
+  stats.refit_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// topology only, the bounds and moments are filled in by the refit that always follows
+void Octree::build(const MortonKeys &keys) {
+  const auto &entries = keys.entries;
+  body_count = entries.size();
+  indices.resize(body_count);
+  for (size_t k = 0; k < body_count; ++k) indices[k] = entries[k].index;
+
+  nodes.clear();
+  for (auto &level : levels) level.clear();
+  if (body_count > 0) {
+    nodes.resize(1);
+    build_node(0, entries, 0, body_count, 3 * MORTON_BITS - 3, 0);
+  }
+
+  valid = true;
+  built_size = 0.0;
+  stats.quality = 1.0;
+  stats.node_count = nodes.size();
+}
+
+// fills node id from [begin, end) of the sorted entries, splitting by the octant digit at
+// shift; children of a node are allocated next to each other so the walk addresses them by first/count
+void Octree::build_node(uint32_t id, const std::vector<MortonEntry> &entries, size_t begin, size_t end, int shift,
+                        uint32_t depth) {
+  auto digit = [&](size_t k) { return (entries[k].key >> shift) & 7; };
+
+  // levels where every body falls in the same octant add nothing, skip them
+  while (shift >= 0 && end - begin > leaf_size && digit(begin) == digit(end - 1)) shift -= 3;
+
+  if (levels.size() <= depth) levels.emplace_back();
+  levels[depth].push_back(id);
+
+  if (shift < 0 || end - begin <= leaf_size) {
+    nodes[id].leaf = true;
+    nodes[id].first = static_cast<uint32_t>(begin);
+    nodes[id].count = static_cast<uint32_t>(end - begin);
+    return;
+  }
+
+  size_t bounds[9];
+  size_t cursor = begin;
+  uint32_t children = 0;
+  for (uint64_t octant = 0; octant < 8; ++octant) {
+    bounds[octant] = cursor;
+    while (cursor < end && digit(cursor) == octant) ++cursor;
+    if (cursor > bounds[octant]) children++;
+  }
+  bounds[8] = end;
+
+  const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+  nodes.resize(nodes.size() + children);
+  nodes[id].leaf = false;
+  nodes[id].first = first_child;
+  nodes[id].count = children;
+
+  uint32_t child = first_child;
+  for (int octant = 0; octant < 8; ++octant) {
+    if (bounds[octant + 1] == bounds[octant]) continue;
+    build_node(child++, entries, bounds[octant], bounds[octant + 1], shift - 3, depth + 1);
+  }
+}
+
+void Octree::refit(const std::vector<CelestialBody> &bodies) {
+  for (size_t depth = levels.size(); depth-- > 0;) {
+    const auto &level = levels[depth];
+    scheduler().parallel_for(0, level.size(), 0, [&](size_t begin, size_t end) {
+      for (size_t k = begin; k < end; ++k) {
+        OctreeNode &node = nodes[level[k]];
+        glm::dvec3 lo(INFINITY), hi(-INFINITY), weighted(0.0);
+        double mass = 0.0;
+
+        if (node.leaf) {
+          for (uint32_t e = node.first; e < node.first + node.count; ++e) {
+            const CelestialBody &body = bodies[indices[e]];
+            lo = glm::min(lo, body.position);
+            hi = glm::max(hi, body.position);
+            weighted += body.mass * body.position;
+            mass += body.mass;
+          }
+        } else {
+          for (uint32_t c = node.first; c < node.first + node.count; ++c) {
+            const OctreeNode &child = nodes[c];
+            lo = glm::min(lo, child.lo);
+            hi = glm::max(hi, child.hi);
+            weighted += child.mass * child.center_of_mass;
+            mass += child.mass;
+          }
+        }
+
+        node.lo = lo;
+        node.hi = hi;
+        node.mass = mass;
+        node.center_of_mass = mass > 0.0 ? weighted / mass : 0.5 * (lo + hi);
+      }
+    });
+  }
+
+  double size = 0.0;
+  for (const auto &node : nodes) {
+    const glm::dvec3 extent = node.hi - node.lo;
+    size += std::max(std::max(extent.x, extent.y), extent.z);
+  }
+  if (built_size == 0.0) built_size = size;
+  stats.quality = built_size > 0.0 ? size / built_size : 1.0;
+}
+
+// each body walks the tree on its own and sums in a fixed order, so the result does not
+// depend on how the bodies are spread over threads
+glm::dvec3 Octree::acceleration(const std::vector<CelestialBody> &bodies, size_t i, double G,
+                                const std::vector<double> *softening) const {
+  glm::dvec3 acc(0.0);
+  if (nodes.empty()) return acc;
+
+  const glm::dvec3 p = bodies[i].position;
+  const double h = softening ? (*softening)[i] : 0.0;
+  uint32_t stack[OCTREE_STACK_SIZE];
+  size_t top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    const OctreeNode &node = nodes[stack[--top]];
+
+    if (node.leaf) {
+      for (uint32_t e = node.first; e < node.first + node.count; ++e) {
+        const uint32_t j = indices[e];
+        if (j == i) continue;
+        const glm::dvec3 r = bodies[j].position - p;
+        const double distance_sq = glm::length2(r);
+        if (softening) {
+          acc += r * (bodies[j].mass * softened_inverse_cube(distance_sq, std::max(h, (*softening)[j])));
+          continue;
+        }
+        if (distance_sq < 1e-12) continue;
+        acc += r * (bodies[j].mass / (distance_sq * std::sqrt(distance_sq)));
+      }
+      continue;
+    }
+
+    const glm::dvec3 r = node.center_of_mass - p;
+    const double distance_sq = glm::length2(r);
+    const glm::dvec3 extent = node.hi - node.lo;
+    const double size = std::max(std::max(extent.x, extent.y), extent.z);
+    const bool inside = glm::all(glm::greaterThanEqual(p, node.lo)) && glm::all(glm::lessThanEqual(p, node.hi));
+
+    if (!inside && size * size < OCTREE_THETA * OCTREE_THETA * distance_sq) {
+      const double inv_cube = softening ? softened_inverse_cube(distance_sq, h) : 1.0 / (distance_sq * std::sqrt(distance_sq));
+      acc += r * (node.mass * inv_cube);
+    } else {
+      for (uint32_t c = node.first + node.count; c-- > node.first;) stack[top++] = c;
+    }
+  }
+
+  return G * acc;
+}
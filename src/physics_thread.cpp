@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "physics_thread.hpp"
+
+PhysicsThread::PhysicsThread() {
+  simulation.reset_to_solar_system();
+  publish();
+  thread = std::thread(&PhysicsThread::run, this);
+}
+
+PhysicsThread::~PhysicsThread() {
+  running = false;
+  thread.join();
+}
+
+const SimulationSnapshot &PhysicsThread::latest() { return snapshots.latest(); }
+void PhysicsThread::set_paused(bool value)        { paused = value; }
+void PhysicsThread::set_speed(float value)        { speed = value; }
+void PhysicsThread::set_time_warp(bool value)     { time_warp = value; }
+void PhysicsThread::set_frame_time(double value)  { frame_time = value; }
+
+// any thread may submit, commands are applied between ticks, never while a step is running
+void PhysicsThread::submit(const SimulationCommand &command) { commands.push(command); }
+
+void PhysicsThread::apply_commands() {
+  SimulationCommand command;
+  while (commands.try_pop(command)) {
+    apply(command);
+  }
+}
+
+void PhysicsThread::apply(const SimulationCommand &command) {
+  CelestialBody *body = simulation.get_body(command.handle);
+
+  switch (command.type) {
+  case CommandType::RESET:
+    simulation.reset_to_solar_system();
+    break;
+  case CommandType::LOAD_SCENE:
+    simulation.reset_to_scene({.preset = static_cast<ScenePreset>(command.option),
+                               .bodies = static_cast<size_t>(command.scalar),
+                               .seed = static_cast<uint64_t>(command.vector.x)});
+    break;
+  case CommandType::SET_G:
+    simulation.setG(command.scalar);
+    break;
+  case CommandType::ADD_BODY:
+    simulation.add_body(command.body);
+    break;
+  case CommandType::REMOVE_LAST_BODY:
+    simulation.remove_newest_body();
+    break;
+  case CommandType::REMOVE_BODY:
+    simulation.remove_body(command.handle);
+    break;
+  case CommandType::SET_MASS:
+    if (body) body->mass = command.scalar;
+    break;
+  case CommandType::SET_RADIUS:
+    if (body) body->radius = command.scalar;
+    break;
+  case CommandType::SET_DENSITY:
+    if (body && command.scalar > 0.0) body->density = command.scalar;
+    break;
+  case CommandType::SET_POSITION:
+    if (body) {
+      body->position = command.vector;
+      body->position_compensation = glm::dvec3(0.0);
+    }
+    break;
+  case CommandType::SET_VELOCITY:
+    if (body) {
+      body->velocity = command.vector;
+      body->velocity_compensation = glm::dvec3(0.0);
+    }
+    break;
+  case CommandType::SET_COLOR:
+    if (body) body->color = glm::vec3(command.vector);
+    break;
+  case CommandType::SET_BLACK_HOLE:
+    if (body) body->is_black_hole = command.option != 0;
+    break;
+  case CommandType::SET_DETERMINISTIC:
+    simulation.set_deterministic(command.option != 0);
+    break;
+  case CommandType::SET_PRECISION:
+    simulation.set_precision_mode(static_cast<PrecisionMode>(command.option));
+    break;
+  case CommandType::SET_FORCE_SOLVER:
+    simulation.set_force_solver(static_cast<ForceSolver>(command.option));
+    break;
+  case CommandType::SET_REORDER_INTERVAL:
+    simulation.set_reorder_interval(command.option);
+    break;
+  case CommandType::SET_AUTO_TUNE:
+    // the tuner would switch kernels under the chaos indicators, and has nothing to compare while
+    // any other mode overrides the kernel; those only pause a tuner that is already on
+    auto_tune = command.option != 0 && Autotuner::tunable(simulation);
+    autotuner.reset();
+    break;
+  case CommandType::SET_TUNING_ACCURACY:
+    autotuner.set_accuracy(command.scalar);
+    break;
+  case CommandType::SET_VARIATIONAL:
+    if (!auto_tune) simulation.set_variational(command.option != 0);
+    break;
+  case CommandType::SET_PERIODIC: {
+    PeriodicConfig config = simulation.get_periodic();
+    config.enabled = command.option != 0;
+    if (command.scalar > 0.0) config.box_size = command.scalar;
+    simulation.set_periodic(config);
+    break;
+  }
+  case CommandType::SET_DISRUPTION: {
+    DisruptionConfig config = simulation.get_disruption();
+    config.enabled = command.option != 0;
+    if (command.scalar > 0.0) config.fragments = static_cast<unsigned>(command.scalar);
+    config.test_particles = command.vector.x != 0.0;
+    simulation.set_disruption(config);
+    break;
+  }
+  case CommandType::LAUNCH_PROBES:
+    simulation.launch_probes(command.handle, static_cast<unsigned>(std::max(command.option, 0)), command.scalar);
+    break;
+  case CommandType::CLEAR_PROBES:
+    simulation.clear_probes();
+    break;
+  case CommandType::SET_SOFTENING: {
+    SofteningConfig config = simulation.get_softening();
+    config.adaptive = command.option != 0;
+    simulation.set_softening(config);
+    break;
+  }
+  case CommandType::SET_EXTERNAL_FORCE:
+    if (command.option >= 0 && static_cast<size_t>(command.option) < ExternalForces::size()) {
+      simulation.get_external_forces().set_enabled(command.option, command.scalar != 0.0);
+    }
+    break;
+  case CommandType::ADD_MOON:
+    simulation.add_moon(command.handle, command.scalar, command.vector.x);
+    break;
+  case CommandType::ADD_RING: {
+    RingConfig config;
+    config.particles = static_cast<size_t>(std::max(command.option, 0));
+    config.geometry = command.scalar != 0.0 ? RingGeometry::SHEARING_SHEET : RingGeometry::GLOBAL;
+    simulation.add_ring(command.handle, config);
+    break;
+  }
+  case CommandType::ADD_GAS_DISK: {
+    GasConfig config;
+    config.particles = static_cast<size_t>(std::max(command.option, 0));
+    simulation.add_gas_disk(command.handle, config);
+    break;
+  }
+  case CommandType::REMOVE_GAS_DISK:
+    simulation.remove_gas_disk();
+    break;
+  case CommandType::MEASURE_FORCE_ERROR:
+    force_error_report = simulation.measure_mixed_precision_error();
+    has_force_error_report = true;
+    break;
+  case CommandType::RUN_ENSEMBLE:
+    run_ensemble(static_cast<size_t>(std::max(command.option, 1)), command.scalar, command.vector.x, command.vector.y);
+    break;
+  case CommandType::CANCEL_ENSEMBLE:
+    if (ensemble_job) ensemble_job->cancel = true;
+    break;
+  case CommandType::COMPUTE_PORKCHOP: {
+    // a failed grid has no cells, the GUI tells the two apart
+    auto grid = std::make_shared<PorkchopGrid>();
+    std::vector<BodyHandle> handles(simulation.bodies.size());
+    for (size_t i = 0; i < handles.size(); ++i) handles[i] = simulation.handle_of(i);
+    if (!compute_porkchop(simulation.bodies, handles, simulation.getG(), command.porkchop, *grid)) {
+      grid->config = command.porkchop;
+    }
+    porkchop = std::move(grid);
+    break;
+  }
+  }
+}
+
+// true while steps remain and the run has not been cancelled
+static bool advance_ensemble_slice(EnsembleJob &job) {
+  const int done = job.steps_done.load(std::memory_order_relaxed);
+  if (job.cancel || done >= job.steps) return false;
+  const int slice = std::min(job.slice_steps, job.steps - done);
+  job.ensemble.advance(job.span / job.steps, slice);
+  job.steps_done.store(done + slice, std::memory_order_release);
+  return done + slice < job.steps && !job.cancel;
+}
+
+// without workers nobody would pick the task up, the physics thread steps a slice per tick instead
+static void launch_ensemble_slice(EnsembleJob &job) {
+  if (scheduler().concurrency() == 1) return;
+  scheduler().submit(job.group, [&job] {
+    if (advance_ensemble_slice(job)) launch_ensemble_slice(job);
+  });
+}
+
+// Perturbed copies of the current bodies stepped in lockstep in the background; the live
+// simulation keeps ticking and the report is published when the last slice is done. One run
+// at a time, and none whose cost exceeds ENSEMBLE_MAX_INTERACTIONS.
+void PhysicsThread::run_ensemble(size_t members, double sigma, double span, double step) {
+  if (ensemble_job) return;
+  if (simulation.bodies.empty() || simulation.bodies.size() > ENSEMBLE_MAX_BODIES || !(span > 0.0) || !(step > 0.0)) return;
+  const int steps = static_cast<int>(std::ceil(span / step));
+  const double interactions = Ensemble::interactions(members, simulation.bodies.size(), steps);
+  if (interactions > ENSEMBLE_MAX_INTERACTIONS) return;
+
+  ensemble_job = std::make_unique<EnsembleJob>(
+      Ensemble(Ensemble::perturbed_copies(simulation.bodies, simulation.getG(), members, sigma,
+                                          simulation.get_step_count())),
+      span, steps);
+  const double per_step = std::max(1.0, interactions / steps);
+  ensemble_job->slice_steps = static_cast<int>(std::clamp(ENSEMBLE_SLICE_INTERACTIONS / per_step, 1.0, static_cast<double>(steps)));
+  launch_ensemble_slice(*ensemble_job);
+}
+
+// called once per tick: finishes a drained job, publishing its report unless it was cancelled
+void PhysicsThread::poll_ensemble() {
+  if (!ensemble_job) return;
+  EnsembleJob &job = *ensemble_job;
+  if (scheduler().concurrency() == 1) advance_ensemble_slice(job);
+  if (job.group.pending.load(std::memory_order_acquire) > 0) return;
+  if (!job.cancel && job.steps_done.load(std::memory_order_acquire) < job.steps) return;
+
+  if (!job.cancel) {
+    ensemble_report = job.ensemble.report();
+    ensemble_report.span = job.span;
+    ensemble_report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+    has_ensemble_report = true;
+  }
+  ensemble_job.reset();
+}
+
+void PhysicsThread::publish() {
+  SimulationSnapshot &snapshot = snapshots.back();
+  const size_t published = std::min<size_t>(simulation.bodies.size(), SNAPSHOT_BODIES);
+  snapshot.body_count = simulation.bodies.size();
+  snapshot.bodies.assign(simulation.bodies.begin(), simulation.bodies.begin() + published);
+  snapshot.handles.resize(published);
+  for (size_t i = 0; i < published; ++i) {
+    snapshot.handles[i] = simulation.handle_of(i);
+  }
+  snapshot.satellites.clear();
+  snapshot.rings.clear();
+  for (const auto &subsystem : simulation.get_subsystems()) {
+    if (subsystem.rings) snapshot.rings.push_back(subsystem.rings->get_stats());
+    const CelestialBody &host = simulation.bodies[simulation.index_of(subsystem.host)];
+    for (size_t k = 1; k < subsystem.members.size() && snapshot.satellites.size() < SNAPSHOT_BODIES; ++k) {
+      CelestialBody satellite = subsystem.members[k];
+      satellite.position += host.position;
+      satellite.velocity += host.velocity;
+      snapshot.satellites.push_back(satellite);
+    }
+  }
+  const GasDisk *gas = simulation.get_gas_disk();
+  const size_t gas_host = simulation.index_of(simulation.get_gas_host());
+  snapshot.has_gas = gas != nullptr;
+  snapshot.gas_body = gas && gas_host < published ? static_cast<int>(gas_host) : -1;
+  if (gas) {
+    snapshot.gas = gas->get_stats();
+    snapshot.gas_radius = gas->get_outer_radius();
+    if (snapshot.gas_body >= 0) gas->surface_density(simulation.bodies[gas_host].position, snapshot.gas_density_map);
+  }
+  snapshot.G = simulation.getG();
+  snapshot.time = simulation.get_time();
+  snapshot.step_count = simulation.get_step_count();
+  snapshot.state_hash = simulation.get_state_hash();
+  snapshot.deterministic = simulation.is_deterministic();
+  snapshot.precision = simulation.get_precision_mode();
+  snapshot.force_solver = simulation.get_force_solver();
+  snapshot.force_kernel = simulation.get_force_kernel();
+  snapshot.direct_supported = simulation.supports_direct();
+  snapshot.thread_count = simulation.get_thread_count();
+  snapshot.reorder_interval = simulation.get_reorder_interval();
+  snapshot.tree_stats = simulation.get_tree_stats();
+  snapshot.periodic = simulation.get_periodic();
+  snapshot.disruption = simulation.get_disruption();
+  snapshot.disruption_stats = simulation.get_disruption_stats();
+  snapshot.test_particles = simulation.get_test_particles().size();
+  snapshot.probes = simulation.get_probes().size();
+  snapshot.probe_stats = simulation.get_probe_stats();
+  snapshot.adaptive_softening = simulation.get_softening().adaptive;
+  snapshot.softening = simulation.get_softening_stats();
+  snapshot.variational = simulation.is_variational();
+  snapshot.variational_supported = simulation.supports_variational() && !auto_tune;
+  snapshot.chaos = simulation.get_chaos_indicators();
+  for (size_t k = 0; k < ExternalForces::size(); ++k) {
+    snapshot.external_forces[k] = simulation.get_external_forces().is_enabled(k);
+  }
+  snapshot.auto_tune = auto_tune;
+  snapshot.tuning_supported = Autotuner::tunable(simulation);
+  snapshot.tuning_accuracy = autotuner.get_accuracy();
+  snapshot.has_tuning_result = autotuner.has_result();
+  snapshot.tuning_result = autotuner.last_result();
+  snapshot.steps_per_second = steps_per_second;
+  snapshot.time_warp = time_warp;
+  snapshot.achieved_warp = achieved_warp;
+  snapshot.physics_budget = budget;
+  snapshot.has_force_error_report = has_force_error_report;
+  snapshot.force_error_report = force_error_report;
+  snapshot.has_ensemble_report = has_ensemble_report;
+  snapshot.ensemble_report = ensemble_report;
+  snapshot.ensemble_running = ensemble_job != nullptr;
+  snapshot.ensemble_progress =
+      ensemble_job ? static_cast<double>(ensemble_job->steps_done.load(std::memory_order_acquire)) / ensemble_job->steps
+                   : 0.0;
+  snapshot.porkchop = porkchop;
+  snapshots.publish();
+}
+
+// multiplicative decrease while frames are late, slow increase otherwise; at PHYSICS_DT the
+// physics thread never sleeps
+void PhysicsThread::adapt_budget() {
+  const double frame = frame_time.load(std::memory_order_relaxed);
+  if (frame > 1.05 / WARP_TARGET_FPS) {
+    budget *= 0.9;
+  } else {
+    budget *= 1.02;
+  }
+  budget = std::clamp(budget, WARP_MIN_BUDGET, PHYSICS_DT);
+}
+
+// fixed PHYSICS_DT steps in batches sized from the measured step cost so the last batch
+// ends close to the deadline; whatever does not fit is dropped and shows as a lower warp
+int PhysicsThread::step_time_warp(double &accumulator, std::chrono::steady_clock::time_point tick_start) {
+  using Clock = std::chrono::steady_clock;
+  const auto deadline = tick_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget));
+  int steps = 0;
+
+  for (auto now = Clock::now(); accumulator >= PHYSICS_DT && now < deadline; now = Clock::now()) {
+    const double remaining = std::chrono::duration<double>(deadline - now).count();
+    const double owed = std::floor(accumulator / PHYSICS_DT);
+    const int batch = static_cast<int>(std::clamp(step_seconds > 0.0 ? remaining / step_seconds : 1.0, 1.0, owed));
+
+    simulation.advance(PHYSICS_DT, batch);
+    const double cost = std::chrono::duration<double>(Clock::now() - now).count() / batch;
+    step_seconds = step_seconds > 0.0 ? 0.8 * step_seconds + 0.2 * cost : cost;
+
+    accumulator -= batch * PHYSICS_DT;
+    steps += batch;
+  }
+
+  accumulator = std::min(accumulator, PHYSICS_DT); // no debt carried past the budget
+  return steps;
+}
+
+void PhysicsThread::run() {
+  using Clock = std::chrono::steady_clock;
+  auto previous = Clock::now();
+  auto rate_window_start = previous;
+  uint64_t rate_window_steps = 0;
+  double rate_window_time = simulation.get_time();
+  double accumulator = 0.0;
+
+  while (running) {
+    apply_commands();
+    poll_ensemble();
+    if (auto_tune) autotuner.maybe_tune(simulation);
+
+    const auto tick_start = Clock::now();
+    const double elapsed = std::min(std::chrono::duration<double>(tick_start - previous).count(), PHYSICS_MAX_CATCHUP);
+    previous = tick_start;
+
+    if (time_warp) {
+      adapt_budget();
+      if (!paused) {
+        accumulator += elapsed * speed;
+        rate_window_steps += step_time_warp(accumulator, tick_start);
+      } else {
+        accumulator = 0.0;
+      }
+    } else {
+      accumulator += elapsed;
+      int steps = 0;
+      while (accumulator >= PHYSICS_DT) {
+        ++steps;
+        accumulator -= PHYSICS_DT;
+      }
+      if (!paused && steps > 0) {
+        simulation.advance(PHYSICS_DT * speed, steps);
+        rate_window_steps += steps;
+      }
+    }
+
+    const auto now = Clock::now();
+    const double window = std::chrono::duration<double>(now - rate_window_start).count();
+    if (window >= 1.0) {
+      steps_per_second = rate_window_steps / window;
+      achieved_warp = std::max(0.0, simulation.get_time() - rate_window_time) / window; // 0 across a reset
+      rate_window_steps = 0;
+      rate_window_start = now;
+      rate_window_time = simulation.get_time();
+    }
+
+    publish();
+
+    // sleep until the next step is due
+    const double busy = std::chrono::duration<double>(now - tick_start).count();
+    const double idle = time_warp ? PHYSICS_DT - busy : PHYSICS_DT - accumulator - busy;
+    if (idle > 0.0) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(idle));
+    }
+  }
+
+  // a slice in flight still references the job, the next one sees the flag and stops
+  if (ensemble_job) {
+    ensemble_job->cancel = true;
+    scheduler().wait(ensemble_job->group);
+  }
+}
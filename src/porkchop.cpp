@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "porkchop.hpp"
+#include "scheduler.hpp"
+
+namespace {
+
+// states at start + k step for k in [0, count), relative to the central body
+std::vector<KeplerState> sample_ephemeris(const CelestialBody &body, const CelestialBody &central, double G, double start,
+                                          double step, int count) {
+  const KeplerState relative = {body.position - central.position, body.velocity - central.velocity};
+  const double mu = G * (central.mass + body.mass);
+  std::vector<KeplerState> states(count);
+  for (int k = 0; k < count; ++k) states[k] = propagate_kepler(relative, mu, start + step * k);
+  return states;
+}
+
+double grid_step(double span, int lines) { return lines > 1 ? span / (lines - 1) : 0.0; }
+
+} // namespace
+
+bool compute_porkchop(const std::vector<CelestialBody> &bodies, const std::vector<BodyHandle> &handles, double G,
+                      const PorkchopConfig &config, PorkchopGrid &grid) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  if (bodies.empty() || handles.size() != bodies.size()) return false;
+
+  const auto resolve = [&](BodyHandle handle) {
+    return static_cast<size_t>(std::find(handles.begin(), handles.end(), handle) - handles.begin());
+  };
+  size_t center = resolve(config.central);
+  if (center == handles.size()) {
+    center = std::max_element(bodies.begin(), bodies.end(), [](const CelestialBody &a, const CelestialBody &b) {
+               return a.mass < b.mass;
+             }) - bodies.begin();
+  }
+  const size_t departure = resolve(config.departure), arrival = resolve(config.arrival);
+  if (departure == handles.size() || arrival == handles.size() || departure == center || arrival == center ||
+      departure == arrival) {
+    return false;
+  }
+
+  PorkchopConfig resolved = config;
+  resolved.central = handles[center];
+  resolved.departures = std::clamp(config.departures, 1, PORKCHOP_MAX_CELLS);
+  resolved.arrivals = std::clamp(config.arrivals, 1, PORKCHOP_MAX_CELLS);
+  resolved.max_revolutions = std::clamp(config.max_revolutions, 0, LAMBERT_MAX_REVOLUTIONS);
+
+  const CelestialBody &central = bodies[center];
+  const int columns = resolved.departures, rows = resolved.arrivals;
+  const double departure_step = grid_step(resolved.departure_span, columns);
+  const double arrival_step = grid_step(resolved.arrival_span, rows);
+  const std::vector<KeplerState> departures =
+      sample_ephemeris(bodies[departure], central, G, resolved.departure_start, departure_step, columns);
+  const std::vector<KeplerState> arrivals =
+      sample_ephemeris(bodies[arrival], central, G, resolved.arrival_start, arrival_step, rows);
+
+  // the transfer orbits a massless craft, so only the centre's mass enters
+  const double mu = G * central.mass;
+  std::vector<float> cells(static_cast<size_t>(rows) * columns);
+  std::vector<int> revolutions(cells.size(), 0);
+  scheduler().parallel_for(0, rows, 1, [&](size_t begin, size_t end) {
+    LambertSolution solutions[LAMBERT_MAX_SOLUTIONS];
+    for (size_t row = begin; row < end; ++row) {
+      const double arrival_time = resolved.arrival_start + arrival_step * row;
+      for (int column = 0; column < columns; ++column) {
+        const size_t cell = row * columns + column;
+        const double flight = arrival_time - (resolved.departure_start + departure_step * column);
+        const int count = solve_lambert(departures[column].position, arrivals[row].position, flight, mu,
+                                        resolved.max_revolutions, solutions);
+        double best = NAN;
+        for (int k = 0; k < count; ++k) {
+          const double delta_v = glm::length(solutions[k].departure_velocity - departures[column].velocity) +
+                                 glm::length(solutions[k].arrival_velocity - arrivals[row].velocity);
+          if (!(delta_v >= best)) {
+            best = delta_v;
+            revolutions[cell] = solutions[k].revolutions;
+          }
+        }
+        cells[cell] = static_cast<float>(best);
+      }
+    }
+  });
+
+  grid.config = resolved;
+  grid.delta_v.swap(cells);
+  grid.min_delta_v = NAN;
+  grid.best_departure = grid.best_arrival = -1;
+  for (size_t cell = 0; cell < grid.delta_v.size(); ++cell) {
+    const float value = grid.delta_v[cell];
+    if (std::isnan(value) || value >= grid.min_delta_v) continue;
+    grid.min_delta_v = value;
+    grid.best_departure = static_cast<int>(cell % columns);
+    grid.best_arrival = static_cast<int>(cell / columns);
+    grid.best_revolutions = revolutions[cell];
+  }
+  grid.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return true;
+}
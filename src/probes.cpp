@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/gtx/norm.hpp>
+#include "probes.hpp"
+
+namespace {
+
+constexpr size_t NONE = SIZE_MAX;
+
+// fastest the orbit gets, at periapsis; vis-viva with r_p from the angular momentum and energy
+double peak_speed(const KeplerState &state, double mu) {
+  const double r = glm::length(state.position);
+  const double v2 = glm::length2(state.velocity);
+  const double h2 = glm::length2(glm::cross(state.position, state.velocity));
+  const double energy = 0.5 * v2 - mu / r;
+  const double e = std::sqrt(std::max(0.0, 1.0 + 2.0 * energy * h2 / (mu * mu)));
+  const double periapsis = std::max(h2 / mu / (1.0 + e), 1e-12 * r);
+  return std::sqrt(std::max(v2, v2 + 2.0 * mu * (1.0 / periapsis - 1.0 / r)));
+}
+
+// the node relative to its parent at time t of the span
+KeplerState node_state(const SoiNode &node, double t, double span) {
+  if (t >= span) return node.relative;
+  if (t <= 0.0) return node.start;
+  return propagate_kepler(node.relative, node.pair_mu, t - span);
+}
+
+// Earliest t in (a, b] with margin(t) < 0, given margin(a) >= 0. margin changes no faster
+// than speed, so an interval whose ends sum to more than speed times its length cannot dip
+// below zero; others are halved, left first, and the first bracket is bisected.
+template <typename Margin>
+double search(const Margin &margin, double speed, double a, double margin_a, double b, double margin_b, int depth,
+              double tolerance) {
+  if (margin_a + margin_b >= speed * (b - a)) return NAN;
+  if (depth > 0) {
+    const double middle = 0.5 * (a + b), margin_middle = margin(middle);
+    const double left = search(margin, speed, a, margin_a, middle, margin_middle, depth - 1, tolerance);
+    if (!std::isnan(left)) return left;
+    return search(margin, speed, middle, margin_middle, b, margin_b, depth - 1, tolerance);
+  }
+  if (margin_b >= 0.0) return NAN;
+  for (int iteration = 0; iteration < PROBE_BISECTIONS && b - a > tolerance; ++iteration) {
+    const double middle = 0.5 * (a + b);
+    (margin(middle) < 0.0 ? b : a) = middle;
+  }
+  return b; // on the far side, so the new sphere holds the probe
+}
+
+template <typename Margin>
+double first_event(const Margin &margin, double speed, double length, double margin_end, double tolerance) {
+  const double margin_start = margin(0.0);
+  if (margin_start < 0.0) return 0.0;
+  return search(margin, speed, 0.0, margin_start, length, margin_end, PROBE_SOI_DEPTH, tolerance);
+}
+
+} // namespace
+
+void build_soi_tree(const std::vector<CelestialBody> &bodies, const std::vector<size_t> &primaries, double G, double span,
+                    std::vector<SoiNode> &tree) {
+  tree.clear();
+  for (size_t index : primaries) {
+    const CelestialBody &body = bodies[index];
+    SoiNode node = {index, NONE, INFINITY, G * body.mass, 0.0, {}, {}, 0.0};
+    if (!tree.empty()) {
+      node.parent = soi_containing(tree, bodies, body.position);
+      const CelestialBody &parent = bodies[tree[node.parent].index];
+      node.relative = {body.position - parent.position, body.velocity - parent.velocity};
+      node.pair_mu = G * (body.mass + parent.mass);
+      node.radius = glm::length(node.relative.position) * std::pow(body.mass / parent.mass, 0.4);
+      node.start = propagate_kepler(node.relative, node.pair_mu, -span);
+      node.max_speed = peak_speed(node.relative, node.pair_mu);
+    }
+    tree.push_back(node);
+  }
+}
+
+size_t soi_containing(const std::vector<SoiNode> &tree, const std::vector<CelestialBody> &bodies, const glm::dvec3 &position) {
+  size_t node = 0;
+  for (size_t child = 1; child < tree.size(); ++child) {
+    if (tree[child].parent != node) continue;
+    if (glm::length2(position - bodies[tree[child].index].position) < tree[child].radius * tree[child].radius) {
+      node = child; // children follow their parent, so the scan continues below it
+    }
+  }
+  return node;
+}
+
+int propagate_patched_conic(const std::vector<SoiNode> &tree, size_t &node, KeplerState &relative, double span) {
+  const double tolerance = PROBE_TIME_TOLERANCE * span;
+  int transitions = 0;
+  double now = 0.0;
+  while (true) {
+    const SoiNode &primary = tree[node];
+    const double length = span - now;
+    const KeplerState start = relative;
+    const KeplerState end = propagate_kepler(start, primary.mu, length);
+    if (transitions == PROBE_MAX_TRANSITIONS) {
+      relative = end;
+      return transitions;
+    }
+    const auto probe_at = [&](double t) {
+      return t <= 0.0 ? start.position : t >= length ? end.position : propagate_kepler(start, primary.mu, t).position;
+    };
+    const double speed = peak_speed(start, primary.mu);
+
+    // leaving the primary's sphere, then entering a child's before that
+    double event = NAN;
+    size_t target = NONE;
+    if (primary.parent != NONE) {
+      const double limit = primary.radius * (1.0 + PROBE_SOI_HYSTERESIS);
+      const auto margin = [&](double t) { return limit - glm::length(probe_at(t)); };
+      event = first_event(margin, speed, length, limit - glm::length(end.position), tolerance);
+      if (!std::isnan(event)) target = primary.parent;
+    }
+    for (size_t child = node + 1; child < tree.size(); ++child) {
+      if (tree[child].parent != node) continue;
+      const SoiNode &moon = tree[child];
+      const double horizon = std::isnan(event) ? length : event;
+      const auto margin = [&](double t) {
+        return glm::length(probe_at(t) - node_state(moon, now + t, span).position) - moon.radius;
+      };
+      const double found = first_event(margin, speed + moon.max_speed, horizon, margin(horizon), tolerance);
+      if (!std::isnan(found)) {
+        event = found;
+        target = child;
+      }
+    }
+    if (std::isnan(event)) {
+      relative = end;
+      return transitions;
+    }
+
+    // into the new primary's frame at the crossing
+    KeplerState state = propagate_kepler(start, primary.mu, event);
+    if (target == primary.parent) {
+      const KeplerState own = node_state(primary, now + event, span);
+      state.position += own.position;
+      state.velocity += own.velocity;
+    } else {
+      const KeplerState own = node_state(tree[target], now + event, span);
+      state.position -= own.position;
+      state.velocity -= own.velocity;
+    }
+    relative = state;
+    node = target;
+    now += event;
+    ++transitions;
+  }
+}
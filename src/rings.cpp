@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <glm/gtx/norm.hpp>
+#include "rings.hpp"
+#include "scheduler.hpp"
+
+RingSystem::RingSystem(const RingConfig &config, double planet_mass, double G)
+    : config(config), particles(config.particles), planet_mu(G * planet_mass) {
+  const size_t n = particles.size();
+  const double inner = config.inner_radius;
+  const double outer = std::max(config.outer_radius, config.inner_radius);
+  const double optical_depth = std::max(config.optical_depth, 1e-3);
+  constexpr double pi = std::numbers::pi;
+
+  std::mt19937_64 rng(config.seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  if (config.geometry == RingGeometry::SHEARING_SHEET) {
+    const double orbit = 0.5 * (inner + outer);
+    radius = config.particle_radius > 0.0 ? config.particle_radius : RING_SHEET_PARTICLE_RADIUS;
+    omega = std::sqrt(planet_mu / (orbit * orbit * orbit));
+    const double side = std::sqrt(static_cast<double>(n) * pi * radius * radius / optical_depth);
+    box = glm::dvec3(side, side, 0.0);
+
+    // a few particle radii of random motion per orbit, the collisions settle it
+    const double sigma = 2.0 * radius * omega;
+    for (auto &particle : particles) {
+      particle.position = glm::dvec3((uniform(rng) - 0.5) * side, (uniform(rng) - 0.5) * side, 2.0 * radius * normal(rng));
+      particle.velocity = glm::dvec3(0.0, -1.5 * omega * particle.position.x, 0.0) +
+                          sigma * glm::dvec3(normal(rng), normal(rng), normal(rng));
+      particle.acceleration = glm::dvec3(0.0);
+    }
+
+    cell_size = glm::dvec3(2.0 * radius);
+    wrap_cells = std::max(3, static_cast<int>(side / cell_size.y));
+    cell_size.y = side / wrap_cells;
+  } else {
+    const double area = pi * (outer * outer - inner * inner);
+    radius = config.particle_radius > 0.0 ? config.particle_radius
+                                          : std::sqrt(optical_depth * area / (std::max<size_t>(n, 1) * pi));
+    omega = std::sqrt(planet_mu / (inner * inner * inner));
+
+    for (auto &particle : particles) {
+      const double rho = std::sqrt(inner * inner + uniform(rng) * (outer * outer - inner * inner));
+      const double phi = 2.0 * pi * uniform(rng);
+      const double speed = std::sqrt(planet_mu / rho);
+      const double sigma = 2.0 * radius * speed / rho;
+      particle.position = glm::dvec3(rho * std::cos(phi), rho * std::sin(phi), 2.0 * radius * normal(rng));
+      particle.velocity = speed * glm::dvec3(-std::sin(phi), std::cos(phi), 0.0) +
+                          sigma * glm::dvec3(normal(rng), normal(rng), normal(rng));
+      particle.acceleration = glm::dvec3(0.0);
+    }
+
+    cell_size = glm::dvec3(2.0 * radius);
+  }
+
+  bucket_mask = std::bit_ceil(std::max<size_t>(2 * n, 1024)) - 1;
+  stats.geometry = config.geometry;
+  stats.particles = n;
+  stats.particle_radius = radius;
+}
+
+double RingSystem::get_step() const                              { return 2.0 * std::numbers::pi / omega / RING_STEPS_PER_ORBIT; }
+const std::vector<RingParticle> &RingSystem::get_particles() const { return particles; }
+const RingStats &RingSystem::get_stats() const                   { return stats; }
+
+void RingSystem::accelerate(const std::vector<CelestialBody> &members, const glm::dmat3 &tidal, double G) {
+  if (config.geometry == RingGeometry::SHEARING_SHEET) return;
+
+  scheduler().parallel_for(0, particles.size(), RING_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      RingParticle &particle = particles[i];
+      glm::dvec3 acceleration = tidal * particle.position;
+      for (const auto &member : members) {
+        const glm::dvec3 r = member.position - particle.position;
+        const double distance_sq = glm::length2(r);
+        if (distance_sq < 1e-24) continue;
+        acceleration += r * (G * member.mass / (distance_sq * std::sqrt(distance_sq)));
+      }
+      particle.acceleration = acceleration;
+    }
+  });
+}
+
+// Hill's equations x'' = 2 w y' + 3 w^2 x, y'' = -2 w x', z'' = -w^2 z are linear, so
+// the sheet moves along their closed-form epicycles and the step size never costs accuracy
+void RingSystem::drift(double dt) {
+  if (config.geometry == RingGeometry::GLOBAL) {
+    scheduler().parallel_for(0, particles.size(), RING_CHUNK, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        particles[i].velocity += particles[i].acceleration * (0.5 * dt);
+        particles[i].position += particles[i].velocity * dt;
+      }
+    });
+    return;
+  }
+
+  const double w = omega;
+  const double c = std::cos(w * dt), s = std::sin(w * dt);
+  const double half_x = 0.5 * box.x, half_y = 0.5 * box.y;
+  sheet_time += dt;
+  const double shift = sheet_shift = std::fmod(1.5 * w * box.x * sheet_time, box.y);
+
+  scheduler().parallel_for(0, particles.size(), RING_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      glm::dvec3 &p = particles[i].position;
+      glm::dvec3 &v = particles[i].velocity;
+
+      const double k = v.y + 2.0 * w * p.x; // conserved, the guiding centre sits at 2 k / w
+      const double a = p.x - 2.0 * k / w, b = v.x / w;
+      p.y += -3.0 * k * dt - 2.0 * a * s + 2.0 * b * (c - 1.0);
+      p.x = 2.0 * k / w + a * c + b * s;
+      v.x = w * (b * c - a * s);
+      v.y = -3.0 * k - 2.0 * w * (a * c + b * s);
+      const double z = p.z;
+      p.z = z * c + v.z / w * s;
+      v.z = v.z * c - z * w * s;
+
+      // shear-periodic boundaries: the radial neighbours slide past along y with the shear
+      if (p.x >= half_x) {
+        p.x -= box.x;
+        p.y += shift;
+        v.y += 1.5 * w * box.x;
+      } else if (p.x < -half_x) {
+        p.x += box.x;
+        p.y -= shift;
+        v.y -= 1.5 * w * box.x;
+      }
+      p.y -= box.y * std::floor((p.y + half_y) / box.y);
+    }
+  });
+}
+
+void RingSystem::kick(double dt) {
+  if (config.geometry == RingGeometry::SHEARING_SHEET) return;
+  scheduler().parallel_for(0, particles.size(), RING_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      particles[i].velocity += particles[i].acceleration * (0.5 * dt);
+    }
+  });
+}
+
+// integer cell, wrapped along y in the sheet
+glm::ivec3 RingSystem::cell_of(const glm::dvec3 &position) const {
+  const glm::dvec3 offset = wrap_cells > 0 ? position + 0.5 * box : position;
+  return wrap(glm::ivec3(glm::floor(offset / cell_size)));
+}
+
+glm::ivec3 RingSystem::wrap(glm::ivec3 cell) const {
+  if (wrap_cells > 0) {
+    if (cell.y < 0) cell.y += wrap_cells;
+    else if (cell.y >= wrap_cells) cell.y -= wrap_cells;
+  }
+  return cell;
+}
+
+// Row-major index over the occupied cell box, z fastest since rings are thin, folded into
+// the table. Neighbouring cells land in nearby buckets; cells that fold onto the same
+// bucket are told apart by the cell stored with every particle.
+uint32_t RingSystem::bucket_of(glm::ivec3 cell) const {
+  const glm::uvec3 offset = glm::uvec3(cell - grid_origin);
+  return (offset.z + grid_extent.z * (offset.x + grid_extent.x * offset.y)) & bucket_mask;
+}
+
+// sorts the particles themselves by bucket, so every bucket is a contiguous run and
+// neighbours in space stay neighbours in memory for the resolution pass
+void RingSystem::build_cells() {
+  const size_t n = particles.size();
+  const size_t chunks = (n + RING_CHUNK - 1) / RING_CHUNK;
+  cell_entries.resize(n);
+  cells.resize(n);
+  cell_scratch_coords.resize(n);
+  chunk_bounds.resize(chunks);
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      glm::ivec3 lo(INT32_MAX), hi(INT32_MIN);
+      const size_t end = std::min(n, (c + 1) * RING_CHUNK);
+      for (size_t i = c * RING_CHUNK; i < end; ++i) {
+        cell_scratch_coords[i] = cell_of(particles[i].position);
+        lo = glm::min(lo, cell_scratch_coords[i]);
+        hi = glm::max(hi, cell_scratch_coords[i]);
+      }
+      chunk_bounds[c] = {lo, hi};
+    }
+  });
+
+  glm::ivec3 lo = chunk_bounds[0].first, hi = chunk_bounds[0].second;
+  for (const auto &[chunk_lo, chunk_hi] : chunk_bounds) {
+    lo = glm::min(lo, chunk_lo);
+    hi = glm::max(hi, chunk_hi);
+  }
+  grid_origin = lo - 1; // a margin so probed neighbours outside the box do not wrap onto the other side
+  grid_extent = glm::uvec3(hi - lo + 3);
+
+  scheduler().parallel_for(0, n, RING_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      cell_entries[i] = {bucket_of(cell_scratch_coords[i]), static_cast<uint32_t>(i)};
+    }
+  });
+  radix_sort_entries(cell_entries, cell_scratch, std::bit_width(bucket_mask));
+
+  particle_scratch.resize(n);
+  buckets.resize(static_cast<size_t>(bucket_mask) + 1);
+  scheduler().parallel_for(0, buckets.size(), 4 * RING_CHUNK, [&](size_t begin, size_t end) {
+    std::fill(buckets.begin() + begin, buckets.begin() + end, glm::uvec2(0));
+  });
+  scheduler().parallel_for(0, n, RING_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      particle_scratch[k] = particles[cell_entries[k].index];
+      cells[k] = cell_scratch_coords[cell_entries[k].index];
+      const uint64_t key = cell_entries[k].key;
+      if (k == 0 || cell_entries[k - 1].key != key) buckets[key].x = static_cast<uint32_t>(k);
+      if (k + 1 == n || cell_entries[k + 1].key != key) buckets[key].y = static_cast<uint32_t>(k + 1);
+    }
+  });
+  particles.swap(particle_scratch);
+}
+
+// velocity change of particle i from every approaching contact, half the inelastic
+// impulse of each pair; the partner computes the other half from the same velocities
+size_t RingSystem::resolve(size_t i, glm::dvec3 &delta) const {
+  struct Probe {
+    glm::dvec3 position, velocity;
+  };
+  const RingParticle &particle = particles[i];
+  Probe probes[2] = {{particle.position, particle.velocity}, {}};
+  int probe_count = 1;
+
+  // near a radial edge the partners are the sheared images of particles at the opposite edge
+  if (wrap_cells > 0) {
+    const double shift = sheet_shift;
+    const double slide = 1.5 * omega * box.x;
+    if (particle.position.x > 0.5 * box.x - cell_size.x) {
+      probes[probe_count++] = {particle.position + glm::dvec3(-box.x, shift, 0.0), particle.velocity + glm::dvec3(0.0, slide, 0.0)};
+    } else if (particle.position.x < cell_size.x - 0.5 * box.x) {
+      probes[probe_count++] = {particle.position + glm::dvec3(box.x, -shift, 0.0), particle.velocity - glm::dvec3(0.0, slide, 0.0)};
+    }
+  }
+
+  const double contact_sq = 4.0 * radius * radius;
+  const double impulse = 0.5 * (1.0 + config.restitution);
+  size_t contacts = 0;
+
+  for (int k = 0; k < probe_count; ++k) {
+    const Probe &probe = probes[k];
+    const glm::ivec3 cell = cell_of(probe.position);
+
+    for (int dz = -1; dz <= 1; ++dz) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          const glm::ivec3 neighbour = wrap(cell + glm::ivec3(dx, dy, dz));
+          const glm::uvec2 range = buckets[bucket_of(neighbour)];
+
+          for (uint32_t j = range.x; j < range.y; ++j) {
+            if (j == i || cells[j] != neighbour) continue;
+            glm::dvec3 d = particles[j].position - probe.position;
+            if (wrap_cells > 0) d.y -= box.y * std::round(d.y / box.y);
+            const double distance_sq = glm::length2(d);
+            if (distance_sq >= contact_sq || distance_sq == 0.0) continue;
+
+            const double approach = glm::dot(particles[j].velocity - probe.velocity, d);
+            if (approach >= 0.0) continue; // already separating
+            delta += (impulse * approach / distance_sq) * d;
+            ++contacts;
+          }
+        }
+      }
+    }
+  }
+  return contacts;
+}
+
+// the sheet is a local patch about its own guiding centre and stays where it is
+void RingSystem::shift_frame(const glm::dvec3 &offset, const glm::dvec3 &drift) {
+  if (config.geometry == RingGeometry::SHEARING_SHEET) return;
+  for (auto &particle : particles) {
+    particle.position -= offset;
+    particle.velocity -= drift;
+  }
+}
+
+glm::dvec3 RingSystem::drift_velocity(const RingParticle &particle) const {
+  if (config.geometry == RingGeometry::SHEARING_SHEET) return glm::dvec3(0.0, -1.5 * omega * particle.position.x, 0.0);
+  const double rho = std::sqrt(particle.position.x * particle.position.x + particle.position.y * particle.position.y);
+  if (rho == 0.0) return glm::dvec3(0.0);
+  return std::sqrt(planet_mu / rho) / rho * glm::dvec3(-particle.position.y, particle.position.x, 0.0);
+}
+
+void RingSystem::collide() {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = particles.size();
+  if (n == 0) return;
+
+  build_cells();
+
+  const size_t chunks = (n + RING_CHUNK - 1) / RING_CHUNK;
+  velocity_scratch.resize(n);
+  chunk_collisions.assign(chunks, 0);
+  chunk_dispersion.assign(chunks, 0.0);
+
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      const size_t end = std::min(n, (c + 1) * RING_CHUNK);
+      for (size_t i = c * RING_CHUNK; i < end; ++i) {
+        glm::dvec3 delta(0.0);
+        chunk_collisions[c] += resolve(i, delta);
+        velocity_scratch[i] = particles[i].velocity + delta;
+      }
+    }
+  });
+
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      const size_t end = std::min(n, (c + 1) * RING_CHUNK);
+      for (size_t i = c * RING_CHUNK; i < end; ++i) {
+        particles[i].velocity = velocity_scratch[i];
+        chunk_dispersion[c] += glm::length2(particles[i].velocity - drift_velocity(particles[i]));
+      }
+    }
+  });
+
+  size_t contacts = 0;
+  double dispersion = 0.0;
+  for (size_t c = 0; c < chunks; ++c) {
+    contacts += chunk_collisions[c];
+    dispersion += chunk_dispersion[c];
+  }
+  stats.collisions = contacts / 2; // both partners count every pair
+  stats.velocity_dispersion = std::sqrt(dispersion / n);
+  stats.collision_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
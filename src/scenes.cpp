@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include "scenes.hpp"
+#include "scheduler.hpp"
+
+namespace {
+
+constexpr double PI = std::numbers::pi;
+
+constexpr double BELT_OUTER = 3.3 / 2.1;  // outer over inner edge of the main belt
+constexpr double CLOUD_OUTER = 50.0;      // outer over inner edge of the Oort cloud
+constexpr double DISK_THICKNESS = 0.1;    // sech^2 scale height over scale length
+constexpr double DISK_DISPERSION = 0.05;  // velocity dispersion over circular speed
+constexpr double SMALL_BODY_MASS = 1e-12; // asteroids and comets, solar masses
+constexpr double STAR_DENSITY = 1.41 * GRAM_PER_CM3;  // the sun's, for every star
+constexpr double GIANT_DENSITY = 1.33 * GRAM_PER_CM3; // Jupiter's
+constexpr double COMET_DENSITY = 0.6 * GRAM_PER_CM3;  // asteroids keep the rocky default
+
+struct PresetDefaults {
+  double scale; // AU
+  double mass;  // solar masses
+  const char *name;
+};
+
+// indexed by ScenePreset
+constexpr PresetDefaults DEFAULTS[] = {
+    {10.0, 100.0, "Plummer Cluster"},       // Plummer radius, cluster mass
+    {5.0, 1.0, "Exponential Disk"},         // scale length, disk mass (the central hole matches it)
+    {2.1, 1.0, "Asteroid Belt"},            // inner edge, the star
+    {2000.0, 1.0, "Oort Cloud"},            // inner edge, the star
+    {5.0, 1.0, "Colliding Galaxies"},       // per disk, as the exponential disk
+};
+
+struct Scene {
+  ScenePreset preset;
+  size_t count;
+  double G;
+  double scale;
+  double mass;
+};
+
+glm::dvec3 isotropic(CounterRandom &random) {
+  const double z = 2.0 * random.uniform() - 1.0;
+  const double phi = 2.0 * PI * random.uniform();
+  const double s = std::sqrt(1.0 - z * z);
+  return {s * std::cos(phi), s * std::sin(phi), z};
+}
+
+CelestialBody particle(const glm::dvec3 &position, const glm::dvec3 &velocity, double mass, double radius,
+                       double density, const glm::vec3 &color) {
+  CelestialBody body = {};
+  body.position = position;
+  body.velocity = velocity;
+  body.mass = mass;
+  body.radius = radius;
+  body.density = density;
+  body.color = color;
+  return body;
+}
+
+// Aarseth, Henon & Wielen (1974): radius from the inverted cumulative mass, speed by
+// rejection from g(q) = q^2 (1 - q^2)^3.5 as a fraction of the local escape speed
+CelestialBody plummer(const Scene &scene, CounterRandom &random) {
+  double r;
+  do {
+    const double u = random.uniform();
+    r = scene.scale / std::sqrt(1.0 / std::cbrt(u * u) - 1.0);
+  } while (r > 20.0 * scene.scale);
+
+  double q;
+  do {
+    q = random.uniform();
+    const double g = 0.1 * random.uniform();
+    const double w = 1.0 - q * q;
+    if (g <= q * q * w * w * w * std::sqrt(w)) break;
+  } while (true);
+
+  const double escape = std::sqrt(2.0 * scene.G * scene.mass / scene.scale) /
+                        std::sqrt(std::sqrt(1.0 + r * r / (scene.scale * scene.scale)));
+  const float tint = static_cast<float>(random.uniform());
+  const glm::dvec3 position = r * isotropic(random);
+  const glm::dvec3 velocity = q * escape * isotropic(random);
+  return particle(position, velocity, scene.mass / static_cast<double>(scene.count),
+                  0.002 * scene.scale, STAR_DENSITY, glm::vec3(1.0f, 0.8f + 0.2f * tint, 0.6f + 0.4f * tint));
+}
+
+// One disk of `count` bodies in its own frame, a black hole of the disk's mass at local
+// index 0. 2 pi R Sigma(R) ~ R exp(-R / Rd) is a Gamma(2) law, the sum of two exponential
+// draws; circular speed from the enclosed disk mass as if it were spherical.
+CelestialBody disk(const Scene &scene, size_t local, size_t count, CounterRandom &random, const glm::vec3 &color) {
+  const double scale = scene.scale;
+  if (local == 0) {
+    CelestialBody hole = particle(glm::dvec3(0.0), glm::dvec3(0.0), scene.mass, 0.02 * scale, STAR_DENSITY, glm::vec3(0.0f));
+    hole.is_black_hole = true;
+    return hole;
+  }
+
+  // draws are sequenced one per statement, argument evaluation order is unspecified
+  const double u = random.uniform();
+  const double x = -std::log(u * random.uniform());
+  const double R = scale * x;
+  const double phi = 2.0 * PI * random.uniform();
+  const double z = DISK_THICKNESS * scale * std::atanh(2.0 * random.uniform() - 1.0);
+
+  const double enclosed = scene.mass * (2.0 - (1.0 + x) * std::exp(-x));
+  const double circular = std::sqrt(scene.G * enclosed / std::max(R, 1e-3 * scale));
+  const double sigma = DISK_DISPERSION * circular;
+  const glm::dvec3 along(-std::sin(phi), std::cos(phi), 0.0);
+  glm::dvec3 dispersion;
+  for (int k = 0; k < 3; ++k) dispersion[k] = random.normal();
+
+  const float fade = static_cast<float>(std::exp(-0.5 * x));
+  return particle(glm::dvec3(R * std::cos(phi), R * std::sin(phi), z), circular * along + sigma * dispersion,
+                  scene.mass / static_cast<double>(std::max<size_t>(count - 1, 1)), 0.002 * scale, STAR_DENSITY,
+                  glm::mix(color, glm::vec3(1.0f, 0.95f, 0.8f), fade));
+}
+
+// heliocentric state from elements; Newton on Kepler's equation from M + e sin M, which
+// the belt's small eccentricities take to round-off in two or three steps
+void orbit_state(double mu, double a, double e, double inclination, double node, double periapsis, double mean_anomaly,
+                 glm::dvec3 &position, glm::dvec3 &velocity) {
+  double E = mean_anomaly + e * std::sin(mean_anomaly);
+  for (int k = 0; k < 16; ++k) {
+    const double step = (E - e * std::sin(E) - mean_anomaly) / (1.0 - e * std::cos(E));
+    E -= step;
+    if (std::abs(step) < 1e-14) break;
+  }
+
+  const double cos_E = std::cos(E), sin_E = std::sin(E);
+  const double b = std::sqrt(1.0 - e * e);
+  const double rate = std::sqrt(mu / a) / (1.0 - e * cos_E);
+  const glm::dvec2 p(a * (cos_E - e), a * b * sin_E);
+  const glm::dvec2 v(-rate * sin_E, rate * b * cos_E);
+
+  const double cO = std::cos(node), sO = std::sin(node);
+  const double ci = std::cos(inclination), si = std::sin(inclination);
+  const double cw = std::cos(periapsis), sw = std::sin(periapsis);
+  const glm::dvec3 P(cO * cw - sO * sw * ci, sO * cw + cO * sw * ci, sw * si);
+  const glm::dvec3 Q(-cO * sw - sO * cw * ci, -sO * sw + cO * cw * ci, cw * si);
+  position = p.x * P + p.y * Q;
+  velocity = v.x * P + v.y * Q;
+}
+
+CelestialBody star(const Scene &scene) {
+  return particle(glm::dvec3(0.0), glm::dvec3(0.0), scene.mass, 0.2, STAR_DENSITY, glm::vec3(1.0f, 1.0f, 0.0f));
+}
+
+// index 0 the star, index 1 Jupiter on a circular orbit, the rest uniform in semi-major
+// axis with Rayleigh eccentricities and inclinations
+CelestialBody asteroid(const Scene &scene, size_t index, CounterRandom &random) {
+  if (index == 0) return star(scene);
+  const double mu = scene.G * scene.mass;
+  glm::dvec3 position, velocity;
+  if (index == 1) {
+    orbit_state(mu, 5.2, 0.0, 0.0, 0.0, 0.0, 0.0, position, velocity);
+    return particle(position, velocity, 9.55e-4 * scene.mass, 0.1, GIANT_DENSITY, glm::vec3(0.9f, 0.6f, 0.3f));
+  }
+
+  const double a = scene.scale * (1.0 + (BELT_OUTER - 1.0) * random.uniform());
+  const double e = std::min(0.1 * std::sqrt(-2.0 * std::log(random.uniform())), 0.9);
+  const double i = 0.1 * std::sqrt(-2.0 * std::log(random.uniform()));
+  const double node = 2.0 * PI * random.uniform();
+  const double periapsis = 2.0 * PI * random.uniform();
+  const double mean_anomaly = 2.0 * PI * random.uniform();
+  orbit_state(mu, a, e, i, node, periapsis, mean_anomaly, position, velocity);
+  const float shade = 0.4f + 0.3f * static_cast<float>(random.uniform());
+  return particle(position, velocity, SMALL_BODY_MASS, 0.005, BODY_DENSITY, glm::vec3(shade, 0.9f * shade, 0.8f * shade));
+}
+
+// isotropic shell with n(r) ~ r^-3.5 between the edges, dN/dr ~ r^-1.5 inverted in closed
+// form; speeds below escape with isotropic directions
+CelestialBody comet(const Scene &scene, size_t index, CounterRandom &random) {
+  if (index == 0) return star(scene);
+  const double inner = 1.0 / std::sqrt(scene.scale);
+  const double outer = 1.0 / std::sqrt(CLOUD_OUTER * scene.scale);
+  const double s = inner - random.uniform() * (inner - outer);
+  const double r = 1.0 / (s * s);
+
+  const double escape = std::sqrt(2.0 * scene.G * scene.mass / r);
+  const double speed = escape * std::sqrt(0.8 * random.uniform());
+  const glm::dvec3 position = r * isotropic(random);
+  const glm::dvec3 velocity = speed * isotropic(random);
+  return particle(position, velocity, SMALL_BODY_MASS, 0.002 * scene.scale, COMET_DENSITY,
+                  glm::vec3(0.6f, 0.8f, 1.0f));
+}
+
+// two disks, the first ceil(n/2) bodies and the rest, falling in on a parabolic orbit from
+// twenty scale lengths apart with four of impact parameter; the second disk tilted 60 degrees
+CelestialBody galaxy_member(const Scene &scene, size_t index, CounterRandom &random) {
+  const size_t first = (scene.count + 1) / 2;
+  const bool second = index >= first;
+  const size_t local = second ? index - first : index;
+  const size_t count = second ? scene.count - first : first;
+  CelestialBody body = disk(scene, local, count, random, second ? glm::vec3(1.0f, 0.6f, 0.3f) : glm::vec3(0.4f, 0.6f, 1.0f));
+
+  const glm::dvec3 separation(20.0 * scene.scale, 4.0 * scene.scale, 0.0);
+  const double approach = std::sqrt(2.0 * scene.G * 4.0 * scene.mass / glm::length(separation));
+  if (second) {
+    const double c = std::cos(PI / 3.0), s = std::sin(PI / 3.0);
+    const auto tilt = [&](const glm::dvec3 &v) { return glm::dvec3(v.x, c * v.y - s * v.z, s * v.y + c * v.z); };
+    body.position = tilt(body.position) + 0.5 * separation;
+    body.velocity = tilt(body.velocity) - glm::dvec3(0.5 * approach, 0.0, 0.0);
+  } else {
+    body.position -= 0.5 * separation;
+    body.velocity += glm::dvec3(0.5 * approach, 0.0, 0.0);
+  }
+  return body;
+}
+
+CelestialBody generate(const Scene &scene, size_t index, CounterRandom &random) {
+  switch (scene.preset) {
+  case ScenePreset::PLUMMER:            return plummer(scene, random);
+  case ScenePreset::EXPONENTIAL_DISK:   return disk(scene, index, scene.count, random, glm::vec3(0.4f, 0.6f, 1.0f));
+  case ScenePreset::ASTEROID_BELT:      return asteroid(scene, index, random);
+  case ScenePreset::OORT_CLOUD:         return comet(scene, index, random);
+  case ScenePreset::COLLIDING_GALAXIES: return galaxy_member(scene, index, random);
+  }
+  return {};
+}
+
+} // namespace
+
+CounterRandom::CounterRandom(uint64_t seed, uint64_t index)
+    : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}, index(index) {}
+
+std::array<uint32_t, 4> CounterRandom::next_block() {
+  std::array<uint32_t, 4> c = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), block++, 0};
+  std::array<uint32_t, 2> k = key;
+  for (int round = 0; round < 10; ++round) {
+    const uint64_t p0 = uint64_t(0xD2511F53u) * c[0];
+    const uint64_t p1 = uint64_t(0xCD9E8D57u) * c[2];
+    c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1),
+         static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0)};
+    k[0] += 0x9E3779B9u;
+    k[1] += 0xBB67AE85u;
+  }
+  return c;
+}
+
+double CounterRandom::uniform() {
+  if (used == 4) {
+    buffer = next_block();
+    used = 0;
+  }
+  return (buffer[used++] + 0.5) * 0x1p-32;
+}
+
+// both values of a Box-Muller pair are used, the second on the next call
+double CounterRandom::normal() {
+  if (has_spare) {
+    has_spare = false;
+    return spare;
+  }
+  const double radius = std::sqrt(-2.0 * std::log(uniform()));
+  const double angle = 2.0 * PI * uniform();
+  spare = radius * std::sin(angle);
+  has_spare = true;
+  return radius * std::cos(angle);
+}
+
+const char *scene_name(ScenePreset preset) { return DEFAULTS[static_cast<int>(preset)].name; }
+
+// Every body is a pure function of (seed, index), and the barycentre shift is summed per
+// fixed SCENE_CHUNK block and then over blocks in order, so the result does not depend on
+// how the scheduler splits the work.
+void generate_scene(const SceneConfig &config, double G, std::vector<CelestialBody> &bodies) {
+  const PresetDefaults &defaults = DEFAULTS[static_cast<int>(config.preset)];
+  const Scene scene = {config.preset, config.bodies, G, config.scale > 0.0 ? config.scale : defaults.scale,
+                       config.mass > 0.0 ? config.mass : defaults.mass};
+
+  bodies.resize(config.bodies);
+  const size_t chunks = (config.bodies + SCENE_CHUNK - 1) / SCENE_CHUNK;
+  std::vector<glm::dvec3> moments(chunks), momenta(chunks);
+  std::vector<double> masses(chunks);
+
+  scheduler().parallel_for(0, chunks, 1, [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      glm::dvec3 moment(0.0), momentum(0.0);
+      double mass = 0.0;
+      const size_t last = std::min(config.bodies, (chunk + 1) * SCENE_CHUNK);
+      for (size_t i = chunk * SCENE_CHUNK; i < last; ++i) {
+        CounterRandom random(config.seed, i);
+        bodies[i] = generate(scene, i, random);
+        moment += bodies[i].mass * bodies[i].position;
+        momentum += bodies[i].mass * bodies[i].velocity;
+        mass += bodies[i].mass;
+      }
+      moments[chunk] = moment;
+      momenta[chunk] = momentum;
+      masses[chunk] = mass;
+    }
+  });
+
+  glm::dvec3 moment(0.0), momentum(0.0);
+  double mass = 0.0;
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    moment += moments[chunk];
+    momentum += momenta[chunk];
+    mass += masses[chunk];
+  }
+  if (mass <= 0.0) return;
+
+  // barycentric frame
+  const glm::dvec3 centre = moment / mass, drift = momentum / mass;
+  scheduler().parallel_for(0, config.bodies, SCENE_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      bodies[i].position -= centre;
+      bodies[i].velocity -= drift;
+    }
+  });
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include "scheduler.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static thread_local const Scheduler *current_scheduler = nullptr;
+static thread_local unsigned current_worker = 0;
+
+static void pin_current_thread(unsigned core) {
+#if defined(_WIN32)
+  SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % CPU_SETSIZE, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)core; // no hard affinity on macOS
+#endif
+}
+
+Scheduler::Scheduler(unsigned worker_count, bool pin_threads) {
+  for (unsigned i = 0; i < worker_count; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (unsigned i = 0; i < worker_count; ++i) {
+    threads.emplace_back(&Scheduler::worker_main, this, i, pin_threads);
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  sleep_cv.notify_all();
+  for (auto &thread : threads) thread.join();
+}
+
+unsigned Scheduler::concurrency() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+void Scheduler::submit(TaskGroup &group, std::function<void()> work) {
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+
+  // workers push onto their own deque, everyone else goes through the injection queue
+  Worker &target = current_scheduler == this ? *workers[current_worker] : injection;
+  {
+    std::lock_guard<std::mutex> lock(target.mutex);
+    target.tasks.push_back({std::move(work), &group});
+  }
+  queued.fetch_add(1, std::memory_order_release);
+
+  { std::lock_guard<std::mutex> lock(sleep_mutex); }
+  sleep_cv.notify_one();
+}
+
+bool Scheduler::try_pop(Task &task) {
+  if (queued.load(std::memory_order_acquire) == 0) return false;
+
+  auto take = [&](Worker &worker, bool newest) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    if (newest) {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    } else {
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    }
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  };
+
+  const bool is_worker = current_scheduler == this;
+  const size_t self = is_worker ? current_worker : 0;
+
+  // own work newest-first (still hot in cache), then injected work, then steal oldest-first
+  if (is_worker && take(*workers[self], true)) return true;
+  if (take(injection, false)) return true;
+  for (size_t k = 1; k <= workers.size(); ++k) {
+    size_t victim = (self + k) % workers.size();
+    if (is_worker && victim == self) continue;
+    if (take(*workers[victim], false)) return true;
+  }
+  return false;
+}
+
+void Scheduler::execute(Task &task) {
+  task.work();
+  task.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void Scheduler::worker_main(unsigned index, bool pin_thread) {
+  current_scheduler = this;
+  current_worker = index;
+  if (pin_thread) pin_current_thread(index + 1); // core 0 is left to the main thread
+
+  Task task;
+  while (true) {
+    if (try_pop(task)) {
+      execute(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleep_cv.wait(lock, [&] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    if (stopping) return;
+  }
+}
+
+void Scheduler::wait(TaskGroup &group) {
+  Task task;
+  while (group.pending.load(std::memory_order_acquire) > 0) {
+    if (try_pop(task)) {
+      execute(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void Scheduler::parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body) {
+  if (end <= begin) return;
+  const size_t count = end - begin;
+  if (grain == 0) grain = std::max<size_t>(1, count / (4 * concurrency()));
+
+  if (count <= grain || concurrency() == 1) {
+    body(begin, end);
+    return;
+  }
+
+  // fork every chunk but the first, run that one here, then help until the rest are done
+  TaskGroup group;
+  for (size_t chunk = begin + grain; chunk < end; chunk += grain) {
+    const size_t chunk_end = std::min(end, chunk + grain);
+    submit(group, [&body, chunk, chunk_end] { body(chunk, chunk_end); });
+  }
+  body(begin, std::min(end, begin + grain));
+  wait(group);
+}
+
+size_t TaskGraph::add(std::function<void()> work) {
+  nodes.emplace_back();
+  nodes.back().work = std::move(work);
+  return nodes.size() - 1;
+}
+
+void TaskGraph::precede(size_t before, size_t after) {
+  nodes[before].successors.push_back(after);
+  nodes[after].dependencies++;
+}
+
+// successors are submitted before the finishing node leaves the group, so the group
+// cannot drain early
+void TaskGraph::launch(Scheduler &scheduler, TaskGroup &group, size_t index) {
+  scheduler.submit(group, [this, &scheduler, &group, index] {
+    nodes[index].work();
+    for (size_t successor : nodes[index].successors) {
+      if (nodes[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        launch(scheduler, group, successor);
+      }
+    }
+  });
+}
+
+void TaskGraph::run(Scheduler &scheduler) {
+  for (auto &node : nodes) {
+    node.remaining.store(node.dependencies, std::memory_order_relaxed);
+  }
+
+  TaskGroup group;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i].dependencies == 0) launch(scheduler, group, i);
+  }
+  scheduler.wait(group);
+}
+
+Scheduler &scheduler() {
+  static Scheduler instance(std::max(1u, std::thread::hardware_concurrency()) - 1, SCHEDULER_PIN_THREADS);
+  return instance;
+}
@@ -1,20 +1,359 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <numbers>
+#include <random>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include "scheduler.hpp"
 #include "simulation.hpp"
+#include "summation.hpp"
+
+Simulation::Simulation() : G(DEFAULT_G), thread_count(scheduler().concurrency()) {
+  current_integrator = &Simulation::integrate_velocity_verlet<PrecisionMode::DOUBLE>;
+}
 
-Simulation::Simulation() : G(DEFAULT_G)              { current_integrator = &Simulation::integrate_velocity_verlet; }
-void Simulation::add_body(const CelestialBody &body) { bodies.push_back(body); }
-void Simulation::clear_bodies()                      { bodies.clear(); }
 void Simulation::setG(double value)                  { G = value; }
 double Simulation::getG()                      const { return G; }
 std::vector<CelestialBody> &Simulation::get_bodies() { return bodies; }
+void Simulation::set_deterministic(bool enabled)     { deterministic = enabled; }
+bool Simulation::is_deterministic()            const { return deterministic; }
+PrecisionMode Simulation::get_precision_mode() const { return precision; }
+ForceSolver Simulation::get_force_solver()     const { return force_solver; }
+void Simulation::set_reorder_interval(int steps)     { reorder_interval = std::max(0, steps); }
+int Simulation::get_reorder_interval()         const { return reorder_interval; }
+const OctreeStats &Simulation::get_tree_stats() const { return octree.get_stats(); }
+const std::vector<Subsystem> &Simulation::get_subsystems() const { return subsystems; }
+const GasDisk *Simulation::get_gas_disk() const                  { return gas ? &*gas : nullptr; }
+BodyHandle Simulation::get_gas_host() const                      { return gas_host; }
+ExternalForces &Simulation::get_external_forces()  { return external_forces; }
+const DisruptionConfig &Simulation::get_disruption() const { return disruption; }
+const DisruptionStats &Simulation::get_disruption_stats() const { return disruption_stats; }
+const std::vector<CelestialBody> &Simulation::get_test_particles() const { return test_particles; }
+const std::vector<Probe> &Simulation::get_probes() const { return probes; }
+const ProbeStats &Simulation::get_probe_stats() const { return probe_stats; }
+const PeriodicConfig &Simulation::get_periodic() const { return periodic; }
+const SofteningConfig &Simulation::get_softening() const { return softening; }
+const SofteningStats &Simulation::get_softening_stats() const { return softening_stats; }
+const std::vector<double> &Simulation::get_softening_lengths() const { return softening_lengths; }
+bool Simulation::is_variational()              const { return variational; }
+const ChaosIndicators &Simulation::get_chaos_indicators() const { return chaos; }
+void Simulation::set_thread_count(unsigned count)    { thread_count = std::max(1u, count); }
+unsigned Simulation::get_thread_count()        const { return thread_count; }
+uint64_t Simulation::get_state_hash()          const { return state_hash; }
+uint64_t Simulation::get_step_count()          const { return step_count; }
+double Simulation::get_time()                  const { return dd_to_double(time); }
 
-void Simulation::compute_forces() {
+SolverConfig Simulation::get_solver_config() const {
+  return {force_solver, thread_count, mixed_tile_size, octree.get_leaf_size()};
+}
+
+void Simulation::set_solver_config(const SolverConfig &config) {
+  set_force_solver(config.solver);
+  thread_count = std::max(1u, config.threads);
+  mixed_tile_size = std::clamp(config.mixed_tile_size, 1u, static_cast<unsigned>(MIXED_TILE_SIZE));
+  if (config.leaf_size != octree.get_leaf_size()) octree.set_leaf_size(config.leaf_size);
+}
+
+// the pair kernels are refused above DIRECT_MAX_BODIES, the current solver stays
+void Simulation::set_force_solver(ForceSolver solver) {
+  if (solver != ForceSolver::BARNES_HUT && !supports_direct()) return;
+  force_solver = solver;
+  if (variational && !supports_variational()) set_variational(false);
+}
+
+BodyHandle Simulation::add_body(const CelestialBody &body) {
+  uint32_t slot;
+  if (free_slots.empty()) {
+    slot = static_cast<uint32_t>(slots.size());
+    slots.push_back({0, 0});
+  } else {
+    slot = free_slots.back();
+    free_slots.pop_back();
+  }
+
+  slots[slot].dense = static_cast<uint32_t>(bodies.size());
+  slots[slot].fragment = false;
+  bodies.push_back(body);
+  dense_slots.push_back(slot);
+  record_insertions(bodies.size() - 1);
+  octree.invalidate();
+  tangent_stale = variational;
+  softening_stale = true;
+  if (gas) gas->bodies_changed();
+  return {slot, slots[slot].generation};
+}
+
+// the whole batch in one insertion: storage grows at most once, and the tree, softening,
+// tangent and gas bookkeeping that add_body redoes per body is invalidated once
+size_t Simulation::add_bodies(std::span<const CelestialBody> batch) {
+  const size_t first = bodies.size();
+  bodies.insert(bodies.end(), batch.begin(), batch.end());
+  dense_slots.resize(bodies.size());
+  slots.reserve(slots.size() + batch.size() - std::min(batch.size(), free_slots.size()));
+
+  for (size_t i = first; i < bodies.size(); ++i) {
+    uint32_t slot;
+    if (free_slots.empty()) {
+      slot = static_cast<uint32_t>(slots.size());
+      slots.push_back({0, 0});
+    } else {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    slots[slot].dense = static_cast<uint32_t>(i);
+    slots[slot].fragment = false;
+    dense_slots[i] = slot;
+  }
+  record_insertions(first);
+
+  octree.invalidate();
+  tangent_stale = variational;
+  softening_stale = true;
+  if (gas) gas->bodies_changed();
+  return first;
+}
+
+void Simulation::reserve_bodies(size_t capacity) {
+  bodies.reserve(capacity);
+  dense_slots.reserve(capacity);
+  slots.reserve(capacity);
+}
+
+// O(1): the last dense body moves into the hole and its slot is repointed
+void Simulation::remove_body(BodyHandle handle) {
+  if (!is_valid(handle)) return;
+
+  const uint32_t hole = slots[handle.slot].dense;
+  const uint32_t last = static_cast<uint32_t>(bodies.size() - 1);
+  if (hole != last) {
+    bodies[hole] = bodies[last];
+    dense_slots[hole] = dense_slots[last];
+    slots[dense_slots[hole]].dense = hole;
+  }
+  bodies.pop_back();
+  dense_slots.pop_back();
+  std::erase_if(subsystems, [&](const Subsystem &subsystem) { return subsystem.host == handle; });
+  tangent_stale = variational;
+  softening_stale = true;
+  if (gas) gas->bodies_changed();
+
+  slots[handle.slot].generation++;
+  free_slots.push_back(handle.slot);
+  octree.invalidate();
+}
+
+// dense bodies from first on were just added; handles of removed bodies are dropped once
+// they outnumber the live ones, so the history stays O(bodies)
+void Simulation::record_insertions(size_t first) {
+  if (insertion_order.size() > 2 * bodies.size() + 64) {
+    std::erase_if(insertion_order, [this](BodyHandle handle) { return !is_valid(handle); });
+  }
+  for (size_t i = first; i < bodies.size(); ++i) insertion_order.push_back(handle_of(i));
+}
+
+// dense order says nothing about age once a swap-and-pop removal or a reorder has moved bodies
+void Simulation::remove_newest_body() {
+  while (!insertion_order.empty() && !is_valid(insertion_order.back())) insertion_order.pop_back();
+  if (insertion_order.empty()) return;
+  remove_body(insertion_order.back());
+  insertion_order.pop_back();
+}
+
+bool Simulation::is_valid(BodyHandle handle) const {
+  return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation &&
+         slots[handle.slot].dense < bodies.size() && dense_slots[slots[handle.slot].dense] == handle.slot;
+}
+
+CelestialBody *Simulation::get_body(BodyHandle handle) {
+  return is_valid(handle) ? &bodies[slots[handle.slot].dense] : nullptr;
+}
+
+BodyHandle Simulation::handle_of(size_t index) const {
+  if (index >= bodies.size()) return {};
+  return {dense_slots[index], slots[dense_slots[index]].generation};
+}
+
+size_t Simulation::index_of(BodyHandle handle) const {
+  return is_valid(handle) ? slots[handle.slot].dense : SIZE_MAX;
+}
+
+void Simulation::clear_bodies() {
+  for (uint32_t slot : dense_slots) {
+    slots[slot].generation++;
+    free_slots.push_back(slot);
+  }
+  bodies.clear();
+  dense_slots.clear();
+  marked_bodies.clear();
+  insertion_order.clear();
+  test_particles.clear();
+  probes.clear();
+  subsystems.clear();
+  gas.reset();
+  octree.invalidate();
+  tangent_stale = variational;
+  softening_stale = true;
+}
+
+// runs fn(t) for every partition t in [0, count) on the shared scheduler
+template <typename Fn>
+static void run_partitions(unsigned count, Fn &&fn) {
+  scheduler().parallel_for(0, count, 1, [&](size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) fn(static_cast<unsigned>(t));
+  });
+}
+
+static inline uint64_t hash_mix(uint64_t hash, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  hash = (hash ^ bits) * 0x100000001b3ULL;
+  return hash ^ (hash >> 29);
+}
+
+static inline uint64_t hash_body(uint64_t hash, const CelestialBody &body) {
+  hash = hash_mix(hash, body.position.x);
+  hash = hash_mix(hash, body.position.y);
+  hash = hash_mix(hash, body.position.z);
+  hash = hash_mix(hash, body.velocity.x);
+  hash = hash_mix(hash, body.velocity.y);
+  hash = hash_mix(hash, body.velocity.z);
+  return hash_mix(hash, body.mass);
+}
+
+template <PrecisionMode Mode>
+static inline void accumulate(glm::dvec3 &sum, glm::dvec3 &low, const glm::dvec3 &value) {
+  if constexpr (Mode == PrecisionMode::COMPENSATED) {
+    compensated_add(sum, low, value);
+  } else if constexpr (Mode == PrecisionMode::DOUBLE_DOUBLE) {
+    dd_add(sum, low, value);
+  } else {
+    sum += value;
+  }
+}
+
+// dense indices of the up to K heaviest bodies, heaviest first, ties to the lower index
+template <size_t K>
+static size_t heaviest_bodies(const std::vector<CelestialBody> &bodies, std::array<uint32_t, K> &heaviest) {
+  size_t count = 0;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    if (count == K && bodies[i].mass <= bodies[heaviest.back()].mass) continue;
+    size_t k = std::min(count, K - 1);
+    while (k > 0 && bodies[heaviest[k - 1]].mass < bodies[i].mass) {
+      heaviest[k] = heaviest[k - 1];
+      --k;
+    }
+    heaviest[k] = static_cast<uint32_t>(i);
+    count = std::min(count + 1, K);
+  }
+  return count;
+}
+
+// folds positions that drifted out of the periodic box back into [0, box)
+template <PrecisionMode Mode>
+static void wrap_into_box(std::vector<CelestialBody> &bodies, double box) {
   for (auto &body : bodies) {
-    body.previous_acceleration = body.acceleration;
-    body.acceleration = glm::dvec3(0.0);
+    const glm::dvec3 shift = -box * glm::floor(body.position / box);
+    if (shift != glm::dvec3(0.0)) accumulate<Mode>(body.position, body.position_compensation, shift);
+  }
+}
+
+void Simulation::set_precision_mode(PrecisionMode mode) {
+  if (mode == PrecisionMode::DOUBLE_DOUBLE && !supports_direct()) return; // its kernel is a pair loop
+  if (mode != precision) {
+    for (auto &body : bodies) {
+      body.position_compensation = glm::dvec3(0.0);
+      body.velocity_compensation = glm::dvec3(0.0);
+    }
+  }
+  precision = mode;
+  if (variational && !supports_variational()) set_variational(false);
+
+  switch (mode) {
+  case PrecisionMode::DOUBLE:
+    current_integrator = &Simulation::integrate_velocity_verlet<PrecisionMode::DOUBLE>;
+    break;
+  case PrecisionMode::COMPENSATED:
+    current_integrator = &Simulation::integrate_velocity_verlet<PrecisionMode::COMPENSATED>;
+    break;
+  case PrecisionMode::DOUBLE_DOUBLE:
+    current_integrator = &Simulation::integrate_velocity_verlet<PrecisionMode::DOUBLE_DOUBLE>;
+    break;
+  }
+}
+
+const char *force_kernel_name(ForceKernel kernel) {
+  static const char *const names[] = {
+      "Periodic (Ewald)",  "Variational (direct)", "Double-double",   "Softened (direct)",  "Mixed (float32)",
+      "Barnes-Hut (octree)", "Deterministic tiles", "Parallel direct", "Compensated direct", "Serial direct"};
+  return names[static_cast<int>(kernel)];
+}
+
+// the dispatch in priority order. The periodic box, the chaos indicators and double-double
+// replace whatever solver was picked; adaptive softening takes over every other kernel but
+// Barnes-Hut, so it runs in place of the float32 kernel, compensated summation and the
+// deterministic tiles (its own sums are ordered, the state hash stays reproducible)
+ForceKernel Simulation::get_force_kernel() const {
+  if (periodic.enabled) return ForceKernel::PERIODIC;
+  if (variational) return ForceKernel::VARIATIONAL;
+  if (precision == PrecisionMode::DOUBLE_DOUBLE) return ForceKernel::DOUBLE_DOUBLE;
+  if (softening.adaptive && force_solver != ForceSolver::BARNES_HUT) return ForceKernel::SOFTENED;
+  if (force_solver == ForceSolver::MIXED_PRECISION) return ForceKernel::MIXED_PRECISION;
+  if (force_solver == ForceSolver::BARNES_HUT) return ForceKernel::BARNES_HUT;
+  if (deterministic) return ForceKernel::DETERMINISTIC;
+  if (thread_count > 1 && bodies.size() >= PARALLEL_FORCE_THRESHOLD) return ForceKernel::PARALLEL;
+  if (precision == PrecisionMode::COMPENSATED) return ForceKernel::COMPENSATED;
+  return ForceKernel::SERIAL;
+}
+
+// accumulates into accelerations already zeroed by the integrator's drift pass
+void Simulation::compute_forces() {
+  if (softening.adaptive && (softening_stale || ++softening_age >= softening.interval)) {
+    refresh_softening();
+  }
+
+  switch (get_force_kernel()) {
+  case ForceKernel::PERIODIC:
+    compute_forces_periodic();
+    break;
+  case ForceKernel::VARIATIONAL:
+    compute_forces_variational();
+    break;
+  case ForceKernel::DOUBLE_DOUBLE:
+    compute_forces_double_double();
+    break;
+  case ForceKernel::SOFTENED:
+    compute_forces_softened();
+    break;
+  case ForceKernel::MIXED_PRECISION:
+    compute_forces_mixed_precision();
+    break;
+  case ForceKernel::BARNES_HUT:
+    compute_forces_barnes_hut();
+    break;
+  case ForceKernel::DETERMINISTIC:
+    compute_forces_deterministic();
+    break;
+  case ForceKernel::PARALLEL:
+    compute_forces_parallel();
+    break;
+  case ForceKernel::COMPENSATED:
+    compute_forces_serial<true>();
+    break;
+  case ForceKernel::SERIAL:
+    compute_forces_serial<false>();
+    break;
+  }
+}
+
+template <bool Compensated>
+void Simulation::compute_forces_serial() {
+  if constexpr (Compensated) {
+    force_scratch.assign(bodies.size(), glm::dvec3(0.0)); // acceleration compensation
   }
 
   for (size_t i = 0; i < bodies.size(); ++i) {
@@ -31,71 +370,1230 @@ void Simulation::compute_forces() {
       glm::dvec3 force_dir = glm::normalize(r);
       glm::dvec3 force = force_magnitude * force_dir;
 
-      body1.acceleration += force / body1.mass;
-      body2.acceleration -= force / body2.mass;
+      if constexpr (Compensated) {
+        compensated_add(body1.acceleration, force_scratch[i], force / body1.mass);
+        compensated_add(body2.acceleration, force_scratch[j], -force / body2.mass);
+      } else {
+        body1.acceleration += force / body1.mass;
+        body2.acceleration -= force / body2.mass;
+      }
     }
   }
 }
 
-void Simulation::apply_post_newtonian_corrections() {
-  const double C_SQ = C * C;
+// symmetric pair loop with one partial buffer per thread, summed in thread order.
+// fast, but the rounding depends on the thread count
+void Simulation::compute_forces_parallel() {
+  const size_t n = bodies.size();
+  const unsigned threads = thread_count;
+  force_scratch.assign(threads * n, glm::dvec3(0.0));
 
-  std::vector<CelestialBody *> blackholes;
-  for (auto &body : bodies) {
-    if (body.is_black_hole) {
-      blackholes.push_back(&body);
+  run_partitions(threads, [&](unsigned t) {
+    glm::dvec3 *acc = &force_scratch[t * n];
+    // interleaved rows balance the shrinking j > i ranges
+    for (size_t i = t; i < n; i += threads) {
+      const glm::dvec3 pi = bodies[i].position;
+      const double mi = bodies[i].mass;
+      glm::dvec3 acc_i(0.0);
+
+      for (size_t j = i + 1; j < n; ++j) {
+        glm::dvec3 r = bodies[j].position - pi;
+        double distance_sq = glm::length2(r);
+        if (distance_sq < 1e-12) continue;
+
+        glm::dvec3 scaled = r * (G / (distance_sq * std::sqrt(distance_sq)));
+        acc_i += scaled * bodies[j].mass;
+        acc[j] -= scaled * mi;
+      }
+      acc[i] += acc_i;
+    }
+  });
+
+  run_partitions(threads, [&](unsigned t) {
+    for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+      for (unsigned k = 0; k < threads; ++k) {
+        bodies[i].acceleration += force_scratch[k * n + i];
+      }
+    }
+  });
+}
+
+// bitwise reproducible for any thread count: every i-tile sums each fixed j-tile into its own
+// partial, then the partials are combined by a pairwise tree in fixed order. the work split
+// between threads only decides who computes a tile, never the order of any addition
+void Simulation::compute_forces_deterministic() {
+  const size_t n = bodies.size();
+  const size_t tiles = (n + FORCE_TILE_SIZE - 1) / FORCE_TILE_SIZE;
+  const unsigned threads = static_cast<unsigned>(std::min<size_t>(thread_count, tiles));
+  force_scratch.resize(threads * tiles * FORCE_TILE_SIZE);
+
+  run_partitions(threads, [&](unsigned t) {
+    glm::dvec3 *partials = &force_scratch[t * tiles * FORCE_TILE_SIZE]; // [j_tile][i - i_begin]
+
+    for (size_t i_tile = t; i_tile < tiles; i_tile += threads) {
+      const size_t i_begin = i_tile * FORCE_TILE_SIZE;
+      const size_t i_end = std::min(n, i_begin + FORCE_TILE_SIZE);
+
+      for (size_t j_tile = 0; j_tile < tiles; ++j_tile) {
+        const size_t j_begin = j_tile * FORCE_TILE_SIZE;
+        const size_t j_end = std::min(n, j_begin + FORCE_TILE_SIZE);
+        glm::dvec3 *partial = &partials[j_tile * FORCE_TILE_SIZE];
+
+        for (size_t i = i_begin; i < i_end; ++i) {
+          const glm::dvec3 pi = bodies[i].position;
+          glm::dvec3 acc(0.0), acc_compensation(0.0);
+          for (size_t j = j_begin; j < j_end; ++j) {
+            glm::dvec3 r = bodies[j].position - pi;
+            double distance_sq = glm::length2(r);
+            if (distance_sq < 1e-12) continue;
+            glm::dvec3 term = r * (G * bodies[j].mass / (distance_sq * std::sqrt(distance_sq)));
+            if (precision == PrecisionMode::COMPENSATED) {
+              compensated_add(acc, acc_compensation, term);
+            } else {
+              acc += term;
+            }
+          }
+          partial[i - i_begin] = acc;
+        }
+      }
+
+      for (size_t width = 1; width < tiles; width *= 2) {
+        for (size_t k = 0; k + width < tiles; k += 2 * width) {
+          for (size_t i = 0; i < i_end - i_begin; ++i) {
+            partials[k * FORCE_TILE_SIZE + i] += partials[(k + width) * FORCE_TILE_SIZE + i];
+          }
+        }
+      }
+
+      for (size_t i = i_begin; i < i_end; ++i) {
+        bodies[i].acceleration += partials[i - i_begin];
+      }
+    }
+  });
+}
+
+// separations are taken from the double-double positions and rounded once, so close pairs
+// far from the origin keep their full relative precision. structure-of-arrays scratch keeps
+// the inner loop branch-free and vectorizable; serial, so it is deterministic as well
+void Simulation::compute_forces_double_double() {
+  const size_t n = bodies.size();
+  soa_scratch.resize(10 * n);
+  double *hx = soa_scratch.data(), *hy = hx + n, *hz = hy + n;
+  double *lx = hz + n, *ly = lx + n, *lz = ly + n;
+  double *ax = lz + n, *ay = ax + n, *az = ay + n, *m = az + n;
+
+  for (size_t i = 0; i < n; ++i) {
+    hx[i] = bodies[i].position.x; lx[i] = bodies[i].position_compensation.x;
+    hy[i] = bodies[i].position.y; ly[i] = bodies[i].position_compensation.y;
+    hz[i] = bodies[i].position.z; lz[i] = bodies[i].position_compensation.z;
+    ax[i] = ay[i] = az[i] = 0.0;
+    m[i] = bodies[i].mass;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    double ax_i = 0.0, ay_i = 0.0, az_i = 0.0;
+
+    for (size_t j = i + 1; j < n; ++j) {
+      const double dx = dd_difference(hx[j], lx[j], hx[i], lx[i]);
+      const double dy = dd_difference(hy[j], ly[j], hy[i], ly[i]);
+      const double dz = dd_difference(hz[j], lz[j], hz[i], lz[i]);
+      const double distance_sq = dx * dx + dy * dy + dz * dz;
+      const double inv_cube = distance_sq < 1e-12 ? 0.0 : G / (distance_sq * std::sqrt(distance_sq));
+
+      ax_i += dx * m[j] * inv_cube; ay_i += dy * m[j] * inv_cube; az_i += dz * m[j] * inv_cube;
+      ax[j] -= dx * m[i] * inv_cube; ay[j] -= dy * m[i] * inv_cube; az[j] -= dz * m[i] * inv_cube;
+    }
+
+    ax[i] += ax_i; ay[i] += ay_i; az[i] += az_i;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    bodies[i].acceleration += glm::dvec3(ax[i], ay[i], az[i]);
+  }
+}
+
+// float32 pair interactions for large visual-only scenes. each tile of mixed_tile_size bodies
+// stores float offsets from its own double centroid; for a tile pair only the origin difference
+// is rounded to float, so separations stay accurate while the inner loop runs twice as many
+// lanes. per tile pair sums are float, everything across tiles accumulates in double.
+// tiles are processed in fixed order, so the result does not depend on the thread count
+void Simulation::compute_forces_mixed_precision() {
+  const size_t n = bodies.size();
+  const size_t tile_size = mixed_tile_size;
+  const size_t tiles = (n + tile_size - 1) / tile_size;
+  const unsigned threads = n >= PARALLEL_FORCE_THRESHOLD ? static_cast<unsigned>(std::min<size_t>(thread_count, tiles)) : 1;
+
+  std::vector<glm::dvec3> origins(tiles, glm::dvec3(0.0));
+  mixed_scratch.resize(4 * n + threads * 6 * MIXED_TILE_SIZE);
+  float *rx = mixed_scratch.data(), *ry = rx + n, *rz = ry + n, *m = rz + n;
+
+  for (size_t tile = 0; tile < tiles; ++tile) {
+    const size_t begin = tile * tile_size;
+    const size_t end = std::min(n, begin + tile_size);
+    for (size_t i = begin; i < end; ++i) origins[tile] += bodies[i].position;
+    origins[tile] /= static_cast<double>(end - begin);
+
+    for (size_t i = begin; i < end; ++i) {
+      const glm::dvec3 local = bodies[i].position - origins[tile];
+      rx[i] = static_cast<float>(local.x);
+      ry[i] = static_cast<float>(local.y);
+      rz[i] = static_cast<float>(local.z);
+      m[i] = static_cast<float>(bodies[i].mass);
     }
   }
 
-  for (auto *bh : blackholes) {
-    const double rs = (2.0 * G * bh->mass) / C_SQ;
+  run_partitions(threads, [&](unsigned t) {
+    float *fax = m + n + t * 6 * MIXED_TILE_SIZE, *fay = fax + MIXED_TILE_SIZE, *faz = fay + MIXED_TILE_SIZE;
+    float *xi = faz + MIXED_TILE_SIZE, *yi = xi + MIXED_TILE_SIZE, *zi = yi + MIXED_TILE_SIZE;
+    glm::dvec3 acc[MIXED_TILE_SIZE];
+
+    for (size_t i_tile = t; i_tile < tiles; i_tile += threads) {
+      const size_t i_begin = i_tile * tile_size;
+      const size_t count = std::min(n, i_begin + tile_size) - i_begin;
+      std::fill_n(acc, count, glm::dvec3(0.0));
+
+      for (size_t j_tile = 0; j_tile < tiles; ++j_tile) {
+        const size_t j_begin = j_tile * tile_size;
+        const size_t j_end = std::min(n, j_begin + tile_size);
+
+        // i positions expressed relative to the j tile's origin
+        const glm::vec3 shift(origins[i_tile] - origins[j_tile]);
+        for (size_t k = 0; k < count; ++k) {
+          xi[k] = rx[i_begin + k] + shift.x;
+          yi[k] = ry[i_begin + k] + shift.y;
+          zi[k] = rz[i_begin + k] + shift.z;
+          fax[k] = fay[k] = faz[k] = 0.0f;
+        }
+
+        // j is broadcast and the loop runs over i, so it vectorizes without reassociating sums
+        for (size_t j = j_begin; j < j_end; ++j) {
+          const float xj = rx[j], yj = ry[j], zj = rz[j], mj = m[j];
+          for (size_t k = 0; k < count; ++k) {
+            const float dx = xj - xi[k];
+            const float dy = yj - yi[k];
+            const float dz = zj - zi[k];
+            const float distance_sq = dx * dx + dy * dy + dz * dz;
+            const float f = distance_sq < 1e-12f ? 0.0f : mj / (distance_sq * std::sqrt(distance_sq));
+            fax[k] += dx * f;
+            fay[k] += dy * f;
+            faz[k] += dz * f;
+          }
+        }
+
+        for (size_t k = 0; k < count; ++k) {
+          acc[k] += glm::dvec3(fax[k], fay[k], faz[k]);
+        }
+      }
+
+      for (size_t k = 0; k < count; ++k) {
+        bodies[i_begin + k].acceleration += G * acc[k];
+      }
+    }
+  });
+}
+
+// O(N log N) approximation through the octree, which is refitted every step and only
+// rebuilt when bodies changed or the refitted nodes have grown too loose
+void Simulation::compute_forces_barnes_hut() {
+  octree.update(bodies, morton_keys, morton_scratch);
 
-    for (auto &other : bodies) {
-      if (&other == bh || other.is_black_hole) continue;
+  scheduler().parallel_for(0, bodies.size(), 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      bodies[i].acceleration += octree.acceleration(bodies, i, G, softening.adaptive ? &softening_lengths : nullptr);
+    }
+  });
+}
 
-      glm::dvec3 r = other.position - bh->position;
-      double distance = glm::length(r);
+// Forces and the tangent map in one symmetric sweep. For r = x_j - x_i and dr = dx_j - dx_i
+// the linearized acceleration is G m_j (dr / |r|^3 - 3 (r.dr) r / |r|^5), which reuses the
+// separation and 1/|r|^3 of the force term. Both terms are antisymmetric in the pair, so
+// each pair is evaluated once and applied to both bodies. Rows are interleaved over a number
+// of partitions that depends only on n, each with its own buffers, summed in partition
+// order afterwards: the result does not depend on the thread count.
+void Simulation::compute_forces_variational() {
+  const size_t n = bodies.size();
+  if (tangent.size() != n) tangent.assign(n, TangentVector{});
+  const size_t partitions = std::clamp<size_t>(n / FORCE_TILE_SIZE, 1, VARIATIONAL_PARTITIONS);
+  force_scratch.assign(2 * partitions * n, glm::dvec3(0.0)); // [partition][acceleration, tangent][body]
 
-      if (distance < 100.0 * rs) continue;
-      if (distance < 1e-10)      continue;
+  run_partitions(static_cast<unsigned>(partitions), [&](unsigned p) {
+    glm::dvec3 *acc = &force_scratch[2 * p * n], *tan = acc + n;
+    for (size_t i = p; i < n; i += partitions) {
+      const glm::dvec3 pi = bodies[i].position, di = tangent[i].position;
+      const double mi = bodies[i].mass;
+      glm::dvec3 acc_i(0.0), tan_i(0.0);
 
-      glm::dvec3 direction = glm::normalize(r);
-      double v_sq = glm::length2(other.velocity);
+      for (size_t j = i + 1; j < n; ++j) {
+        const glm::dvec3 r = bodies[j].position - pi;
+        const double distance_sq = glm::length2(r);
+        if (distance_sq < 1e-12) continue;
 
-      double correction = (3.0 * G * bh->mass) / (C_SQ * distance);
-      glm::dvec3 extra_accel = correction * v_sq * direction;
+        const double inv_cube = 1.0 / (distance_sq * std::sqrt(distance_sq));
+        const glm::dvec3 dr = tangent[j].position - di;
+        const glm::dvec3 pull = r * inv_cube;
+        const glm::dvec3 shear = (dr - r * (3.0 * glm::dot(r, dr) / distance_sq)) * inv_cube;
+        acc_i += pull * bodies[j].mass;
+        acc[j] -= pull * mi;
+        tan_i += shear * bodies[j].mass;
+        tan[j] -= shear * mi;
+      }
+      acc[i] += acc_i;
+      tan[i] += tan_i;
+    }
+  });
 
-      other.acceleration += extra_accel;
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      glm::dvec3 acc(0.0), tan(0.0);
+      for (size_t p = 0; p < partitions; ++p) {
+        acc += force_scratch[2 * p * n + i];
+        tan += force_scratch[(2 * p + 1) * n + i];
+      }
+      bodies[i].acceleration += G * acc;
+      tangent[i].acceleration = G * tan;
     }
+  });
+}
+
+// j broadcast over a block of i lanes, every pair visited from both sides, each i summing
+// over j in index order, so the inner loop vectorizes and the result does not depend on
+// the thread count. Pairs use the larger of both softening lengths, which keeps the forces
+// antisymmetric.
+void Simulation::compute_forces_softened() {
+  const size_t n = bodies.size();
+  const size_t blocks = (n + FORCE_TILE_SIZE - 1) / FORCE_TILE_SIZE;
+
+  soa_scratch.resize(5 * n);
+  double *x = soa_scratch.data(), *y = x + n, *z = y + n, *m = z + n, *h = m + n;
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = bodies[i].position.x;
+    y[i] = bodies[i].position.y;
+    z[i] = bodies[i].position.z;
+    m[i] = bodies[i].mass;
+    h[i] = softening_lengths[i];
+  }
+
+  scheduler().parallel_for(0, blocks, 1, [&](size_t first, size_t last) {
+    double ax[FORCE_TILE_SIZE], ay[FORCE_TILE_SIZE], az[FORCE_TILE_SIZE];
+
+    for (size_t block = first; block < last; ++block) {
+      const size_t i_begin = block * FORCE_TILE_SIZE;
+      const size_t count = std::min(n, i_begin + FORCE_TILE_SIZE) - i_begin;
+      const double *__restrict xi = x + i_begin, *__restrict yi = y + i_begin, *__restrict zi = z + i_begin;
+      const double *__restrict hi = h + i_begin;
+      std::fill_n(ax, count, 0.0); std::fill_n(ay, count, 0.0); std::fill_n(az, count, 0.0);
+
+      for (size_t j = 0; j < n; ++j) {
+        const double xj = x[j], yj = y[j], zj = z[j], mj = m[j], hj = h[j];
+        for (size_t k = 0; k < count; ++k) {
+          const double rx = xj - xi[k], ry = yj - yi[k], rz = zj - zi[k];
+          const double distance_sq = rx * rx + ry * ry + rz * rz;
+          const double f = mj * softened_inverse_cube(distance_sq, std::max(hi[k], hj)); // 0 for j == i
+          ax[k] += rx * f;
+          ay[k] += ry * f;
+          az[k] += rz * f;
+        }
+      }
+
+      for (size_t k = 0; k < count; ++k) {
+        bodies[i_begin + k].acceleration += G * glm::dvec3(ax[k], ay[k], az[k]);
+      }
+    }
+  });
+}
+
+// Every body feels the nearest image of every other, plus the Ewald correction for all
+// further images and the neutralizing background, interpolated from the table. The
+// lookup gathers from the table, so the sweep runs per body rather than in vector
+// lanes; each body sums over j in index order, independent of the thread count.
+void Simulation::compute_forces_periodic() {
+  const size_t n = bodies.size();
+  const double box = periodic.box_size;
+  const bool softened = softening.adaptive;
+  const bool corrected = periodic.ewald && ewald.is_built();
+
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const glm::dvec3 p = bodies[i].position;
+      glm::dvec3 acc(0.0);
+      for (size_t j = 0; j < n; ++j) {
+        if (j == i) continue;
+        glm::dvec3 d = bodies[j].position - p;
+        d -= box * glm::round(d / box);
+        const double distance_sq = glm::length2(d);
+        const double inv_cube = softened ? softened_inverse_cube(distance_sq, std::max(softening_lengths[i], softening_lengths[j]))
+                                : distance_sq > 0.0 ? 1.0 / (distance_sq * std::sqrt(distance_sq)) : 0.0;
+        glm::dvec3 pull = d * inv_cube;
+        if (corrected) pull += ewald.correction(d, box);
+        acc += bodies[j].mass * pull;
+      }
+      bodies[i].acceleration += G * acc;
+    }
+  });
+}
+
+void Simulation::set_periodic(const PeriodicConfig &config) {
+  periodic = config;
+  periodic.box_size = std::max(config.box_size, 1e-9);
+  if (!periodic.enabled) return;
+
+  if (variational) set_variational(false);
+  if (periodic.ewald && !ewald.is_built()) ewald.build();
+  wrap_into_box<PrecisionMode::DOUBLE>(bodies, periodic.box_size);
+  octree.invalidate();
+}
+
+// softening support of every body from the distance to its k-th nearest neighbour, so it
+// follows the local density: the kd-tree builds its halves as parallel tasks and the
+// queries run in parallel chunks. Held fixed between refreshes, which keeps the pair
+// forces conservative over most steps.
+void Simulation::refresh_softening() {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = bodies.size();
+
+  force_scratch.resize(n);
+  for (size_t i = 0; i < n; ++i) force_scratch[i] = bodies[i].position;
+  softening_tree.build(force_scratch);
+
+  softening_lengths.resize(n);
+  const unsigned k = std::min(softening.neighbours, static_cast<unsigned>(KD_TREE_MAX_NEIGHBOURS - 1));
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      // the body itself is its own nearest point. with k neighbours or fewer there is no
+      // local density to follow, and reaching the farthest body would soften whole orbits:
+      // those bodies stay unsoftened
+      const double reach = softening_tree.nearest_distance(bodies[i].position, k + 1);
+      softening_lengths[i] = std::isfinite(reach) ? SOFTENING_SCALE * reach : 0.0;
+    }
+  });
+
+  double sum = 0.0, smallest = n > 0 ? INFINITY : 0.0;
+  for (double length : softening_lengths) {
+    sum += length;
+    smallest = std::min(smallest, length);
+  }
+  softening_stats.refreshes++;
+  softening_stats.mean_length = n > 0 ? sum / n : 0.0;
+  softening_stats.min_length = smallest;
+  softening_stats.refresh_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  softening_age = 0;
+  softening_stale = false;
+}
+
+void Simulation::set_softening(const SofteningConfig &config) {
+  softening = config;
+  softening.interval = std::max(1u, config.interval);
+  softening_stale = true;
+  if (variational && !supports_variational()) set_variational(false);
+}
+
+// random unit tangent vector, the indicators restart from zero
+void Simulation::seed_tangent() {
+  const size_t n = bodies.size();
+  std::mt19937_64 rng(tangent_seed);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  tangent.assign(n, TangentVector{});
+  double norm_sq = 0.0;
+  for (auto &t : tangent) {
+    t.position = glm::dvec3(normal(rng), normal(rng), normal(rng));
+    t.velocity = glm::dvec3(normal(rng), normal(rng), normal(rng));
+    norm_sq += glm::length2(t.position) + glm::length2(t.velocity);
+  }
+  const double scale = norm_sq > 0.0 ? 1.0 / std::sqrt(norm_sq) : 0.0;
+  for (auto &t : tangent) {
+    t.position *= scale;
+    t.velocity *= scale;
+  }
+
+  megno_weighted = megno_sum = tangent_log_scale = 0.0;
+  chaos = ChaosIndicators{};
+  tangent_stale = false;
+
+  // the first drift needs the tangent acceleration of the current state
+  if (n > 0) {
+    std::vector<glm::dvec3> saved(n);
+    for (size_t i = 0; i < n; ++i) saved[i] = bodies[i].acceleration;
+    compute_forces_variational();
+    for (size_t i = 0; i < n; ++i) bodies[i].acceleration = saved[i];
+  }
+}
+
+// the tangent map is the linearization of the exact pair sum; the tree, float32 and
+// double-double kernels and softened forces have none, so they exclude each other
+bool Simulation::supports_variational() const {
+  return force_solver == ForceSolver::DIRECT && precision != PrecisionMode::DOUBLE_DOUBLE && !softening.adaptive;
+}
+
+// DIRECT, MIXED_PRECISION and the double-double kernel visit every pair
+bool Simulation::supports_direct() const { return bodies.size() <= DIRECT_MAX_BODIES; }
+
+// a scene or a disruption that outgrows the pair kernels moves to the octree
+void Simulation::limit_direct_kernels() {
+  if (supports_direct()) return;
+  if (precision == PrecisionMode::DOUBLE_DOUBLE) set_precision_mode(PrecisionMode::DOUBLE);
+  set_force_solver(ForceSolver::BARNES_HUT);
+}
+
+bool Simulation::set_variational(bool enabled, uint64_t seed) {
+  if (enabled && !supports_variational()) return false;
+  if (enabled) periodic.enabled = false;
+  variational = enabled;
+  tangent_seed = seed;
+  if (enabled) {
+    seed_tangent();
+  } else {
+    tangent.clear();
+    chaos = ChaosIndicators{};
+  }
+  return true;
+}
+
+void Simulation::tangent_drift(double dt) {
+  const double half_dt_sq = 0.5 * dt * dt;
+  for (auto &t : tangent) {
+    t.position += t.velocity * dt + t.acceleration * half_dt_sq;
+    t.previous_acceleration = t.acceleration;
   }
 }
 
+// closing kick of a step, the MEGNO sample at the step boundary, then optionally the next drift.
+// MEGNO: Y(t) = 2/t int s (d.d')/(d.d) ds with d = (dx, dv), d' = (dv, da), <Y> its running mean
+void Simulation::tangent_step(double dt, bool drift) {
+  const double half_dt = 0.5 * dt;
+  const double half_dt_sq = 0.5 * dt * dt;
+  double norm_sq = 0.0, rate = 0.0;
+
+  for (auto &t : tangent) {
+    t.velocity += (t.previous_acceleration + t.acceleration) * half_dt;
+    norm_sq += glm::length2(t.position) + glm::length2(t.velocity);
+    rate += glm::dot(t.position, t.velocity) + glm::dot(t.velocity, t.acceleration);
+    if (drift) {
+      t.position += t.velocity * dt + t.acceleration * half_dt_sq;
+      t.previous_acceleration = t.acceleration;
+    }
+  }
+  if (norm_sq == 0.0 || dt <= 0.0) return; // a zero step only primes the accelerations
+
+  chaos.time += dt;
+  megno_weighted += 2.0 * dt * chaos.time * rate / norm_sq;
+  chaos.megno = megno_weighted / chaos.time;
+  megno_sum += chaos.megno * dt;
+  chaos.mean_megno = megno_sum / chaos.time;
+  chaos.lyapunov = (tangent_log_scale + 0.5 * std::log(norm_sq)) / chaos.time;
+
+  // the equations are linear, rescaling keeps the vector finite without changing the indicators
+  if (norm_sq > 1e100 || norm_sq < 1e-100) {
+    const double scale = 1.0 / std::sqrt(norm_sq);
+    for (auto &t : tangent) {
+      t.position *= scale;
+      t.velocity *= scale;
+      t.acceleration *= scale;
+      t.previous_acceleration *= scale;
+    }
+    tangent_log_scale += 0.5 * std::log(norm_sq);
+  }
+}
+
+// one force evaluation of the current state with the active solver, without stepping.
+// accelerations are restored afterwards, the new ones are copied out when asked for
+double Simulation::time_force_evaluation(std::vector<glm::dvec3> *accelerations) {
+  using Clock = std::chrono::high_resolution_clock;
+  const size_t n = bodies.size();
+
+  std::vector<glm::dvec3> saved(n);
+  for (size_t i = 0; i < n; ++i) {
+    saved[i] = bodies[i].acceleration;
+    bodies[i].acceleration = glm::dvec3(0.0);
+  }
+
+  auto start = Clock::now();
+  compute_forces();
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  if (accelerations) accelerations->resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (accelerations) (*accelerations)[i] = bodies[i].acceleration;
+    bodies[i].acceleration = saved[i];
+  }
+  return seconds;
+}
+
+ForceErrorReport Simulation::measure_mixed_precision_error() {
+  using Clock = std::chrono::high_resolution_clock;
+  ForceErrorReport report = {0.0, 0.0, 0.0, 0.0};
+  const size_t n = bodies.size();
+  if (n == 0) return report;
+
+  std::vector<glm::dvec3> saved(n), mixed(n);
+  for (size_t i = 0; i < n; ++i) {
+    saved[i] = bodies[i].acceleration;
+    bodies[i].acceleration = glm::dvec3(0.0);
+  }
+
+  auto start = Clock::now();
+  compute_forces_mixed_precision();
+  report.mixed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  for (size_t i = 0; i < n; ++i) {
+    mixed[i] = bodies[i].acceleration;
+    bodies[i].acceleration = glm::dvec3(0.0);
+  }
+
+  start = Clock::now();
+  if (thread_count > 1 && n >= PARALLEL_FORCE_THRESHOLD) {
+    compute_forces_parallel();
+  } else {
+    compute_forces_serial<false>();
+  }
+  report.double_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  size_t counted = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const double reference = glm::length(bodies[i].acceleration);
+    if (reference > 0.0) {
+      const double error = glm::length(mixed[i] - bodies[i].acceleration) / reference;
+      report.max_relative_error = std::max(report.max_relative_error, error);
+      report.rms_relative_error += error * error;
+      ++counted;
+    }
+    bodies[i].acceleration = saved[i];
+  }
+  if (counted > 0) report.rms_relative_error = std::sqrt(report.rms_relative_error / counted);
+
+  return report;
+}
+
+// every enabled external term in one pass over the bodies, see external_forces.hpp
+void Simulation::apply_external_forces() {
+  black_hole_scratch.clear();
+  size_t heaviest = 0;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    if (bodies[i].is_black_hole) black_hole_scratch.push_back(i);
+    if (bodies[i].mass > bodies[heaviest].mass) heaviest = i;
+  }
+
+  const std::function<size_t(BodyHandle)> resolve = [this](BodyHandle handle) { return index_of(handle); };
+  const ForceContext context{bodies, G, C, black_hole_scratch, heaviest, resolve};
+
+  external_forces.apply(context, [&](size_t n, auto &&extra) {
+    if (thread_count > 1 && n >= PARALLEL_FORCE_THRESHOLD) {
+      scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) bodies[i].acceleration += extra(i);
+      });
+    } else {
+      for (size_t i = 0; i < n; ++i) bodies[i].acceleration += extra(i);
+    }
+  });
+}
+
+// satellites are given relative to the planet. the planet body becomes the host: it moves
+// to the barycentre and takes the total mass, the members are stored relative to it
+bool Simulation::add_subsystem(BodyHandle planet, const std::vector<CelestialBody> &satellites, double step,
+                               PrecisionMode precision) {
+  CelestialBody *host = get_body(planet);
+  if (!host || step <= 0.0) return false;
+  for (const auto &subsystem : subsystems) {
+    if (subsystem.host == planet) return false;
+  }
+
+  std::vector<CelestialBody> members;
+  members.push_back(*host);
+  members[0].position = members[0].velocity = members[0].acceleration = glm::dvec3(0.0);
+  members.insert(members.end(), satellites.begin(), satellites.end());
+
+  double mass = 0.0;
+  glm::dvec3 center(0.0), drift(0.0);
+  for (const auto &member : members) {
+    mass += member.mass;
+    center += member.mass * member.position;
+    drift += member.mass * member.velocity;
+  }
+  center /= mass;
+  drift /= mass;
+
+  for (auto &member : members) {
+    member.position -= center;
+    member.velocity -= drift;
+    member.acceleration = member.previous_acceleration = glm::dvec3(0.0);
+    member.position_compensation = member.velocity_compensation = glm::dvec3(0.0);
+  }
+
+  host->position += center;
+  host->velocity += drift;
+  host->mass = mass;
+  subsystems.emplace_back(planet, std::move(members), step, precision);
+  return true;
+}
+
+// The moon starts on a circular orbit about the planet alone, prograde in the plane of the
+// planet's own orbit about the heaviest other body, and is refused past a fraction of the
+// Hill radius there. A planet without a subsystem gets one; otherwise the moon joins the
+// members and the host moves to the new barycentre. Either way the step shrinks to resolve it.
+bool Simulation::add_moon(BodyHandle planet, double mass, double distance) {
+  CelestialBody *host = get_body(planet);
+  if (!host || mass <= 0.0 || distance <= 0.0) return false;
+
+  auto subsystem = std::find_if(subsystems.begin(), subsystems.end(),
+                                [&](const Subsystem &candidate) { return candidate.host == planet; });
+  const double planet_mass = subsystem != subsystems.end() ? subsystem->members[0].mass : host->mass;
+
+  const size_t planet_index = index_of(planet);
+  size_t primary = SIZE_MAX;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    if (i != planet_index && (primary == SIZE_MAX || bodies[i].mass > bodies[primary].mass)) primary = i;
+  }
+  glm::dvec3 normal(0.0, 0.0, 1.0);
+  if (primary != SIZE_MAX) {
+    const glm::dvec3 r = host->position - bodies[primary].position;
+    const double hill = glm::length(r) * std::cbrt(host->mass / (3.0 * bodies[primary].mass));
+    if (distance > MOON_MAX_HILL_FRACTION * hill) return false;
+    const glm::dvec3 h = glm::cross(r, host->velocity - bodies[primary].velocity);
+    if (glm::length2(h) > 0.0) normal = glm::normalize(h);
+  }
+
+  // any direction in the plane will do; later moons are turned by the golden angle so they do not start stacked
+  glm::dvec3 radial = glm::normalize(glm::cross(normal, std::abs(normal.x) < 0.9 ? glm::dvec3(1, 0, 0) : glm::dvec3(0, 1, 0)));
+  const double phase = std::numbers::pi * (3.0 - std::sqrt(5.0)) * (subsystem != subsystems.end() ? subsystem->members.size() - 1 : 0);
+  radial = radial * std::cos(phase) + glm::cross(normal, radial) * std::sin(phase);
+
+  CelestialBody moon = {};
+  moon.mass = mass;
+  moon.radius = 0.25 * host->radius;
+  moon.color = glm::mix(host->color, glm::vec3(0.8f), 0.5f);
+  moon.position = radial * distance;
+  moon.velocity = glm::cross(normal, radial) * std::sqrt(G * (planet_mass + mass) / distance);
+  const double period = 2.0 * std::numbers::pi * std::sqrt(distance * distance * distance / (G * (planet_mass + mass)));
+  const double step = period / MOON_STEPS_PER_ORBIT;
+
+  if (subsystem == subsystems.end()) return add_subsystem(planet, {moon}, step, precision);
+
+  // members are barycentric, the moon is given relative to the planet
+  moon.position += subsystem->members[0].position;
+  moon.velocity += subsystem->members[0].velocity;
+  const double total = host->mass + mass;
+  const glm::dvec3 center = moon.position * (mass / total);
+  const glm::dvec3 drift = moon.velocity * (mass / total);
+  subsystem->members.push_back(moon);
+  for (auto &member : subsystem->members) {
+    member.position -= center;
+    member.velocity -= drift;
+  }
+  if (subsystem->rings) subsystem->rings->shift_frame(center, drift);
+  host->position += center;
+  host->velocity += drift;
+  host->mass = total;
+  subsystem->step = std::min(subsystem->step, step);
+  return true;
+}
+
+// the ring joins the planet's subsystem, which is created on the fly for a planet
+// without one; the subsystem step shrinks to what the innermost particles need
+bool Simulation::add_ring(BodyHandle planet, const RingConfig &config) {
+  const CelestialBody *host = get_body(planet);
+  if (!host || config.particles == 0 || config.inner_radius <= 0.0) return false;
+
+  auto subsystem = std::find_if(subsystems.begin(), subsystems.end(),
+                                [&](const Subsystem &candidate) { return candidate.host == planet; });
+  const double planet_mass = subsystem != subsystems.end() ? subsystem->members[0].mass : host->mass;
+  RingSystem ring(config, planet_mass, G);
+
+  if (subsystem == subsystems.end()) {
+    if (!add_subsystem(planet, {}, ring.get_step(), precision)) return false;
+    subsystem = subsystems.end() - 1;
+  }
+  subsystem->step = std::min(subsystem->step, ring.get_step());
+  subsystem->rings.emplace(std::move(ring));
+  return true;
+}
+
+// one disk at a time, a new one replaces the old
+bool Simulation::add_gas_disk(BodyHandle host, const GasConfig &config) {
+  const CelestialBody *body = get_body(host);
+  if (!body || config.particles == 0 || config.inner_radius <= 0.0) return false;
+  gas.emplace(config, *body, G);
+  gas_host = host;
+  return true;
+}
+
+void Simulation::remove_gas_disk() {
+  gas.reset();
+  gas_host = {};
+}
+
+// gradient of the acceleration from every other body at the host, a_tidal(x) = T x for a
+// member at barycentric offset x
+glm::dmat3 Simulation::tidal_tensor(size_t host) const {
+  glm::dmat3 tensor(0.0);
+  const glm::dvec3 position = bodies[host].position;
+
+  for (size_t j = 0; j < bodies.size(); ++j) {
+    if (j == host) continue;
+    const glm::dvec3 d = position - bodies[j].position;
+    const double distance_sq = glm::length2(d);
+    if (distance_sq < 1e-12) continue;
+
+    const double inv_cube = 1.0 / (distance_sq * std::sqrt(distance_sq));
+    tensor += G * bodies[j].mass * inv_cube * (3.0 / distance_sq * glm::outerProduct(d, d) - glm::dmat3(1.0));
+  }
+  return tensor;
+}
+
 void Simulation::update(double dt) {
-  (this->*current_integrator)(dt);
+  advance(dt, 1);
+}
+
+// runs n_steps back-to-back, bodies marked for removal meanwhile are dropped once at the end
+void Simulation::advance(double dt, int n_steps) {
+  if (reorder_interval > 0 && step_count - last_reorder_step >= static_cast<uint64_t>(reorder_interval)) {
+    reorder_bodies();
+  }
+
+  if (tangent_stale) seed_tangent();
+
+  if (n_steps > 0 && !bodies.empty()) {
+    if (!probes.empty()) attach_probes();
+    tidal_scratch.resize(subsystems.size());
+    for (size_t k = 0; k < subsystems.size(); ++k) {
+      tidal_scratch[k] = tidal_tensor(index_of(subsystems[k].host));
+    }
+
+    if (disruption.enabled) disruption_scratch.assign(bodies.size(), 0);
+    (this->*current_integrator)(dt, n_steps);
+    if (disruption.enabled) {
+      disruption_victims.clear();
+      for (size_t i = 0; i < bodies.size(); ++i) {
+        if (disruption_scratch[i]) disruption_victims.push_back(handle_of(i));
+      }
+    }
+
+    // The subsystems, with their own steps, and the probes follow over the same span. Both
+    // only read the bodies, so they run side by side; the gas disk accretes onto the
+    // bodies and waits for them.
+    const double span = dt * n_steps;
+    TaskGraph phases;
+    const size_t gas_phase = phases.add([this, span] {
+      if (gas) gas->advance(span, bodies, index_of(gas_host), G);
+    });
+    for (size_t k = 0; k < subsystems.size(); ++k) {
+      const size_t phase = phases.add([this, k, span] {
+        subsystems[k].advance(span, tidal_scratch[k], tidal_tensor(index_of(subsystems[k].host)), G);
+      });
+      phases.precede(phase, gas_phase);
+    }
+    if (!probes.empty()) phases.precede(phases.add([this, span] { advance_probes(span); }), gas_phase);
+    phases.run(scheduler());
+    step_count += n_steps;
+    time = dd_add(time, two_prod(dt, static_cast<double>(n_steps)));
+  }
+
+  if (!marked_bodies.empty()) {
+    remove_marked_bodies();
+  }
+  if (disruption.enabled && n_steps > 0) disrupt_bodies();
+  morton_keys.current = false; // the bodies have moved on from the reorder's keys
+}
+
+// sorts the dense body array along the Morton curve so spatial neighbours are memory
+// neighbours for the force kernels and the render upload; handles follow their bodies
+void Simulation::reorder_bodies() {
+  last_reorder_step = step_count;
+  if (bodies.size() < 2) return;
+
+  compute_morton_keys(bodies, morton_keys);
+  sort_morton_keys(morton_keys, morton_scratch);
+  apply_order(morton_keys.entries);
+  morton_keys.current = true; // entries[k] now refers to dense body k, the next tree build takes them as they are
+}
+
+// new dense position k takes the body at order[k].index, afterwards the entries refer to the new order
+void Simulation::apply_order(std::vector<MortonEntry> &order) {
+  const size_t n = bodies.size();
+  reorder_scratch.resize(n);
+  reorder_slots.resize(n);
+
+  std::vector<TangentVector> reordered_tangent(tangent.size() == n ? n : 0);
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      reorder_scratch[k] = bodies[order[k].index];
+      reorder_slots[k] = dense_slots[order[k].index];
+      if (!reordered_tangent.empty()) reordered_tangent[k] = tangent[order[k].index];
+      order[k].index = static_cast<uint32_t>(k);
+    }
+  });
+  if (!reordered_tangent.empty()) tangent.swap(reordered_tangent);
+
+  bodies.swap(reorder_scratch);
+  dense_slots.swap(reorder_slots);
+  for (size_t k = 0; k < n; ++k) {
+    slots[dense_slots[k]].dense = static_cast<uint32_t>(k);
+  }
+  octree.invalidate(); // leaves refer to the old dense indices
+  softening_stale = true;
+  if (gas) gas->bodies_changed();
+}
+
+// deferred removal for bodies that die in the middle of a batch of steps
+void Simulation::mark_for_removal(BodyHandle handle) {
+  if (is_valid(handle)) marked_bodies.push_back(handle);
 }
 
 void Simulation::remove_marked_bodies() {
-  bodies.erase(
-      std::remove_if(bodies.begin(), bodies.end(),
-                     [](const CelestialBody &body) { return body.mass <= 0; }),
-      bodies.end());
+  for (BodyHandle handle : marked_bodies) {
+    remove_body(handle);
+  }
+  marked_bodies.clear();
+}
+
+// whenever the storage could not take one more swarm, room for DISRUPTION_RESERVE_EVENTS
+// is set aside, so events insert their fragments without reallocating mid-tick
+void Simulation::set_disruption(const DisruptionConfig &config) {
+  disruption = config;
+  disruption.fragments = std::clamp(config.fragments, 1u, static_cast<unsigned>(DISRUPTION_MAX_FRAGMENTS));
+  if (!disruption.enabled) return;
+
+  const size_t headroom = static_cast<size_t>(DISRUPTION_RESERVE_EVENTS) * disruption.fragments;
+  if (disruption.test_particles) {
+    if (test_particles.capacity() < test_particles.size() + disruption.fragments) {
+      test_particles.reserve(test_particles.size() + headroom);
+    }
+  } else if (bodies.capacity() < bodies.size() + disruption.fragments) {
+    reserve_bodies(bodies.size() + headroom);
+  }
+}
+
+// A body inside the Roche limit of one of the DISRUPTION_PRIMARIES heaviest bodies, and
+// outweighed by it DISRUPTION_MASS_RATIO times, is marked. The check is O(n), parallel over
+// bodies, and runs at every step boundary of a batch, so an eccentric body that dips inside
+// its limit and out again between two advance() calls is still caught.
+void Simulation::find_roche_victims() {
+  const size_t n = bodies.size();
+  if (n < 2) return;
+
+  std::array<uint32_t, DISRUPTION_PRIMARIES> primaries;
+  const size_t primary_count = heaviest_bodies(bodies, primaries);
+
+  scheduler().parallel_for(0, n, 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const CelestialBody &body = bodies[i];
+      if (disruption_scratch[i]) continue;
+      if (body.mass <= 0.0 || body.density <= 0.0 || body.is_black_hole || slots[dense_slots[i]].fragment) continue;
+      for (size_t k = 0; k < primary_count; ++k) {
+        const CelestialBody &primary = bodies[primaries[k]];
+        if (primaries[k] == i || primary.mass < DISRUPTION_MASS_RATIO * body.mass) continue;
+        const double limit = roche_limit(primary, body, disruption.roche_coefficient);
+        if (glm::length2(primary.position - body.position) < limit * limit) {
+          disruption_scratch[i] = 1;
+          break;
+        }
+      }
+    }
+  });
 }
 
-void Simulation::integrate_velocity_verlet(double dt) {
+// The marked bodies are replaced by fragment swarms after the batch, in dense order, each
+// seeded by the step count and the victim's slot, so the outcome is reproducible. At most
+// the DISRUPTION_RESERVE_EVENTS swarms the storage is kept ready for are made per batch, and
+// none past DISRUPTION_BODY_LIMIT; the other victims wait for a later batch in which they
+// are still inside their limits. A swarm leaves from where its parent is at the end of the
+// batch.
+void Simulation::disrupt_bodies() {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  disruption_stats.deferred = 0;
+  if (disruption_victims.empty()) return;
+
+  unsigned made = 0;
+  for (BodyHandle victim : disruption_victims) {
+    if (!is_valid(victim)) continue; // removed later in the batch
+    const size_t population = disruption.test_particles ? test_particles.size() : bodies.size();
+    if (made == DISRUPTION_RESERVE_EVENTS || population + disruption.fragments > DISRUPTION_BODY_LIMIT) {
+      disruption_stats.deferred++;
+      continue;
+    }
+    made++;
+
+    const CelestialBody parent = *get_body(victim);
+    make_fragments(parent, disruption.fragments, disruption.dispersion, G,
+                   step_count * 0x9E3779B97F4A7C15ull + victim.slot, fragment_scratch);
+    remove_body(victim);
+
+    if (disruption.test_particles) {
+      test_particles.insert(test_particles.end(), fragment_scratch.begin(), fragment_scratch.end());
+    } else {
+      for (size_t i = add_bodies(fragment_scratch); i < bodies.size(); ++i) slots[dense_slots[i]].fragment = true;
+    }
+    disruption_stats.events++;
+    disruption_stats.fragments += fragment_scratch.size();
+  }
+
+  disruption_victims.clear();
+
+  // keep the headroom for the next events
+  set_disruption(disruption);
+  limit_direct_kernels();
+  disruption_stats.last_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Simulation::add_probe(const glm::dvec3 &position, const glm::dvec3 &velocity) {
+  probes.push_back({BodyHandle{}, {}, position, velocity});
+}
+
+// The probes leave from half the body's sphere of influence, or twice its radius if it has
+// none, at periapsis of a hyperbola with the given excess speed. They head prograde along
+// its orbit about its parent, fanned over PROBE_LAUNCH_FAN in the orbital plane.
+void Simulation::launch_probes(BodyHandle from, unsigned count, double excess_speed) {
+  const size_t index = index_of(from);
+  if (index == SIZE_MAX || count == 0) return;
+  select_soi_primaries();
+  build_soi_tree(bodies, soi_primaries, G, 0.0, soi_tree);
+
+  const CelestialBody &body = bodies[index];
+  double offset = 2.0 * body.radius;
+  glm::dvec3 prograde = body.velocity, normal(0.0, 0.0, 1.0);
+  for (const SoiNode &node : soi_tree) {
+    if (node.index != index || node.parent == SIZE_MAX) continue;
+    offset = 0.5 * node.radius;
+    prograde = node.relative.velocity;
+    const glm::dvec3 momentum = glm::cross(node.relative.position, node.relative.velocity);
+    if (glm::length2(momentum) > 0.0) normal = glm::normalize(momentum);
+  }
+  if (!(offset > 0.0)) return;
+  prograde -= normal * glm::dot(prograde, normal);
+  prograde = glm::length2(prograde) > 0.0 ? glm::normalize(prograde) : glm::cross(normal, glm::dvec3(1.0, 0.0, 0.0));
+
+  const double speed = std::sqrt(2.0 * G * body.mass / offset + excess_speed * excess_speed);
+  probes.reserve(probes.size() + count);
+  for (unsigned k = 0; k < count; ++k) {
+    const double angle = count > 1 ? PROBE_LAUNCH_FAN * (static_cast<double>(k) / (count - 1) - 0.5) : 0.0;
+    const glm::dvec3 direction = std::cos(angle) * prograde + std::sin(angle) * glm::cross(normal, prograde);
+    add_probe(body.position + offset * glm::cross(direction, normal), body.velocity + speed * direction);
+  }
+}
+
+void Simulation::clear_probes() {
+  probes.clear();
+  probe_nodes.clear();
+}
+
+void Simulation::select_soi_primaries() {
+  std::array<uint32_t, PROBE_PRIMARIES> heaviest;
+  const size_t count = heaviest_bodies(bodies, heaviest);
+  soi_primaries.clear();
+  for (size_t k = 0; k < count; ++k) {
+    if (!(bodies[heaviest[k]].mass > PROBE_MIN_MASS_RATIO * bodies[heaviest[0]].mass)) break;
+    soi_primaries.push_back(heaviest[k]);
+  }
+}
+
+// Every probe's node in a tree of the state before the span. One whose primary is gone, has
+// dropped out of the PROBE_PRIMARIES heaviest bodies, or that was just added moves into the
+// deepest sphere holding its absolute state.
+void Simulation::attach_probes() {
+  select_soi_primaries();
+  if (soi_primaries.empty()) {
+    soi_tree.clear();
+    return;
+  }
+  build_soi_tree(bodies, soi_primaries, G, 0.0, soi_tree);
+
+  probe_nodes.resize(probes.size());
+  for (size_t i = 0; i < probes.size(); ++i) {
+    Probe &probe = probes[i];
+    const size_t index = index_of(probe.primary);
+    size_t node = 0;
+    while (node < soi_tree.size() && soi_tree[node].index != index) ++node;
+    if (node == soi_tree.size()) {
+      node = soi_containing(soi_tree, bodies, probe.position);
+      const CelestialBody &primary = bodies[soi_tree[node].index];
+      probe.primary = handle_of(soi_tree[node].index);
+      probe.relative = {probe.position - primary.position, probe.velocity - primary.velocity};
+    }
+    probe_nodes[i] = node;
+  }
+}
+
+// Patched conics over the span the bodies were just integrated through: every probe follows
+// a Kepler orbit about its primary, which itself moved under the full N-body forces, so a
+// probe costs one propagation per span away from sphere boundaries. The tree now describes
+// the end of the span; the children's conics are run back from there to find the crossings.
+void Simulation::advance_probes(double span) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  if (soi_tree.empty()) return;
+  build_soi_tree(bodies, soi_primaries, G, span, soi_tree);
+
+  std::atomic<uint64_t> transitions = 0;
+  scheduler().parallel_for(0, probes.size(), 0, [&](size_t begin, size_t end) {
+    uint64_t local = 0;
+    for (size_t i = begin; i < end; ++i) {
+      Probe &probe = probes[i];
+      size_t node = probe_nodes[i];
+      local += propagate_patched_conic(soi_tree, node, probe.relative, span);
+      const CelestialBody &primary = bodies[soi_tree[node].index];
+      probe.primary = handle_of(soi_tree[node].index);
+      probe.position = primary.position + probe.relative.position;
+      probe.velocity = primary.velocity + probe.relative.velocity;
+    }
+    transitions.fetch_add(local, std::memory_order_relaxed);
+  });
+  probe_stats.transitions += transitions.load();
+  probe_stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Newtonian pull of every body on every test particle, in the softened sweep's layout with
+// the particles as lanes. They take no part in softening, periodic images or external forces.
+void Simulation::compute_test_particle_forces() {
+  const size_t n = bodies.size(), count = test_particles.size();
+  if (count == 0) return;
+
+  soa_scratch.resize(4 * n);
+  double *x = soa_scratch.data(), *y = x + n, *z = y + n, *m = z + n;
+  for (size_t j = 0; j < n; ++j) {
+    x[j] = bodies[j].position.x;
+    y[j] = bodies[j].position.y;
+    z[j] = bodies[j].position.z;
+    m[j] = bodies[j].mass;
+  }
+
+  const size_t blocks = (count + FORCE_TILE_SIZE - 1) / FORCE_TILE_SIZE;
+  scheduler().parallel_for(0, blocks, 1, [&](size_t first, size_t last) {
+    double xi[FORCE_TILE_SIZE], yi[FORCE_TILE_SIZE], zi[FORCE_TILE_SIZE];
+    double ax[FORCE_TILE_SIZE], ay[FORCE_TILE_SIZE], az[FORCE_TILE_SIZE];
+
+    for (size_t block = first; block < last; ++block) {
+      const size_t i_begin = block * FORCE_TILE_SIZE;
+      const size_t lanes = std::min(count, i_begin + FORCE_TILE_SIZE) - i_begin;
+      for (size_t k = 0; k < lanes; ++k) {
+        xi[k] = test_particles[i_begin + k].position.x;
+        yi[k] = test_particles[i_begin + k].position.y;
+        zi[k] = test_particles[i_begin + k].position.z;
+      }
+      std::fill_n(ax, lanes, 0.0); std::fill_n(ay, lanes, 0.0); std::fill_n(az, lanes, 0.0);
+
+      for (size_t j = 0; j < n; ++j) {
+        const double xj = x[j], yj = y[j], zj = z[j], mj = m[j];
+        for (size_t k = 0; k < lanes; ++k) {
+          const double rx = xj - xi[k], ry = yj - yi[k], rz = zj - zi[k];
+          const double distance_sq = rx * rx + ry * ry + rz * rz;
+          const double inv_cube = 1.0 / (distance_sq * std::sqrt(distance_sq));
+          const double f = distance_sq > 1e-12 ? mj * inv_cube : 0.0;
+          ax[k] += rx * f;
+          ay[k] += ry * f;
+          az[k] += rz * f;
+        }
+      }
+
+      for (size_t k = 0; k < lanes; ++k) {
+        test_particles[i_begin + k].acceleration += G * glm::dvec3(ax[k], ay[k], az[k]);
+      }
+    }
+  });
+}
+
+// the integrator's kick and drift for the test particles, in parallel chunks
+template <PrecisionMode Mode>
+void Simulation::step_test_particles(double dt, bool kick, bool drift) {
+  if (test_particles.empty()) return;
+  const double half_dt = 0.5 * dt;
+  const double half_dt_sq = 0.5 * dt * dt;
+
+  scheduler().parallel_for(0, test_particles.size(), 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      CelestialBody &particle = test_particles[i];
+      if (kick) {
+        accumulate<Mode>(particle.velocity, particle.velocity_compensation,
+                         (particle.previous_acceleration + particle.acceleration) * half_dt);
+      }
+      if (drift) {
+        accumulate<Mode>(particle.position, particle.position_compensation,
+                         particle.velocity * dt + particle.acceleration * half_dt_sq);
+        particle.previous_acceleration = particle.acceleration;
+        particle.acceleration = glm::dvec3(0.0);
+      }
+    }
+  });
+  if (drift && periodic.enabled) wrap_into_box<Mode>(test_particles, periodic.box_size);
+}
+
+// the position/velocity updates keep their low-order words across steps in the
+// compensated and double-double modes
+template <PrecisionMode Mode>
+void Simulation::integrate_velocity_verlet(double dt, int n_steps) {
+  const double half_dt = 0.5 * dt;
+  const double half_dt_sq = 0.5 * dt * dt;
+
   for (auto &body : bodies) {
-    body.position += body.velocity * dt + 0.5 * body.acceleration * (dt * dt);
+    accumulate<Mode>(body.position, body.position_compensation, body.velocity * dt + body.acceleration * half_dt_sq);
+    body.previous_acceleration = body.acceleration;
+    body.acceleration = glm::dvec3(0.0);
   }
+  if (periodic.enabled) wrap_into_box<Mode>(bodies, periodic.box_size);
+  step_test_particles<Mode>(dt, false, true);
+  if (variational) tangent_drift(dt);
 
-  compute_forces();
-  apply_post_newtonian_corrections();
+  for (int step = 1;; ++step) {
+    compute_forces();
+    apply_external_forces();
+    compute_test_particle_forces();
+    if (disruption.enabled) find_roche_victims(); // positions are at the end of this step
+    if (variational) tangent_step(dt, step != n_steps);
+    if (step == n_steps) break;
+
+    // kick of this step fused with the drift of the next one (single pass over bodies),
+    // the step-boundary state is folded into the rolling hash in between
+    for (auto &body : bodies) {
+      accumulate<Mode>(body.velocity, body.velocity_compensation, (body.previous_acceleration + body.acceleration) * half_dt);
+      if (deterministic) state_hash = hash_body(state_hash, body);
+      accumulate<Mode>(body.position, body.position_compensation, body.velocity * dt + body.acceleration * half_dt_sq);
+      body.previous_acceleration = body.acceleration;
+      body.acceleration = glm::dvec3(0.0);
+    }
+    if (periodic.enabled) wrap_into_box<Mode>(bodies, periodic.box_size);
+    step_test_particles<Mode>(dt, true, true);
+  }
 
   for (auto &body : bodies) {
-    body.velocity += 0.5 * (body.previous_acceleration + body.acceleration) * dt;
+    accumulate<Mode>(body.velocity, body.velocity_compensation, (body.previous_acceleration + body.acceleration) * half_dt);
+    if (deterministic) state_hash = hash_body(state_hash, body);
   }
+  step_test_particles<Mode>(dt, true, false);
+}
+
+void Simulation::reset_clock() {
+  state_hash = STATE_HASH_SEED;
+  step_count = 0;
+  last_reorder_step = 0;
+  time = {0.0, 0.0};
+}
+
+// Generated straight into the dense array. Every slot is free after clear_bodies and
+// already carries a bumped generation, so the first n slots are handed out in order
+// without touching the free list body by body and no old handle can alias a new body.
+void Simulation::reset_to_scene(const SceneConfig &config) {
+  clear_bodies();
+  reset_clock();
+  generate_scene(config, G, bodies);
+
+  const size_t count = bodies.size();
+  if (slots.size() < count) slots.resize(count, {0, 0});
+  dense_slots.resize(count);
+  scheduler().parallel_for(0, count, SCENE_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      slots[i].dense = static_cast<uint32_t>(i);
+      slots[i].fragment = false;
+      dense_slots[i] = static_cast<uint32_t>(i);
+    }
+  });
+  free_slots.clear();
+  for (size_t slot = slots.size(); slot > count; --slot) free_slots.push_back(static_cast<uint32_t>(slot - 1));
+  record_insertions(0);
+  limit_direct_kernels();
 }
 
 void Simulation::reset_to_solar_system() {
   clear_bodies();
+  reset_clock();
 
   // sun
   add_body({
@@ -186,4 +1684,8 @@ void Simulation::reset_to_solar_system() {
       0.05,                        // radius
       glm::vec3(0.0, 0.0, 0.8)     // blue
   });
+
+  // mean densities in g/cm^3, sun to neptune; the drawn radii are far from the true sizes
+  const double densities[] = {1.41, 5.43, 5.24, 5.51, 3.93, 1.33, 0.69, 1.27, 1.64};
+  for (size_t i = 0; i < bodies.size(); ++i) bodies[i].density = densities[i] * GRAM_PER_CM3;
 }
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <glm/gtx/norm.hpp>
+#include "sph.hpp"
+#include "scheduler.hpp"
+
+namespace {
+
+constexpr double KERNEL_NORM = 1.0 / std::numbers::pi; // cubic spline in 3D
+constexpr double SUPPORT = 2.0;                         // kernel support in smoothing lengths
+
+// W(q) = norm / h^3 * (0.25 (2 - q)^3 - (1 - q)^3) with both terms clamped at zero, the usual
+// piecewise spline without the branch
+inline double kernel(double q) {
+  const double a = std::max(0.0, 2.0 - q), b = std::max(0.0, 1.0 - q);
+  return 0.25 * a * a * a - b * b * b;
+}
+
+inline double kernel_slope(double q) {
+  const double a = std::max(0.0, 2.0 - q), b = std::max(0.0, 1.0 - q);
+  return -0.75 * a * a + 3.0 * b * b;
+}
+
+template <typename T> void permute(std::vector<T> &values, const std::vector<uint32_t> &order) {
+  std::vector<T> next(values.size());
+  scheduler().parallel_for(0, values.size(), SPH_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) next[k] = values[order[k]];
+  });
+  values.swap(next);
+}
+
+// neighbour data gathered into contiguous arrays, one set per task
+struct Gather {
+  std::vector<double> dx, dy, dz, dvx, dvy, dvz, h, rho, pressure, sound, out, signal;
+
+  void resize(size_t n) {
+    for (auto *v : {&dx, &dy, &dz, &dvx, &dvy, &dvz, &h, &rho, &pressure, &sound, &out, &signal}) v->resize(n);
+  }
+};
+
+} // namespace
+
+GasDisk::GasDisk(const GasConfig &config, const CelestialBody &host, double G)
+    : config(config), host_mu(G * host.mass), host_position(host.position) {
+  const size_t n = config.particles;
+  const double inner = config.inner_radius;
+  const double outer = std::max(config.outer_radius, config.inner_radius * 1.01);
+  constexpr double pi = std::numbers::pi;
+  particle_mass = config.disk_mass / std::max<size_t>(n, 1);
+  accretion_radius = config.accretion_radius > 0.0 ? config.accretion_radius : 0.5 * inner;
+
+  std::mt19937_64 rng(config.seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  position.resize(n);
+  velocity.resize(n);
+  acceleration.assign(n, glm::dvec3(0.0));
+  h.resize(n);
+  density.assign(n, 0.0);
+  pressure.assign(n, 0.0);
+  sound_speed.assign(n, 0.0);
+
+  // uniform in radius gives sigma ~ 1 / r; vertically Gaussian with scale height aspect * r
+  for (size_t i = 0; i < n; ++i) {
+    const double r = inner + uniform(rng) * (outer - inner);
+    const double phi = 2.0 * pi * uniform(rng);
+    const double scale_height = config.aspect_ratio * r;
+    position[i] = host.position + glm::dvec3(r * std::cos(phi), r * std::sin(phi), scale_height * normal(rng));
+    velocity[i] = host.velocity + std::sqrt(G * host.mass / r) * glm::dvec3(-std::sin(phi), std::cos(phi), 0.0);
+
+    const double sigma = config.disk_mass / (2.0 * pi * (outer - inner) * r);
+    const double rho = sigma / (std::sqrt(2.0 * pi) * scale_height);
+    h[i] = SPH_ETA * std::cbrt(particle_mass / rho);
+  }
+  stats.particles = n;
+}
+
+double GasDisk::get_outer_radius() const                       { return 1.25 * config.outer_radius; }
+const std::vector<glm::dvec3> &GasDisk::get_positions() const  { return position; }
+const GasStats &GasDisk::get_stats() const                     { return stats; }
+
+// Bodies are reordered or removed between calls; interpolating from positions of other
+// bodies would be meaningless, so the pending span starts from where they are now.
+void GasDisk::bodies_changed() {
+  sources_start.clear();
+}
+
+void GasDisk::advance(double span, std::vector<CelestialBody> &bodies, size_t host, double G) {
+  sources_now.resize(bodies.size());
+  for (size_t k = 0; k < bodies.size(); ++k) sources_now[k] = {bodies[k].position, bodies[k].mass};
+  if (host < bodies.size()) {
+    host_mu = G * bodies[host].mass;
+    host_position = bodies[host].position;
+  }
+  if (sources_start.size() != sources_now.size()) {
+    sources_start = sources_now;
+    pending = 0.0;
+  }
+  if (position.empty()) return;
+
+  if (!accelerations_valid) {
+    if (lists_stale(host_position)) build_lists(host_position);
+    compute_density(host_position);
+    compute_forces(sources_now, G);
+    accelerations_valid = true;
+  }
+
+  pending += span;
+  if (pending < stats.step) return;
+
+  std::vector<size_t> sinks;
+  for (size_t k = 0; k < bodies.size(); ++k) {
+    if (k == host || bodies[k].is_black_hole) sinks.push_back(k);
+  }
+
+  // the step shrinks or grows as the gas evolves, so the count is revisited after every substep
+  const glm::dvec3 host_start = host < bodies.size() ? sources_start[host].position : host_position;
+  double elapsed = 0.0;
+  while (elapsed < pending && !position.empty()) {
+    const double remaining = pending - elapsed;
+    const double dt = remaining / std::ceil(remaining / std::max(stats.step, 1e-12 * pending));
+    elapsed = std::min(pending, elapsed + dt);
+
+    const double s = elapsed / pending;
+    sources_step.resize(sources_now.size());
+    for (size_t k = 0; k < sources_now.size(); ++k) {
+      sources_step[k] = {glm::mix(sources_start[k].position, sources_now[k].position, s), sources_now[k].mass};
+    }
+    const glm::dvec3 host_step = host < bodies.size() ? sources_step[host].position : host_start;
+    step(dt, sources_step, host_step, G);
+    accrete(sources_step, sinks, bodies);
+  }
+
+  pending = 0.0;
+  sources_start = sources_now;
+}
+
+// kick-drift-kick with the acceleration from the previous step; the smoothing length
+// follows the density at the end of the step, limited so it never jumps
+void GasDisk::step(double dt, const std::vector<Source> &sources, const glm::dvec3 &host, double G) {
+  const size_t n = position.size();
+  scheduler().parallel_for(0, n, SPH_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      velocity[i] += acceleration[i] * (0.5 * dt);
+      position[i] += velocity[i] * dt;
+    }
+  });
+
+  list_age += dt;
+  if (lists_stale(host)) {
+    build_lists(host);
+  } else {
+    ++stats.steps_since_build;
+  }
+  compute_density(host);
+  compute_forces(sources, G);
+
+  scheduler().parallel_for(0, n, SPH_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      velocity[i] += acceleration[i] * (0.5 * dt);
+      const double target = SPH_ETA * std::cbrt(particle_mass / density[i]);
+      h[i] = std::clamp(target, 0.8 * h[i], 1.25 * h[i]);
+    }
+  });
+  ++stats.steps;
+}
+
+// A list stays valid while no particle strayed more than half its skin and no smoothing
+// length grew past half of it: every pair inside either kernel support was within the
+// skinned support of the larger one when the list was built. Strays are measured from
+// the particle's built position carried along its circular orbit. The shear closes the
+// gap between two particles a skinned support L apart by at most 0.75 omega t L, and
+// each of them pays half of that out of its skin too.
+bool GasDisk::lists_stale(const glm::dvec3 &host) {
+  const size_t n = position.size();
+  if (built_position.size() != n) return true;
+
+  const size_t chunks = (n + SPH_CHUNK - 1) / SPH_CHUNK;
+  chunk_flags.assign(chunks, 0);
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      const size_t end = std::min(n, (c + 1) * SPH_CHUNK);
+      uint8_t stale = 0;
+      for (size_t i = c * SPH_CHUNK; i < end; ++i) {
+        const double angle = built_omega[i] * list_age;
+        const double cos_a = std::cos(angle), sin_a = std::sin(angle);
+        const glm::dvec3 r = built_position[i] - built_host;
+        const glm::dvec3 expected = host + glm::dvec3(cos_a * r.x - sin_a * r.y, sin_a * r.x + cos_a * r.y, r.z);
+        const double shear = 0.375 * SUPPORT * (1.0 + SPH_SKIN) * angle * built_h[i];
+        const double limit = 0.5 * SPH_SKIN * built_h[i] - shear;
+        stale |= limit < 0.0 || glm::length2(position[i] - expected) > limit * limit;
+        stale |= h[i] > built_h[i] * (1.0 + 0.5 * SPH_SKIN);
+      }
+      chunk_flags[c] = stale;
+    }
+  });
+  return std::any_of(chunk_flags.begin(), chunk_flags.end(), [](uint8_t flag) { return flag != 0; });
+}
+
+// the particles move into tree order first, so slot k of the tree is particle k and the
+// lists of nearby particles point at nearby memory
+void GasDisk::build_lists(const glm::dvec3 &host) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = position.size();
+
+  reach_scratch.resize(n);
+  for (size_t i = 0; i < n; ++i) reach_scratch[i] = SUPPORT * (1.0 + SPH_SKIN) * h[i];
+  tree.build(position, reach_scratch);
+
+  const std::vector<uint32_t> &order = tree.get_order();
+  permute(position, order);
+  permute(velocity, order);
+  permute(acceleration, order);
+  permute(h, order);
+  permute(density, order);
+  permute(pressure, order);
+  permute(sound_speed, order);
+
+  const size_t chunks = (n + SPH_CHUNK - 1) / SPH_CHUNK;
+  chunk_lists.resize(chunks);
+  list_start.assign(n + 1, 0);
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      std::vector<uint32_t> &out = chunk_lists[c];
+      out.clear();
+      const size_t end = std::min(n, (c + 1) * SPH_CHUNK);
+      for (size_t i = c * SPH_CHUNK; i < end; ++i) {
+        const size_t before = out.size();
+        tree.for_each_within(position[i], SUPPORT * (1.0 + SPH_SKIN) * h[i], [&](uint32_t slot, double) {
+          if (slot != i) out.push_back(slot);
+        });
+        list_start[i + 1] = static_cast<uint32_t>(out.size() - before);
+      }
+    }
+  });
+  for (size_t i = 0; i < n; ++i) list_start[i + 1] += list_start[i];
+
+  list.resize(list_start[n]);
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      std::copy(chunk_lists[c].begin(), chunk_lists[c].end(), list.begin() + list_start[c * SPH_CHUNK]);
+    }
+  });
+
+  built_position = position;
+  built_h = h;
+  built_host = host;
+  built_omega.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    const glm::dvec3 r = position[i] - host;
+    const double radius = std::max(std::sqrt(r.x * r.x + r.y * r.y), accretion_radius);
+    built_omega[i] = std::sqrt(host_mu / (radius * radius * radius));
+  }
+  list_age = 0.0;
+  ++stats.list_builds;
+  stats.steps_since_build = 0;
+  stats.mean_neighbours = n > 0 ? static_cast<double>(list.size()) / n : 0.0;
+  stats.list_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// rho_i = sum_j m W(|x_i - x_j|, h_i), self term included; locally isothermal pressure
+// with the sound speed of the Keplerian speed around the host times the aspect ratio
+void GasDisk::compute_density(const glm::dvec3 &host) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = position.size();
+
+  scheduler().parallel_for(0, n, SPH_CHUNK, [&](size_t begin, size_t end) {
+    Gather gather;
+    for (size_t i = begin; i < end; ++i) {
+      const uint32_t first = list_start[i], count = list_start[i + 1] - first;
+      gather.resize(count);
+      const double inv_h = 1.0 / h[i];
+      for (uint32_t k = 0; k < count; ++k) {
+        gather.dx[k] = glm::length(position[i] - position[list[first + k]]) * inv_h;
+      }
+      for (uint32_t k = 0; k < count; ++k) gather.out[k] = kernel(gather.dx[k]);
+
+      double sum = kernel(0.0);
+      for (uint32_t k = 0; k < count; ++k) sum += gather.out[k];
+      density[i] = particle_mass * KERNEL_NORM * inv_h * inv_h * inv_h * sum;
+
+      const double r = std::max(glm::length(position[i] - host), accretion_radius);
+      sound_speed[i] = config.aspect_ratio * std::sqrt(host_mu / r);
+      pressure[i] = sound_speed[i] * sound_speed[i] * density[i];
+    }
+  });
+  stats.density_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// symmetric pressure gradient and Monaghan viscosity with the mean smoothing length of
+// each pair, plus the gravity of every body softened by the particle's own smoothing
+// length; the next step is the smallest Courant and acceleration limit of any particle
+void GasDisk::compute_forces(const std::vector<Source> &sources, double G) {
+  using Clock = std::chrono::high_resolution_clock;
+  const auto start = Clock::now();
+  const size_t n = position.size();
+  const size_t chunks = (n + SPH_CHUNK - 1) / SPH_CHUNK;
+  chunk_step.assign(chunks, INFINITY);
+
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    Gather gather;
+    for (size_t c = first; c < last; ++c) {
+      const size_t end = std::min(n, (c + 1) * SPH_CHUNK);
+      double chunk_min = INFINITY;
+      for (size_t i = c * SPH_CHUNK; i < end; ++i) {
+        const uint32_t begin = list_start[i], count = list_start[i + 1] - begin;
+        gather.resize(count);
+        for (uint32_t k = 0; k < count; ++k) {
+          const uint32_t j = list[begin + k];
+          const glm::dvec3 d = position[i] - position[j], dv = velocity[i] - velocity[j];
+          gather.dx[k] = d.x, gather.dy[k] = d.y, gather.dz[k] = d.z;
+          gather.dvx[k] = dv.x, gather.dvy[k] = dv.y, gather.dvz[k] = dv.z;
+          gather.h[k] = h[j];
+          gather.rho[k] = density[j];
+          gather.pressure[k] = pressure[j];
+          gather.sound[k] = sound_speed[j];
+        }
+
+        const double h_i = h[i], rho_i = density[i], c_i = sound_speed[i];
+        const double term_i = pressure[i] / (rho_i * rho_i);
+        for (uint32_t k = 0; k < count; ++k) {
+          const double r_sq = gather.dx[k] * gather.dx[k] + gather.dy[k] * gather.dy[k] + gather.dz[k] * gather.dz[k];
+          const double r = std::sqrt(r_sq);
+          const double h_mean = 0.5 * (h_i + gather.h[k]);
+          const double inv_h = 1.0 / h_mean;
+          const double approach = gather.dx[k] * gather.dvx[k] + gather.dy[k] * gather.dvy[k] + gather.dz[k] * gather.dvz[k];
+          const double mu = std::min(0.0, h_mean * approach / (r_sq + 0.01 * h_mean * h_mean));
+          const double c_mean = 0.5 * (c_i + gather.sound[k]);
+          const double rho_mean = 0.5 * (rho_i + gather.rho[k]);
+          const double viscosity = (-SPH_ALPHA * c_mean * mu + SPH_BETA * mu * mu) / rho_mean;
+          const double slope = KERNEL_NORM * inv_h * inv_h * inv_h * inv_h * kernel_slope(r * inv_h);
+          const double pair = term_i + gather.pressure[k] / (gather.rho[k] * gather.rho[k]) + viscosity;
+          gather.out[k] = -particle_mass * pair * slope / std::max(r, 1e-300);
+          gather.signal[k] = c_mean + 1.2 * (SPH_ALPHA * c_mean - SPH_BETA * mu);
+        }
+
+        glm::dvec3 a(0.0);
+        double signal = c_i;
+        for (uint32_t k = 0; k < count; ++k) {
+          a += gather.out[k] * glm::dvec3(gather.dx[k], gather.dy[k], gather.dz[k]);
+          signal = std::max(signal, gather.signal[k]);
+        }
+
+        const double softening_sq = h_i * h_i;
+        for (const auto &source : sources) {
+          const glm::dvec3 r = source.position - position[i];
+          const double distance_sq = glm::length2(r) + softening_sq;
+          a += r * (G * source.mass / (distance_sq * std::sqrt(distance_sq)));
+        }
+        acceleration[i] = a;
+
+        const double courant = h_i / signal;
+        const double free_fall = std::sqrt(h_i / std::max(glm::length(a), 1e-300));
+        chunk_min = std::min(chunk_min, SPH_COURANT * std::min(courant, free_fall));
+      }
+      chunk_step[c] = chunk_min;
+    }
+  });
+
+  stats.step = *std::min_element(chunk_step.begin(), chunk_step.end());
+  stats.force_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// particles inside the accretion radius of a sink hand it their mass and momentum; the
+// nearest sink wins, and sinks are visited in body order so the result is reproducible
+void GasDisk::accrete(const std::vector<Source> &sources, const std::vector<size_t> &sinks,
+                      std::vector<CelestialBody> &bodies) {
+  const size_t n = position.size();
+  if (sinks.empty()) return;
+
+  const double radius_sq = accretion_radius * accretion_radius;
+  absorbed_by.assign(n, 0);
+  const size_t chunks = (n + SPH_CHUNK - 1) / SPH_CHUNK;
+  chunk_flags.assign(chunks, 0);
+  scheduler().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      const size_t end = std::min(n, (c + 1) * SPH_CHUNK);
+      for (size_t i = c * SPH_CHUNK; i < end; ++i) {
+        double nearest = radius_sq;
+        for (size_t s = 0; s < sinks.size(); ++s) {
+          const double distance_sq = glm::length2(position[i] - sources[sinks[s]].position);
+          if (distance_sq < nearest) {
+            nearest = distance_sq;
+            absorbed_by[i] = static_cast<uint32_t>(s + 1);
+          }
+        }
+        chunk_flags[c] |= absorbed_by[i] != 0;
+      }
+    }
+  });
+  if (std::none_of(chunk_flags.begin(), chunk_flags.end(), [](uint8_t flag) { return flag != 0; })) return;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (absorbed_by[i] != 0) {
+      CelestialBody &sink = bodies[sinks[absorbed_by[i] - 1]];
+      const double mass = sink.mass + particle_mass;
+      sink.velocity = (sink.mass * sink.velocity + particle_mass * velocity[i]) / mass;
+      sink.mass = mass;
+      stats.accreted_mass += particle_mass;
+      continue;
+    }
+    position[kept] = position[i];
+    velocity[kept] = velocity[i];
+    acceleration[kept] = acceleration[i];
+    h[kept] = h[i];
+    density[kept] = density[i];
+    pressure[kept] = pressure[i];
+    sound_speed[kept] = sound_speed[i];
+    ++kept;
+  }
+  for (auto *values : {&position, &velocity, &acceleration}) values->resize(kept);
+  for (auto *values : {&h, &density, &pressure, &sound_speed}) values->resize(kept);
+  built_position.clear(); // indices shifted, the lists are rebuilt on the next step
+  stats.particles = kept;
+}
+
+// column density in the xy plane around center: counts per polar bin divided by the bin
+// area, which grows with the ring index
+void GasDisk::surface_density(const glm::dvec3 &center, std::vector<float> &map) const {
+  map.assign(SPH_MAP_RADIAL * SPH_MAP_ANGULAR, 0.0f);
+  const double outer = get_outer_radius();
+  for (const auto &p : position) {
+    const glm::dvec2 d = glm::dvec2(p - center);
+    const double r = glm::length(d) / outer;
+    if (r >= 1.0) continue;
+    const int radial = static_cast<int>(r * SPH_MAP_RADIAL);
+    const double angle = std::atan2(d.y, d.x) / (2.0 * std::numbers::pi) + 0.5;
+    const int angular = std::min(static_cast<int>(angle * SPH_MAP_ANGULAR), SPH_MAP_ANGULAR - 1);
+    map[radial * SPH_MAP_ANGULAR + angular] += 1.0f / (2 * radial + 1);
+  }
+  const float peak = *std::max_element(map.begin(), map.end());
+  if (peak > 0.0f) {
+    for (float &value : map) value /= peak;
+  }
+}
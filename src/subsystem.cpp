@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/gtx/norm.hpp>
+#include "simulation.hpp"
+#include "summation.hpp"
+
+Subsystem::Subsystem(BodyHandle host, std::vector<CelestialBody> members, double step, PrecisionMode precision)
+    : host(host), members(std::move(members)), step(step), precision(precision) {}
+
+void Subsystem::compute_forces(const glm::dmat3 &tidal, double G) {
+  for (auto &member : members) {
+    member.acceleration = tidal * member.position;
+  }
+
+  for (size_t i = 0; i < members.size(); ++i) {
+    for (size_t j = i + 1; j < members.size(); ++j) {
+      glm::dvec3 r = members[j].position - members[i].position;
+      double distance_sq = glm::length2(r);
+      if (distance_sq < 1e-24) continue; // local distances are tiny, keep the guard relative to them
+
+      glm::dvec3 scaled = r * (G / (distance_sq * std::sqrt(distance_sq)));
+      members[i].acceleration += scaled * members[j].mass;
+      members[j].acceleration -= scaled * members[i].mass;
+    }
+  }
+}
+
+// kick-drift-kick velocity verlet with the tidal field sampled at every substep
+void Subsystem::advance(double span, const glm::dmat3 &tidal_start, const glm::dmat3 &tidal_end, double G) {
+  if (span <= 0.0 || members.empty()) return;
+
+  const int substeps = std::max(1, static_cast<int>(std::ceil(span / step)));
+  const double dt = span / substeps;
+  const double half_dt = 0.5 * dt;
+  const bool compensated = precision != PrecisionMode::DOUBLE;
+
+  auto add = [&](glm::dvec3 &value, glm::dvec3 &compensation, const glm::dvec3 &delta) {
+    if (compensated) {
+      compensated_add(value, compensation, delta);
+    } else {
+      value += delta;
+    }
+  };
+
+  compute_forces(tidal_start, G);
+  if (rings) rings->accelerate(members, tidal_start, G);
+  for (int k = 1; k <= substeps; ++k) {
+    for (auto &member : members) {
+      add(member.velocity, member.velocity_compensation, member.acceleration * half_dt);
+      add(member.position, member.position_compensation, member.velocity * dt);
+    }
+    if (rings) rings->drift(dt);
+
+    const double t = static_cast<double>(k) / substeps;
+    const glm::dmat3 tidal = tidal_start * (1.0 - t) + tidal_end * t;
+    compute_forces(tidal, G);
+
+    for (auto &member : members) {
+      add(member.velocity, member.velocity_compensation, member.acceleration * half_dt);
+    }
+    if (rings) {
+      rings->accelerate(members, tidal, G);
+      rings->kick(dt);
+      rings->collide();
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#include <cstring>
+#include "check.hpp"
+#include "simulation.hpp"
+
+// deterministic mode promises the same bits for any thread count; 1000 bodies are 16 force
+// tiles, so four threads really do split the tiles differently from one
+static void thread_count_leaves_bits_unchanged(PrecisionMode precision) {
+  Simulation one, four;
+  for (Simulation *simulation : {&one, &four}) {
+    simulation->reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 1000, .seed = 13});
+    simulation->set_deterministic(true);
+    simulation->set_precision_mode(precision);
+  }
+  one.set_thread_count(1);
+  four.set_thread_count(4);
+  CHECK(one.bodies.size() >= PARALLEL_FORCE_THRESHOLD);
+
+  for (int batch = 0; batch < 5; ++batch) {
+    one.advance(0.01, 4);
+    four.advance(0.01, 4);
+  }
+
+  CHECK(one.get_state_hash() == four.get_state_hash());
+  CHECK(one.bodies.size() == four.bodies.size());
+  bool identical = true;
+  for (size_t i = 0; i < one.bodies.size(); ++i) {
+    identical &= std::memcmp(&one.bodies[i].position, &four.bodies[i].position, sizeof(glm::dvec3)) == 0;
+    identical &= std::memcmp(&one.bodies[i].velocity, &four.bodies[i].velocity, sizeof(glm::dvec3)) == 0;
+  }
+  CHECK(identical);
+}
+
+int main() {
+  thread_count_leaves_bits_unchanged(PrecisionMode::DOUBLE);
+  thread_count_leaves_bits_unchanged(PrecisionMode::COMPENSATED);
+  return check_failures;
+}
@@ -0,0 +1,146 @@
+#include <cmath>
+#include "check.hpp"
+#include "simulation.hpp"
+
+static CelestialBody body_at(const glm::dvec3 &position, const glm::dvec3 &velocity, double mass, double radius) {
+  CelestialBody body = {};
+  body.position = position;
+  body.velocity = velocity;
+  body.mass = mass;
+  body.radius = radius;
+  body.color = glm::vec3(0.5f);
+  return body;
+}
+
+// small bodies summed apart from the heavy ones, so their mass is not lost in the rounding of the sun's
+static void totals(const Simulation &simulation, double &small_mass, glm::dvec3 &momentum) {
+  small_mass = 0.0;
+  momentum = glm::dvec3(0.0);
+  for (const auto &body : simulation.bodies) {
+    if (body.mass < 1e-6) small_mass += body.mass;
+    momentum += body.mass * body.velocity;
+  }
+  for (const auto &body : simulation.get_test_particles()) small_mass += body.mass;
+}
+
+// the limit follows the physical size: the sun's is a few hundredths of an AU for rock,
+// whatever radius the bodies are drawn with
+static void limit_ignores_drawn_radius() {
+  CelestialBody sun = body_at(glm::dvec3(0.0), glm::dvec3(0.0), 1.0, 0.2);
+  CelestialBody rock = body_at(glm::dvec3(0.0), glm::dvec3(0.0), 1e-12, 0.005);
+  const double limit = roche_limit(sun, rock, ROCHE_COEFFICIENT);
+  CHECK(limit > 0.008 && limit < 0.01);
+  rock.radius = 1.0;
+  CHECK(roche_limit(sun, rock, ROCHE_COEFFICIENT) == limit);
+  sun.density = 1.41 * GRAM_PER_CM3; // R_p (rho_p / rho_s)^(1/3) with the sun's true radius
+  CHECK(std::abs(limit - ROCHE_COEFFICIENT * physical_radius(sun) * std::cbrt(sun.density / rock.density)) < 1e-15);
+  CHECK(std::abs(physical_radius(sun) - 0.00465) < 0.0001);
+}
+
+// neither the planets nor a whole asteroid belt come near a Roche limit
+static void default_scenes_stay_whole() {
+  Simulation solar;
+  solar.reset_to_solar_system();
+  solar.set_disruption({.enabled = true});
+  solar.advance(0.0, 1);
+  for (int k = 0; k < 100; ++k) solar.advance(1.0, 1);
+  CHECK(solar.get_disruption_stats().events == 0);
+  CHECK(solar.bodies.size() == 9);
+
+  Simulation belt;
+  belt.reset_to_scene({.preset = ScenePreset::ASTEROID_BELT, .bodies = 2000, .seed = 2});
+  belt.set_disruption({.enabled = true});
+  belt.advance(0.0, 1);
+  for (int k = 0; k < 10; ++k) belt.advance(1.0, 1);
+  CHECK(belt.get_disruption_stats().events == 0);
+  CHECK(belt.bodies.size() == 2000);
+}
+
+// a rock falling past the sun inside its Roche limit becomes one swarm carrying its mass and momentum
+static void close_pass_makes_one_swarm() {
+  for (bool test_particles : {false, true}) {
+    Simulation simulation;
+    simulation.clear_bodies();
+    const double mu = simulation.getG();
+    const double r = 0.1, q = 0.004; // pericentre inside the 0.009 AU limit
+    const double v = std::sqrt(2.0 * mu / r), tangential = std::sqrt(2.0 * mu * q) / r;
+    simulation.add_body(body_at(glm::dvec3(0.0), glm::dvec3(0.0), 1.0, 0.2));
+    simulation.add_body(body_at(glm::dvec3(r, 0.0, 0.0), glm::dvec3(-std::sqrt(v * v - tangential * tangential), tangential, 0.0),
+                                1e-10, 0.01));
+    simulation.add_body(body_at(glm::dvec3(5.2, 0.0, 0.0), glm::dvec3(0.0, std::sqrt(mu / 5.2), 0.0), 9.5e-4, 0.1));
+    simulation.set_disruption({.enabled = true, .fragments = 500, .test_particles = test_particles});
+
+    double mass0, mass1;
+    glm::dvec3 momentum0, momentum1;
+    totals(simulation, mass0, momentum0);
+    simulation.advance(0.0, 1);
+    for (int k = 0; k < 1500; ++k) simulation.advance(0.001, 1);
+    totals(simulation, mass1, momentum1);
+
+    const DisruptionStats &stats = simulation.get_disruption_stats();
+    CHECK(stats.events == 1);
+    CHECK(stats.fragments == 500);
+    CHECK(simulation.bodies.size() == (test_particles ? 2u : 502u));
+    CHECK(simulation.get_test_particles().size() == (test_particles ? 500u : 0u));
+    CHECK(std::abs(mass1 - mass0) < 1e-22);
+    // test particles pull on nothing, so only massive fragments keep the momentum of the system
+    if (!test_particles) CHECK(glm::length(momentum1 - momentum0) < 1e-14 * glm::length(momentum0));
+  }
+}
+
+// many victims at once are taken DISRUPTION_RESERVE_EVENTS per check, swarms stay bounded
+static void events_are_capped_per_check() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  simulation.add_body(body_at(glm::dvec3(0.0), glm::dvec3(0.0), 1.0, 0.2));
+  for (int k = 0; k < 10; ++k) {
+    const double angle = 0.6 * k;
+    simulation.add_body(body_at(0.005 * glm::dvec3(std::cos(angle), std::sin(angle), 0.0), glm::dvec3(0.0), 1e-12, 0.001));
+  }
+  simulation.set_disruption({.enabled = true, .fragments = 4000000000u});
+  CHECK(simulation.get_disruption().fragments == DISRUPTION_MAX_FRAGMENTS);
+  simulation.set_disruption({.enabled = true, .fragments = 100});
+
+  simulation.advance(1e-6, 1);
+  CHECK(simulation.get_disruption_stats().events == DISRUPTION_RESERVE_EVENTS);
+  CHECK(simulation.get_disruption_stats().deferred == 10 - DISRUPTION_RESERVE_EVENTS);
+  simulation.advance(1e-6, 1);
+  simulation.advance(1e-6, 1);
+  CHECK(simulation.get_disruption_stats().events == 10);
+  CHECK(simulation.get_disruption_stats().deferred == 0);
+  CHECK(simulation.bodies.size() == 1 + 10 * 100u);
+}
+
+// a single time-warp batch carries the rock in past the limit and out again; the check at
+// every step boundary still catches it although it ends the batch far outside
+static void pass_within_one_batch_is_caught() {
+  Simulation whole, disrupted;
+  for (Simulation *simulation : {&whole, &disrupted}) {
+    simulation->clear_bodies();
+    const double mu = simulation->getG();
+    const double r = 0.1, q = 0.004;
+    const double v = std::sqrt(2.0 * mu / r), tangential = std::sqrt(2.0 * mu * q) / r;
+    simulation->add_body(body_at(glm::dvec3(0.0), glm::dvec3(0.0), 1.0, 0.2));
+    simulation->add_body(body_at(glm::dvec3(r, 0.0, 0.0),
+                                 glm::dvec3(-std::sqrt(v * v - tangential * tangential), tangential, 0.0), 1e-10, 0.01));
+  }
+  disrupted.set_disruption({.enabled = true, .fragments = 100});
+  for (Simulation *simulation : {&whole, &disrupted}) {
+    simulation->advance(0.0, 1);
+    simulation->advance(0.001, 1500);
+  }
+
+  const double limit = roche_limit(whole.bodies[0], whole.bodies[1], ROCHE_COEFFICIENT);
+  CHECK(glm::length(whole.bodies[1].position - whole.bodies[0].position) > 2.0 * limit);
+  CHECK(disrupted.get_disruption_stats().events == 1);
+  CHECK(disrupted.bodies.size() == 101u);
+}
+
+int main() {
+  limit_ignores_drawn_radius();
+  default_scenes_stay_whole();
+  close_pass_makes_one_swarm();
+  pass_within_one_batch_is_caught();
+  events_are_capped_per_check();
+  return check_failures;
+}
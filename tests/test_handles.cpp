@@ -0,0 +1,61 @@
+#include "check.hpp"
+#include "simulation.hpp"
+
+static CelestialBody body_at(double x, double mass) {
+  CelestialBody body = {};
+  body.position = glm::dvec3(x, 0.0, 0.0);
+  body.mass = mass;
+  body.radius = 0.01;
+  return body;
+}
+
+// swap-and-pop moves the last dense body into the hole; removing the newest must still
+// take the body added last, not whatever sits at the end of the dense array
+static void newest_survives_swap_and_pop() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  const BodyHandle a = simulation.add_body(body_at(1.0, 1e-6));
+  const BodyHandle b = simulation.add_body(body_at(2.0, 1e-6));
+  const BodyHandle c = simulation.add_body(body_at(3.0, 1e-6));
+  simulation.remove_body(a); // c moves to dense index 0, b is now last
+
+  simulation.remove_newest_body();
+  CHECK(!simulation.is_valid(c));
+  CHECK(simulation.is_valid(b));
+
+  simulation.remove_newest_body(); // skips the removed a and c
+  CHECK(!simulation.is_valid(b));
+  CHECK(simulation.bodies.empty());
+  simulation.remove_newest_body(); // nothing left, no-op
+}
+
+static void newest_survives_reorder() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  std::vector<BodyHandle> handles;
+  for (int k = 0; k < 64; ++k) handles.push_back(simulation.add_body(body_at(64.0 - k, 1e-6)));
+  simulation.reorder_bodies();
+  CHECK(simulation.index_of(handles.back()) != simulation.bodies.size() - 1); // the curve reversed the order
+
+  for (int k = 63; k >= 60; --k) {
+    simulation.remove_newest_body();
+    CHECK(!simulation.is_valid(handles[k]));
+    CHECK(simulation.is_valid(handles[k - 1]));
+  }
+}
+
+static void history_stays_bounded() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  const BodyHandle keep = simulation.add_body(body_at(1.0, 1e-6));
+  for (int k = 0; k < 10000; ++k) simulation.remove_body(simulation.add_body(body_at(2.0, 1e-6)));
+  simulation.remove_newest_body();
+  CHECK(!simulation.is_valid(keep));
+}
+
+int main() {
+  newest_survives_swap_and_pop();
+  newest_survives_reorder();
+  history_stays_bounded();
+  return check_failures;
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "check.hpp"
+#include "simulation.hpp"
+
+static double worst_relative(const std::vector<glm::dvec3> &a, const std::vector<glm::dvec3> &b) {
+  double worst = 0.0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    worst = std::max(worst, glm::length(a[i] - b[i]) / std::max(glm::length(b[i]), 1e-300));
+  }
+  return worst;
+}
+
+// A reorder leaves its sorted keys for the next rebuild. That tree must give the same
+// forces as one built from freshly computed keys, and both must stay within the opening
+// angle's error of direct summation.
+static void reorder_keys_build_the_same_tree() {
+  Simulation simulation;
+  simulation.reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 3000, .seed = 3});
+
+  simulation.set_force_solver(ForceSolver::DIRECT);
+  simulation.reorder_bodies();
+  std::vector<glm::dvec3> direct;
+  simulation.time_force_evaluation(&direct);
+
+  simulation.set_force_solver(ForceSolver::BARNES_HUT);
+  simulation.reorder_bodies(); // no bodies moved, the order and keys are the same as above
+  std::vector<glm::dvec3> shared;
+  simulation.time_force_evaluation(&shared);
+  CHECK(simulation.get_tree_stats().rebuilds == 1);
+
+  simulation.set_solver_config({ForceSolver::BARNES_HUT, 1, MIXED_TILE_SIZE, OCTREE_LEAF_SIZE + 1}); // forces a rebuild
+  simulation.set_solver_config({ForceSolver::BARNES_HUT, 1, MIXED_TILE_SIZE, OCTREE_LEAF_SIZE});
+  std::vector<glm::dvec3> fresh;
+  simulation.time_force_evaluation(&fresh);
+  CHECK(simulation.get_tree_stats().rebuilds == 2);
+
+  CHECK(worst_relative(shared, fresh) == 0.0);
+  CHECK(worst_relative(shared, direct) < 0.05);
+}
+
+// reordering every step with the tree solver: stepping stays close to the unreordered run
+static void reorder_every_step_tracks_plain_run() {
+  Simulation plain, reordered;
+  for (Simulation *simulation : {&plain, &reordered}) {
+    simulation->reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 1000, .seed = 5});
+    simulation->set_force_solver(ForceSolver::BARNES_HUT);
+  }
+  reordered.set_reorder_interval(1);
+  std::vector<BodyHandle> handles;
+  for (size_t i = 0; i < plain.bodies.size(); ++i) handles.push_back(plain.handle_of(i));
+  for (int step = 0; step < 10; ++step) {
+    plain.advance(0.01, 1);
+    reordered.advance(0.01, 1);
+  }
+  double worst = 0.0, scale = 0.0;
+  for (BodyHandle handle : handles) {
+    const CelestialBody *a = plain.get_body(handle), *b = reordered.get_body(handle);
+    worst = std::max(worst, glm::length(a->position - b->position));
+    scale = std::max(scale, glm::length(a->position));
+  }
+  CHECK(worst < 1e-6 * scale);
+}
+
+// a scene past DIRECT_MAX_BODIES loads onto the tree and the pair kernels are refused
+static void large_scenes_leave_the_pair_kernels() {
+  Simulation simulation;
+  simulation.set_precision_mode(PrecisionMode::DOUBLE_DOUBLE);
+  simulation.reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = DIRECT_MAX_BODIES + 1, .seed = 9});
+  CHECK(!simulation.supports_direct());
+  CHECK(simulation.get_force_solver() == ForceSolver::BARNES_HUT);
+  CHECK(simulation.get_precision_mode() == PrecisionMode::DOUBLE);
+  simulation.set_force_solver(ForceSolver::DIRECT);
+  simulation.set_precision_mode(PrecisionMode::DOUBLE_DOUBLE);
+  CHECK(simulation.get_force_solver() == ForceSolver::BARNES_HUT);
+  CHECK(simulation.get_precision_mode() == PrecisionMode::DOUBLE);
+
+  simulation.reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 1000, .seed = 9});
+  simulation.set_force_solver(ForceSolver::DIRECT);
+  CHECK(simulation.get_force_solver() == ForceSolver::DIRECT);
+}
+
+int main() {
+  reorder_keys_build_the_same_tree();
+  reorder_every_step_tracks_plain_run();
+  large_scenes_leave_the_pair_kernels();
+  return check_failures;
+}
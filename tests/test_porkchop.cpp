@@ -0,0 +1,59 @@
+#include <cmath>
+#include "check.hpp"
+#include "porkchop.hpp"
+#include "simulation.hpp"
+
+static CelestialBody circular(double radius, double phase, double mass) {
+  CelestialBody body = {};
+  const double speed = std::sqrt(DEFAULT_G / radius);
+  body.position = radius * glm::dvec3(std::cos(phase), std::sin(phase), 0.0);
+  body.velocity = speed * glm::dvec3(-std::sin(phase), std::cos(phase), 0.0);
+  body.mass = mass;
+  body.radius = 0.01;
+  return body;
+}
+
+static std::vector<BodyHandle> handles_of(const Simulation &simulation) {
+  std::vector<BodyHandle> handles(simulation.bodies.size());
+  for (size_t i = 0; i < handles.size(); ++i) handles[i] = simulation.handle_of(i);
+  return handles;
+}
+
+// Earth to Mars on circular orbits: the best transfer costs about what a Hohmann transfer
+// does, and it names the same bodies after a removal has reshuffled the dense order
+static void earth_mars_by_handle() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  CelestialBody sun = {};
+  sun.mass = 1.0;
+  sun.radius = 0.2;
+  simulation.add_body(sun);
+  const BodyHandle venus = simulation.add_body(circular(0.723, 2.0, 2.45e-6));
+  const BodyHandle earth = simulation.add_body(circular(1.0, 0.0, 3e-6));
+  const BodyHandle mars = simulation.add_body(circular(1.524, 0.8, 3.2e-7));
+
+  PorkchopConfig config;
+  config.departure = earth;
+  config.arrival = mars;
+  config.departures = config.arrivals = 64;
+  PorkchopGrid before, after;
+  CHECK(compute_porkchop(simulation.bodies, handles_of(simulation), DEFAULT_G, config, before));
+  CHECK(before.config.central == simulation.handle_of(0));
+  const double best = before.min_delta_v * KM_S_PER_AU_DAY;
+  CHECK(best > 5.5 && best < 6.5); // Hohmann: 2.94 + 2.65 km/s
+
+  simulation.remove_body(venus); // mars moves into venus's dense slot
+  CHECK(compute_porkchop(simulation.bodies, handles_of(simulation), DEFAULT_G, config, after));
+  CHECK(after.min_delta_v == before.min_delta_v);
+  CHECK(after.best_departure == before.best_departure && after.best_arrival == before.best_arrival);
+
+  config.arrival = venus; // gone
+  CHECK(!compute_porkchop(simulation.bodies, handles_of(simulation), DEFAULT_G, config, after));
+  config.arrival = earth; // same as the departure
+  CHECK(!compute_porkchop(simulation.bodies, handles_of(simulation), DEFAULT_G, config, after));
+}
+
+int main() {
+  earth_mars_by_handle();
+  return check_failures;
+}
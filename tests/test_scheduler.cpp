@@ -0,0 +1,54 @@
+#include <atomic>
+#include <numeric>
+#include "check.hpp"
+#include "scheduler.hpp"
+
+// every node must see all its predecessors finished, on a pool with real workers
+static void graph_respects_dependencies() {
+  Scheduler pool(4);
+  for (int run = 0; run < 200; ++run) {
+    std::atomic<int> stage{0};
+    std::atomic<int> violations{0};
+    TaskGraph graph;
+    // diamond: top -> {left x8} -> bottom
+    const size_t top = graph.add([&] { stage.fetch_add(1); });
+    const size_t bottom = graph.add([&] {
+      if (stage.load() != 9) violations++;
+    });
+    for (int k = 0; k < 8; ++k) {
+      const size_t middle = graph.add([&] {
+        if (stage.load() < 1) violations++;
+        stage.fetch_add(1);
+      });
+      graph.precede(top, middle);
+      graph.precede(middle, bottom);
+    }
+    graph.run(pool);
+    CHECK(violations.load() == 0);
+    CHECK(stage.load() == 9);
+  }
+}
+
+// nested parallel_for inside graph nodes, as the advance phases do
+static void nested_parallel_for() {
+  Scheduler pool(3);
+  std::vector<long> sums(4, 0);
+  TaskGraph graph;
+  for (size_t k = 0; k < sums.size(); ++k) {
+    graph.add([&, k] {
+      std::vector<long> values(10000);
+      pool.parallel_for(0, values.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) values[i] = static_cast<long>(i * (k + 1));
+      });
+      sums[k] = std::accumulate(values.begin(), values.end(), 0l);
+    });
+  }
+  graph.run(pool);
+  for (size_t k = 0; k < sums.size(); ++k) CHECK(sums[k] == 49995000l * static_cast<long>(k + 1));
+}
+
+int main() {
+  graph_respects_dependencies();
+  nested_parallel_for();
+  return check_failures;
+}
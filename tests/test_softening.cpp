@@ -0,0 +1,88 @@
+#include <cmath>
+#include "check.hpp"
+#include "simulation.hpp"
+#include "softening.hpp"
+
+// from r = h on the spline kernel is the Newtonian one, to the bit
+static void kernel_is_newtonian_beyond_h() {
+  for (double h : {1e-6, 1e-3, 0.5, 30.0}) {
+    for (double u = 1.0; u < 20.0; u *= 1.01) {
+      const double r = u * h, distance_sq = r * r;
+      CHECK(softened_inverse_cube(distance_sq, h) == 1.0 / (distance_sq * std::sqrt(distance_sq)));
+    }
+    // inside, softer than Newton and continuous at the edge
+    CHECK(softened_inverse_cube(0.25 * h * h, h) < 1.0 / (0.125 * h * h * h));
+    const double edge = h * (1.0 - 1e-9);
+    CHECK(std::abs(softened_inverse_cube(edge * edge, h) * h * h * h - 1.0) < 1e-6);
+  }
+  CHECK(softened_inverse_cube(4.0, 0.0) == 1.0 / 8.0); // h = 0 is plain Newtonian
+  CHECK(softened_inverse_cube(0.0, 1.0) == 0.0);
+}
+
+// with no more bodies than neighbours nothing is softened, the sun-earth pair stays Newtonian
+static void few_bodies_stay_unsoftened() {
+  Simulation simulation;
+  simulation.reset_to_solar_system();
+  std::vector<glm::dvec3> direct, softened;
+  simulation.time_force_evaluation(&direct);
+
+  SofteningConfig config = simulation.get_softening();
+  config.adaptive = true;
+  CHECK(simulation.bodies.size() <= config.neighbours);
+  simulation.set_softening(config);
+  simulation.time_force_evaluation(&softened);
+
+  for (double length : simulation.get_softening_lengths()) CHECK(length == 0.0);
+  for (size_t i = 0; i < direct.size(); ++i) {
+    CHECK(glm::length(softened[i] - direct[i]) < 1e-12 * glm::length(direct[i]));
+  }
+}
+
+// a cluster softens every body by its own neighbourhood
+static void cluster_follows_density() {
+  Simulation simulation;
+  simulation.reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 2000, .seed = 11});
+  SofteningConfig config = simulation.get_softening();
+  config.adaptive = true;
+  simulation.set_softening(config);
+  simulation.time_force_evaluation();
+
+  const auto &lengths = simulation.get_softening_lengths();
+  CHECK(lengths.size() == simulation.bodies.size());
+  double largest = 0.0;
+  for (double length : lengths) {
+    CHECK(length > 0.0);
+    largest = std::max(largest, length);
+  }
+  CHECK(simulation.get_softening_stats().mean_length < largest);
+}
+
+// softening replaces the float32, compensated and deterministic kernels and says so
+static void softening_reports_the_kernel_it_replaces() {
+  Simulation simulation;
+  simulation.set_deterministic(true);
+  simulation.set_precision_mode(PrecisionMode::COMPENSATED);
+  CHECK(simulation.get_force_kernel() == ForceKernel::DETERMINISTIC);
+
+  SofteningConfig config = simulation.get_softening();
+  config.adaptive = true;
+  simulation.set_softening(config);
+  CHECK(simulation.get_force_kernel() == ForceKernel::SOFTENED);
+  simulation.set_force_solver(ForceSolver::MIXED_PRECISION);
+  CHECK(simulation.get_force_kernel() == ForceKernel::SOFTENED);
+  simulation.set_force_solver(ForceSolver::BARNES_HUT);
+  CHECK(simulation.get_force_kernel() == ForceKernel::BARNES_HUT);
+
+  config.adaptive = false;
+  simulation.set_softening(config);
+  simulation.set_force_solver(ForceSolver::MIXED_PRECISION);
+  CHECK(simulation.get_force_kernel() == ForceKernel::MIXED_PRECISION);
+}
+
+int main() {
+  kernel_is_newtonian_beyond_h();
+  few_bodies_stay_unsoftened();
+  cluster_follows_density();
+  softening_reports_the_kernel_it_replaces();
+  return check_failures;
+}
@@ -0,0 +1,92 @@
+#include <cmath>
+#include "check.hpp"
+#include "simulation.hpp"
+
+#define JUPITER 5 // dense index in the solar system scene
+
+static CelestialBody moon(double distance, double speed, double mass) {
+  CelestialBody body = {};
+  body.position = glm::dvec3(distance, 0.0, 0.0);
+  body.velocity = glm::dvec3(0.0, speed, 0.0);
+  body.mass = mass;
+  body.radius = 0.01;
+  body.color = glm::vec3(1.0f);
+  return body;
+}
+
+// Io and Europa around Jupiter for 200 days at the parent step of 0.1 day. The subsystem
+// keeps Io on a fine-step global reference, a plain global run at the same step does not.
+static void io_europa_track_fine_reference() {
+  const std::vector<CelestialBody> moons = {moon(0.002819, 0.01001, 4.47e-8), moon(0.004486, 0.007937, 2.41e-8)};
+  const auto global = [&](Simulation &simulation) {
+    simulation.reset_to_solar_system();
+    for (CelestialBody satellite : moons) {
+      satellite.position += simulation.bodies[JUPITER].position;
+      satellite.velocity += simulation.bodies[JUPITER].velocity;
+      simulation.add_body(satellite);
+    }
+    simulation.advance(0.0, 1);
+  };
+
+  Simulation reference, plain, nested;
+  global(reference);
+  const size_t io = reference.bodies.size() - 2;
+  for (int k = 0; k < 20000; ++k) reference.advance(0.001, 10);
+
+  global(plain);
+  for (int k = 0; k < 2000; ++k) plain.advance(0.1, 1);
+
+  nested.reset_to_solar_system();
+  CHECK(nested.add_subsystem(nested.handle_of(JUPITER), moons, 0.001));
+  CHECK(!nested.add_subsystem(nested.handle_of(JUPITER), moons, 0.001)); // one per planet
+  nested.advance(0.0, 1);
+  for (int k = 0; k < 2000; ++k) nested.advance(0.1, 1);
+
+  const Subsystem &subsystem = nested.get_subsystems()[0];
+  const glm::dvec3 nested_io = nested.bodies[JUPITER].position + subsystem.members[1].position;
+  const glm::dvec3 nested_jupiter = nested.bodies[JUPITER].position + subsystem.members[0].position;
+  CHECK(glm::length(nested_io - reference.bodies[io].position) < 1e-7);
+  CHECK(glm::length(nested_jupiter - reference.bodies[JUPITER].position) < 1e-7);
+  CHECK(glm::length(plain.bodies[io].position - reference.bodies[io].position) > 1e-4);
+}
+
+// moons added one at a time keep the host at the barycentre and stay on their circles
+static void added_moons_orbit_the_planet() {
+  Simulation simulation;
+  simulation.reset_to_solar_system();
+  const BodyHandle jupiter = simulation.handle_of(JUPITER);
+  const double planet_mass = simulation.bodies[JUPITER].mass;
+  const double io_mass = 4.7e-5 * planet_mass, europa_mass = 2.5e-5 * planet_mass;
+
+  CHECK(simulation.add_moon(jupiter, io_mass, 0.002819));
+  CHECK(simulation.add_moon(jupiter, europa_mass, 0.004486));
+  CHECK(!simulation.add_moon(jupiter, io_mass, 1.0)); // far outside the Hill sphere
+  CHECK(!simulation.add_moon(BodyHandle{}, io_mass, 0.002819));
+  CHECK(simulation.get_subsystems().size() == 1);
+
+  const CelestialBody &host = simulation.bodies[JUPITER];
+  const Subsystem &subsystem = simulation.get_subsystems()[0];
+  CHECK(subsystem.members.size() == 3);
+  CHECK(std::abs(host.mass - (planet_mass + io_mass + europa_mass)) < 1e-15);
+  glm::dvec3 center(0.0), drift(0.0);
+  for (const auto &member : subsystem.members) {
+    center += member.mass * member.position;
+    drift += member.mass * member.velocity;
+  }
+  CHECK(glm::length(center) < 1e-20);
+  CHECK(glm::length(drift) < 1e-20);
+
+  simulation.advance(0.0, 1);
+  for (int k = 0; k < 1000; ++k) simulation.advance(0.1, 1);
+  for (size_t k = 1; k < 3; ++k) {
+    const double distance = glm::length(subsystem.members[k].position - subsystem.members[0].position);
+    const double target = k == 1 ? 0.002819 : 0.004486;
+    CHECK(std::abs(distance - target) < 0.02 * target); // the other moon perturbs the circle slightly
+  }
+}
+
+int main() {
+  io_europa_track_fine_reference();
+  added_moons_orbit_the_planet();
+  return check_failures;
+}
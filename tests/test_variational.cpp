@@ -0,0 +1,73 @@
+#include <cmath>
+#include "check.hpp"
+#include "simulation.hpp"
+
+// the symmetric sweep gives the direct forces
+static void forces_match_direct() {
+  Simulation simulation;
+  simulation.reset_to_scene({.preset = ScenePreset::PLUMMER, .bodies = 1500, .seed = 7});
+  std::vector<glm::dvec3> direct, variational;
+  simulation.time_force_evaluation(&direct);
+
+  CHECK(simulation.set_variational(true));
+  simulation.time_force_evaluation(&variational);
+
+  double worst = 0.0;
+  for (size_t i = 0; i < direct.size(); ++i) {
+    worst = std::max(worst, glm::length(variational[i] - direct[i]) / glm::length(direct[i]));
+  }
+  CHECK(worst < 1e-12);
+}
+
+// a Kepler orbit is regular, its mean MEGNO tends to 2
+static void kepler_orbit_is_regular() {
+  Simulation simulation;
+  simulation.clear_bodies();
+  CelestialBody sun = {}, planet = {};
+  sun.mass = 1.0;
+  sun.radius = 0.1;
+  planet.mass = 3e-6;
+  planet.radius = 0.01;
+  planet.position = glm::dvec3(1.0, 0.0, 0.0);
+  planet.velocity = glm::dvec3(0.0, 1.1 * std::sqrt(DEFAULT_G), 0.0); // mildly eccentric
+  simulation.add_body(sun);
+  simulation.add_body(planet);
+  CHECK(simulation.set_variational(true));
+  simulation.advance(0.0, 1);
+  for (int k = 0; k < 200; ++k) simulation.advance(0.5, 100); // about 27 years
+  CHECK(std::abs(simulation.get_chaos_indicators().mean_megno - 2.0) < 0.1);
+}
+
+// modes without a tangent map refuse the indicators, and switching to one drops them
+static void incompatible_modes_exclude() {
+  Simulation simulation;
+  simulation.reset_to_solar_system();
+
+  simulation.set_force_solver(ForceSolver::BARNES_HUT);
+  CHECK(!simulation.set_variational(true));
+  CHECK(!simulation.is_variational());
+  simulation.set_force_solver(ForceSolver::DIRECT);
+  simulation.set_precision_mode(PrecisionMode::DOUBLE_DOUBLE);
+  CHECK(!simulation.set_variational(true));
+  simulation.set_precision_mode(PrecisionMode::COMPENSATED);
+  CHECK(simulation.set_variational(true));
+
+  simulation.set_deterministic(true); // the sweep already is
+  CHECK(simulation.is_variational());
+  simulation.set_solver_config({ForceSolver::MIXED_PRECISION, 1, MIXED_TILE_SIZE, OCTREE_LEAF_SIZE});
+  CHECK(!simulation.is_variational());
+
+  simulation.set_force_solver(ForceSolver::DIRECT);
+  CHECK(simulation.set_variational(true));
+  SofteningConfig softening = simulation.get_softening();
+  softening.adaptive = true;
+  simulation.set_softening(softening);
+  CHECK(!simulation.is_variational());
+}
+
+int main() {
+  forces_match_direct();
+  kepler_orbit_is_regular();
+  incompatible_modes_exclude();
+  return check_failures;
+}